@@ -64,7 +64,7 @@
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 7 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)32768)
+#define configTOTAL_HEAP_SIZE                    ((size_t)49152)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_16_BIT_TICKS                   0
 #define configUSE_MUTEXES                        1
@@ -73,6 +73,8 @@
 #define configUSE_RECURSIVE_MUTEXES              1
 #define configUSE_MALLOC_FAILED_HOOK             1
 #define configUSE_APPLICATION_TASK_TAG           1
+#define configUSE_TRACE_FACILITY                 1
+#define configGENERATE_RUN_TIME_STATS            1
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  1
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
@@ -139,6 +141,19 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+
+/* run-time stats (see cpuload.c) in CPU cycles: the DWT cycle counter is enabled by DWT_Init() in main(), before the scheduler is started */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()	(*(volatile uint32_t*) 0xE0001004UL) /* DWT->CYCCNT */
+
+/* context switches in the event trace (see trace.c), expanded in tasks.c */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+#include "trace.h"
+#ifdef TRACE_ENABLE
+#define traceTASK_SWITCHED_IN()		traceRecord(TRACE_TASK_IN, (uint8_t) pxCurrentTCB->uxTCBNumber, 0)
+#define traceTASK_SWITCHED_OUT()	traceRecord(TRACE_TASK_OUT, (uint8_t) pxCurrentTCB->uxTCBNumber, 0)
+#endif
+#endif
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,23 @@
+/*
+ * adpcm.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * IMA-ADPCM codec (4 bits per sample), see adpcm.c. Portable: also built into the host tools (see tools/tlmrecv.c).
+ */
+
+#ifndef INC_ADPCM_H_
+#define INC_ADPCM_H_
+
+#include "stdint.h"
+
+typedef struct __attribute__((packed)) {
+	int16_t predictor;		// last reconstructed sample
+	uint8_t index;			// step size index, 0 to 88
+	uint8_t reserved;
+} adpcm_state_t;
+
+uint8_t adpcmEncode(adpcm_state_t *s, int16_t sample);
+int16_t adpcmDecode(adpcm_state_t *s, uint8_t code);
+
+#endif /* INC_ADPCM_H_ */
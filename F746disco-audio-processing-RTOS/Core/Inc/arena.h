@@ -0,0 +1,37 @@
+/*
+ * arena.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Tiered arena (bump) allocator for the memory of the effect chain. See arena.c.
+ * Only depends on the C library, hence it also builds on the host.
+ */
+
+#ifndef INC_ARENA_H_
+#define INC_ARENA_H_
+
+#include "stdint.h"
+
+typedef enum {
+	ARENA_FAST = 0,		// DTCM: per-frame work buffers and small state that the kernels hit at every sample
+	ARENA_NORMAL,		// SRAM (cacheable): coefficients, medium-sized state
+	ARENA_BULK,			// SDRAM: delay lines, long impulse responses
+	ARENA_TIERS
+} arena_tier_t;
+
+typedef struct {
+	const char *name;
+	uint8_t *base;
+	uint32_t size;		// in bytes
+	uint32_t used;		// including alignment padding
+	uint32_t highWater;	// largest "used" since arenaInitPool()
+	uint32_t failures;	// requests refused since arenaInitPool()
+} arena_pool_t;
+
+void arenaInitPool(arena_tier_t tier, const char *name, void *base, uint32_t size);
+void* arenaAlloc(arena_tier_t tier, uint32_t size, uint32_t align);
+void arenaReset(void);
+const arena_pool_t* arenaGetPool(arena_tier_t tier);
+void arenaReport(void);
+
+#endif /* INC_ARENA_H_ */
@@ -0,0 +1,88 @@
+/*
+ * assets.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Indexed asset container stored in the QSPI flash and read in place (XIP).
+ * This header is shared with the host-side packer (tools/assetpack.c), hence it must only depend on stdint.h.
+ *
+ * Container layout (all fields little-endian, offsets relative to the container start):
+ *
+ * 		asset_header_t				magic, version, entry count, total size, CRC of the entry table
+ * 		asset_entry_t[count]		name, type, offset/size of the data, type-specific parameters, CRC of the data
+ * 		data...						each entry starts on an ASSETS_ALIGN boundary (= one Cortex-M7 cache line)
+ *
+ * CRCs are CRC-32/MPEG-2 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection, no final XOR),
+ * which is what the STM32 CRC unit computes with the configuration of MX_CRC_Init().
+ */
+
+#ifndef INC_ASSETS_H_
+#define INC_ASSETS_H_
+
+#include "stdint.h"
+
+#define ASSETS_MAGIC		0x31545341	// "AST1"
+#define ASSETS_VERSION		1
+#define ASSETS_ALIGN		32
+#define ASSETS_NAME_LEN		24
+
+typedef enum {
+	ASSET_RAW = 0,			// opaque bytes
+	ASSET_WAVETABLE = 1,	// float32 samples: param0 = table length, param1 = number of tables
+	ASSET_IR = 2,			// float32 impulse response, time domain: param0 = length, param1 = sample rate
+	ASSET_IR_PARTITIONS = 3,// float32 spectra of the IR partitions (see below): param0 = partition length, param1 = partition count
+	ASSET_PRESET = 4,		// opaque effect settings
+	ASSET_IMAGE = 5,		// pixels ready for the DMA2D (see below): param0 = width | height << 16, param1 = format | CLUT size << 16
+	ASSET_JPEG = 6			// JPEG file, decoded on the target by the image loader (see images.c): param0 = width | height << 16
+} asset_type_t;
+
+/*
+ * ASSET_IMAGE: pixels converted on the host (tools/assetpack.c), first line first, no padding between lines.
+ * The formats are the DMA2D input color modes, so that LCD_DrawImage() draws them with a single PFC transfer.
+ * ASSET_IMAGE_L8: the data start with the palette (CLUT size ARGB8888 colors), padded to ASSETS_ALIGN bytes,
+ * followed by one byte per pixel.
+ */
+typedef enum {
+	ASSET_IMAGE_ARGB8888 = 0,
+	ASSET_IMAGE_RGB565 = 2,
+	ASSET_IMAGE_ARGB4444 = 4,
+	ASSET_IMAGE_L8 = 5
+} asset_image_format_t;
+
+/*
+ * ASSET_IR_PARTITIONS: the impulse response is cut into param1 partitions of param0 samples each (last one zero-padded).
+ * Each partition is zero-padded to 2*param0 samples and transformed, yielding 2*param0 floats in the packed
+ * format of arm_rfft_fast_f32() (out[0] = DC, out[1] = Nyquist, then interleaved real/imag parts of bins 1..param0-1),
+ * so that a uniformly partitioned convolution can multiply them directly with the spectra of the input blocks.
+ */
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;
+	uint32_t totalSize;		// header + entry table + data, in bytes
+	uint32_t tableCrc;		// CRC of the entry table
+} asset_header_t;
+
+typedef struct {
+	char name[ASSETS_NAME_LEN];	// zero-terminated
+	uint32_t type;				// asset_type_t
+	uint32_t offset;			// multiple of ASSETS_ALIGN
+	uint32_t size;				// in bytes
+	uint32_t param0;
+	uint32_t param1;
+	uint32_t crc;				// CRC of the data
+} asset_entry_t;
+
+// -------------------------------- functions (target only) --------------------
+
+uint16_t assetsInit(void);
+void assetsLock(void);
+void assetsUnlock(void);
+const asset_entry_t* assetsFind(const char *name, asset_type_t type);
+const void* assetsData(const asset_entry_t *entry);
+uint8_t assetsVerify(const asset_entry_t *entry);
+const float* assetsGetIRPartitions(const char *name, uint32_t *partitionLength, uint32_t *partitionCount);
+const void* assetsGetImage(const char *name, uint32_t *width, uint32_t *height, uint32_t *format, const uint32_t **clut, uint32_t *clutSize);
+
+#endif /* INC_ASSETS_H_ */
@@ -9,9 +9,62 @@
 #define INC_AUDIO_H_
 
 #include "stdint.h"
+#include "bsp/disco_sai.h"
 
+// effects that can be inserted in the processing chain (see processAudio() in audio.c)
+typedef enum {
+	FX_NONE = 0, FX_ECHO, FX_NOISE_GATE, FX_COUNT
+} effect_id_t;
 
+#define AUDIO_CHAIN_MAX		4
+
+#define ECHO_MAX_MS			2000	// longest echo delay, the echo line is allocated for it at 48kHz (see buildChain() in audio.c)
+
+#define AUDIO_SETTINGS_VERSION	3
+
+/**
+ * Everything that defines the current sound: the effect chain, the effect parameters, the sampling rate and the input.
+ * This is what gets persisted by presets.c, hence bump AUDIO_SETTINGS_VERSION whenever the layout changes.
+ */
+typedef struct {
+	uint32_t version;
+	uint8_t chain[AUDIO_CHAIN_MAX];	// effect ids in processing order, FX_NONE for an empty slot
+	float echoDry;
+	float echoWet;
+	float echoFeedback;
+	float echoDelayMs;				// rate independent, see configureEffects() in audio.c
+	float gateThreshold;
+	float gateAttenuation;
+	uint32_t sampleRate;			// SAI_AUDIO_FREQUENCY_16K or SAI_AUDIO_FREQUENCY_48K, see audioApplyStreamSettings()
+	uint16_t inputDevice;			// INPUT_DEVICE_INPUT_LINE_1 or INPUT_DEVICE_DIGITAL_MICROPHONE_2, idem
+	uint16_t reserved;
+} audio_settings_t;
+
+/**
+ * Frame timing and xrun counters, see audioGetStats().
+ */
+typedef struct {
+	uint32_t frameCycles;		// processing time of the last frame, in CPU cycles
+	uint32_t frameCyclesMax;	// longest since the previous audioGetStats()
+	uint32_t periodCycles;		// duration of a frame at the current sampling rate
+	uint32_t wakeCyclesMax;		// longest IRQ-to-task wake-up since the previous audioGetStats()
+	uint32_t lateFrames;
+	uint32_t marginWarnings;
+	uint32_t slips;
+	uint32_t missedWakeups;
+} audio_stats_t;
+
+void audioInit(void);
 void audioLoop();
-void calculateFFT(int16_t *buff_in);
+void calculateFFT(audio_sample_t *buff_in);
+void audioGetSettings(audio_settings_t *s);
+uint8_t audioApplySettings(const audio_settings_t *s);
+uint8_t audioApplyStreamSettings(void);
+uint8_t audioSetSampleRate(uint32_t rate);
+uint32_t audioGetSampleRate(void);
+uint8_t audioSetInput(uint16_t device);
+uint16_t audioGetInput(void);
+void audioReportMonitor(void);
+void audioGetStats(audio_stats_t *s);
 
 #endif /* INC_AUDIO_H_ */
@@ -78,14 +78,70 @@
 //#define SDRAM_WRITE_READ_ADDR_OFFSET ((uint32_t)0x0800)
 #define SDRAM_WRITE_READ_ADDR_OFFSET ((uint32_t)0x0000)
 
-// This is the audio scratch buffer used by processAudio() to store
-// audio samples for e.g. long impulse response FIR filters (that is, long enough to not hold inside a single DMA frame!)
-// it is located in external SDRAM and its address range begins right after the LCD frame buffer.
+// This is the SDRAM ring buffer used by recorder.c to hand audio blocks over from the audio task
+// to the SD-card writer task. It sits at the very end of the SDRAM and must be a power of two.
+// 1Mbytes is about 5.4s of 48kHz 16 bit stereo audio, which is way more than the worst SD-card write stall.
+#define RECORDER_RING_SIZE_BYTES	((uint32_t)0x100000)
+#define RECORDER_RING_ADDR			((uint32_t)(SDRAM_DEVICE_ADDR + SDRAM_DEVICE_SIZE - RECORDER_RING_SIZE_BYTES))
+
+// Read-ahead ring used by player.c to stream WAV files from the SD-card, right before the recorder ring.
+// 512kbytes is about 2.7s of 48kHz 16 bit stereo audio. Must be a power of two.
+#define PLAYER_RING_SIZE_BYTES		((uint32_t)0x80000)
+#define PLAYER_RING_ADDR			((uint32_t)(RECORDER_RING_ADDR - PLAYER_RING_SIZE_BYTES))
+
+// Test sequence and capture buffer of the latency measurement mode (see latency.c), right before the player ring.
+#define LATENCY_BUF_SIZE_BYTES		((uint32_t)0x8000)
+#define LATENCY_BUF_ADDR			((uint32_t)(PLAYER_RING_ADDR - LATENCY_BUF_SIZE_BYTES))
+
+// Event trace ring (see trace.c), right before the latency buffer: 4096 records of 8 bytes. Must be a power of two.
+#define TRACE_BUF_SIZE_BYTES		((uint32_t)0x8000)
+#define TRACE_BUF_ADDR				((uint32_t)(LATENCY_BUF_ADDR - TRACE_BUF_SIZE_BYTES))
+
+// Message ring and VCP output ring of the logger (see logger.c), right before the trace ring.
+#define LOG_BUF_SIZE_BYTES			((uint32_t)0x2000)
+#define LOG_BUF_ADDR				((uint32_t)(TRACE_BUF_ADDR - LOG_BUF_SIZE_BYTES))
+
+// Slots of the remote audio monitor (see monitor.c), right before the logger rings: about 330ms at 48kHz.
+#define MONITOR_BUF_SIZE_BYTES		((uint32_t)0x10000)
+#define MONITOR_BUF_ADDR			((uint32_t)(LOG_BUF_ADDR - MONITOR_BUF_SIZE_BYTES))
+
+// A8 glyph atlas and pre-rendered strings of the LCD text renderer (see disco_lcd.c), right before the monitor slots.
+#define LCD_TEXT_BUF_SIZE_BYTES		((uint32_t)0x40000)
+#define LCD_TEXT_BUF_ADDR			((uint32_t)(MONITOR_BUF_ADDR - LCD_TEXT_BUF_SIZE_BYTES))
+
+// Draw command ring of the display task (see display.c), right before the LCD text buffer.
+#define DISPLAY_BUF_SIZE_BYTES		((uint32_t)0x8000)
+#define DISPLAY_BUF_ADDR			((uint32_t)(LCD_TEXT_BUF_ADDR - DISPLAY_BUF_SIZE_BYTES))
+
+// Decoded images (RGB565, one full screen per slot) of the image loader (see images.c), right before the display ring.
+#define IMAGE_CACHE_SIZE_BYTES		((uint32_t)0x100000)
+#define IMAGE_CACHE_ADDR			((uint32_t)(DISPLAY_BUF_ADDR - IMAGE_CACHE_SIZE_BYTES))
+
+// Working memory of the JPEG decoder (see jpegdec.c), right before the image cache.
+#define JPEG_HEAP_SIZE_BYTES		((uint32_t)0x20000)
+#define JPEG_HEAP_ADDR				((uint32_t)(IMAGE_CACHE_ADDR - JPEG_HEAP_SIZE_BYTES))
+
+// This is the audio scratch buffer, i.e. the bulk pool of the effect chain (see arena.c and buildChain() in audio.c),
+// for delay lines or long impulse response FIR filters (that is, long enough to not hold inside a single DMA frame!)
+// it is located in external SDRAM and its address range begins right after the LCD frame buffer
+// and stops right before the JPEG decoder heap.
 #define AUDIO_SCRATCH_ADDR  		SDRAM_WRITE_READ_ADDR
-#define AUDIO_SCRATCH_MAXSZ_BYTES	(SDRAM_DEVICE_SIZE - (AUDIO_SCRATCH_ADDR-SDRAM_DEVICE_ADDR))
+#define AUDIO_SCRATCH_MAXSZ_BYTES	(JPEG_HEAP_ADDR - AUDIO_SCRATCH_ADDR)
 #define AUDIO_SCRATCH_MAXSZ_WORDS	AUDIO_SCRATCH_MAXSZ_BYTES / 2  // 16 bit
 #define AUDIO_SCRATCH_MAXSZ_SAMPLES	AUDIO_SCRATCH_MAXSZ_WORDS / 2  // 16 bit stereo
 
+/**
+  * QSPI flash layout. The 16Mbytes N25Q128A is memory-mapped at 0x90000000 by MX_QUADSPI_Init()
+  * (cacheable, see mpu.c), hence anything stored there can be read in place (XIP) without being copied to RAM.
+  * - the asset store (see assets.c) starts at the beginning of the flash,
+  * - the top 256kbytes are reserved for persistent settings.
+  */
+#define QSPI_DEVICE_ADDR			((uint32_t)0x90000000)
+#define QSPI_DEVICE_SIZE			((uint32_t)0x1000000)
+#define QSPI_SETTINGS_SIZE			((uint32_t)0x40000)
+#define QSPI_ASSETS_OFFSET			((uint32_t)0)
+#define QSPI_ASSETS_MAXSZ_BYTES		(QSPI_DEVICE_SIZE - QSPI_SETTINGS_SIZE)
+
 // -------------------------------- functions --------------------
 
 /* basic I/O functions */
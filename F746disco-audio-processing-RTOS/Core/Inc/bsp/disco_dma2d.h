@@ -0,0 +1,42 @@
+/*
+ * disco_dma2d.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Interrupt-driven DMA2D job queue, see disco_dma2d.c.
+ */
+
+#ifndef INC_DISCO_DMA2D_H_
+#define INC_DISCO_DMA2D_H_
+
+#include "stm32f7xx_hal.h"
+
+#define DMA2D_QUEUE_LEN			32		// jobs, must be a power of two
+#define DMA2D_WAIT_TIMEOUT_MS	100		// way more than a full screen transfer
+
+/*
+ * A job is the image of the DMA2D registers for one transfer, built once by the caller (see the LL_ functions
+ * in disco_lcd.c) and written as is when the job starts. CR only holds the mode (DMA2D_M2M, DMA2D_M2M_PFC,
+ * DMA2D_M2M_BLEND or DMA2D_R2M): the queue adds the interrupt enables and the start bit.
+ *
+ * With CR = DMA2D_JOB_CLUT_LOAD, the job loads the foreground CLUT instead (FGCMAR, with the size and color mode
+ * in FGPFCCR), so that the L8 transfers queued after it use this palette.
+ */
+#define DMA2D_JOB_CLUT_LOAD		0x80000000U	// not a DMA2D mode
+
+typedef struct {
+	uint32_t CR;
+	uint32_t FGMAR, FGOR, FGPFCCR, FGCOLR, FGCMAR;
+	uint32_t BGMAR, BGOR, BGPFCCR, BGCOLR;
+	uint32_t OPFCCR, OCOLR, OMAR, OOR;
+	uint32_t NLR;
+} dma2d_job_t;
+
+void     DISCO_DMA2D_Init(void);
+uint32_t DISCO_DMA2D_Submit(const dma2d_job_t *job);
+uint8_t  DISCO_DMA2D_IsDone(uint32_t ticket);
+void     DISCO_DMA2D_Wait(uint32_t ticket);
+void     DISCO_DMA2D_WaitIdle(void);
+uint32_t DISCO_DMA2D_GetErrors(void);
+
+#endif /* INC_DISCO_DMA2D_H_ */
@@ -14,13 +14,15 @@
 
 
 #include "disco_sdram.h"
+#include "disco_base.h"
 #include "fonts.h"
 #include "types.h"
 
  // ======================================= IMPORTANT CONFIG DEFINES ========================
 
-/* uncomment to put FB in SDRAM, else it will be in RAM (in which case 565 pixel format is mandatory else FB doesn't fit in RAM) */
-//#define FB_IN_SDRAM
+/* uncomment to put FB in SDRAM, else it will be in RAM (in which case 565 pixel format is mandatory else FB doesn't fit in RAM)
+ * In SDRAM, the FB is double-buffered: primitives draw into a back buffer, shown by LCD_SwapBuffers() at the next vertical blanking. */
+#define FB_IN_SDRAM
 
  /* uncomment if FB's pixel format is 565, leave commented for ARGB888 format */
 #define PF_565
@@ -28,13 +30,23 @@
 // ==========================================================================================
 
 #ifdef PF_565
-	#define __GetAddress(X,Y) ((hltdc.LayerCfg[0].FBStartAdress)+2*(LCD_SCREEN_WIDTH*Y+X))
+	#define LCD_BYTES_PER_PIXEL	2
+#else
+	#define LCD_BYTES_PER_PIXEL	4
+#endif
+
+#define LCD_FB_SIZE_BYTES	(LCD_SCREEN_WIDTH * LCD_SCREEN_HEIGHT * LCD_BYTES_PER_PIXEL)
+
+
+// every primitive draws into lcdDrawBuffer: the back buffer in SDRAM, else the one and only FB in RAM
+#ifdef PF_565
+	#define __GetAddress(X,Y) (lcdDrawBuffer+2*(LCD_SCREEN_WIDTH*(Y)+(X)))
 	#define __DrawPixel(X, Y, C) *(__IO uint16_t*)(__GetAddress(X, Y))=C
 	#define STROKE_COLOR StrokeColor565
 	#define FILL_COLOR FillColor565
 	#define BACK_COLOR BackColor565
 #else
-	#define __GetAddress(X,Y) ((hltdc.LayerCfg[0].FBStartAdress)+4*(LCD_SCREEN_WIDTH*Y+X))
+	#define __GetAddress(X,Y) (lcdDrawBuffer+4*(LCD_SCREEN_WIDTH*(Y)+(X)))
 	#define __DrawPixel(X, Y, C) *(__IO uint32_t*)(__GetAddress(X, Y))=C
 	#define STROKE_COLOR StrokeColor
 	#define FILL_COLOR FillColor
@@ -54,6 +66,19 @@ typedef enum
   LEFT_MODE               = 0x03     /* Left mode   */
 }Text_AlignModeTypdef;
 
+/**
+  * Image drawn by LCD_DrawImage(), e.g. an ASSET_IMAGE from the QSPI flash (see assets.h and tools/assetpack.c)
+  */
+typedef struct
+{
+  const void     *pixels;     /* first line first, no padding between lines */
+  const uint32_t *clut;       /* CM_L8 only: palette of clutSize ARGB8888 colors */
+  uint16_t       width;
+  uint16_t       height;
+  uint32_t       colorMode;   /* DMA2D input color mode: CM_RGB565, CM_ARGB4444, CM_L8, CM_ARGB8888... */
+  uint16_t       clutSize;    /* 1 to 256 */
+} LCD_ImageTypeDef;
+
 #define LCD_OK                 ((uint8_t)0x00)
 #define LCD_ERROR              ((uint8_t)0x01)
 #define LCD_TIMEOUT            ((uint8_t)0x02)
@@ -91,6 +116,10 @@ typedef enum
 
 #define LCD_DEFAULT_FONT        Font24
 
+#define LCD_VSYNC_TIMEOUT_MS    50    /* the panel refreshes at about 60Hz, see MX_LTDC_Init() and the PLLSAI settings */
+
+extern uint32_t lcdDrawBuffer;
+
 
 void	 LCD_Init(void);
 
@@ -104,6 +133,7 @@ void     LCD_ResetColorKeying_NoReload(uint32_t LayerIndex);
 void     LCD_SetLayerWindow(uint16_t LayerIndex, uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
 void     LCD_SetLayerWindow_NoReload(uint16_t LayerIndex, uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
 void     LCD_Reload(uint32_t ReloadType);
+void     LCD_SwapBuffers(void);
 
 void     LCD_SetStrokeColor(uint32_t Color);
 void     LCD_SetBackColor(uint32_t Color);
@@ -132,6 +162,8 @@ void     LCD_DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
 void     LCD_DrawPolygon(pPoint Points, uint16_t PointCount);
 void     LCD_DrawEllipse(int Xpos, int Ypos, int XRadius, int YRadius);
 void     LCD_DrawBitmap(uint32_t Xpos, uint32_t Ypos, uint8_t *pbmp);
+void     LCD_DrawColumn(uint16_t Xpos, uint16_t Ypos, const uint16_t *pixels, uint16_t Height, const boolean_t isWaited);
+void     LCD_DrawImage(uint16_t Xpos, uint16_t Ypos, const LCD_ImageTypeDef *pImage, const boolean_t isBlended);
 
 void     LCD_FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
 void     LCD_FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
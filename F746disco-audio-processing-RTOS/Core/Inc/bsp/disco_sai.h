@@ -32,11 +32,84 @@
 #define CODEC_AUDIOFRAME_HPOUT 	CODEC_AUDIOFRAME_SLOT_02
 //#define CODEC_AUDIOFRAME_SPKOUT	CODEC_AUDIOFRAME_SLOT_13 // NOT USED
 
+/*
+ * Sample format of the SAI, DMA buffers and effect chain.
+ *
+ * Default: 16-bit samples (int16_t) in 16-bit slots.
+ *
+ * AUDIO_SAMPLE_24IN32: the WM8994 word length is set to 32 bits and the SAI carries 32-bit slots (SAI_DATASIZE_32),
+ * so that each int32_t sample holds the full 24-bit converter output, left-aligned (the 8 LSBs are zero on input and
+ * ignored by the DAC on output). Left alignment means int32_t full scale = converter full scale: no shift is needed
+ * b/w the DMA buffers and the code, and the CMSIS q31 conversion kernels apply directly.
+ *
+ * Costs against the 16-bit path:
+ * - memory: DMA buffers go from 2 x 2kbytes to 2 x 4kbytes of SRAM, the recorder writes twice as many bytes per
+ *   second (32-bit WAV files, i.e. its SDRAM ring holds half the duration), player.c expands 16-bit files on the fly.
+ * - bus: the DMA moves words instead of half-words, i.e. the same number of transfers per frame.
+ * - cycles: the effect chain runs on floats in both cases (see processAudio() in audio.c), and arm_q31_to_float()
+ *   costs the same as arm_q15_to_float(). The level meter accumulates in 64 bits (one extra ADC per sample).
+ *   Overall, the difference is a few hundred cycles per frame, i.e. well under 1% of a 256-sample frame at 216MHz.
+ */
+//#define AUDIO_SAMPLE_24IN32
+
+#ifdef AUDIO_SAMPLE_24IN32
+typedef int32_t audio_sample_t;
+#define AUDIO_SAI_DATASIZE			SAI_DATASIZE_32
+#define AUDIO_SAI_FRAME_LENGTH		128
+#define AUDIO_DMA_PDATAALIGN		DMA_PDATAALIGN_WORD
+#define AUDIO_DMA_MDATAALIGN		DMA_MDATAALIGN_WORD
+#define AUDIO_SAMPLE_FULL_SCALE		2147483648.0
+#define AUDIO_SAMPLE_FROM_16(x)		((int32_t) (x) << 16)
+#else
+typedef int16_t audio_sample_t;
+#define AUDIO_SAI_DATASIZE			SAI_DATASIZE_16
+#define AUDIO_SAI_FRAME_LENGTH		64
+#define AUDIO_DMA_PDATAALIGN		DMA_PDATAALIGN_HALFWORD
+#define AUDIO_DMA_MDATAALIGN		DMA_MDATAALIGN_HALFWORD
+#define AUDIO_SAMPLE_FULL_SCALE		32768.0
+#define AUDIO_SAMPLE_FROM_16(x)		(x)
+#endif
+
+/*
+ * AUDIO_IN_PLACE: the input and output DMA streams share a single circular buffer, and the audio task processes
+ * each half in place, right where it has been received (see processFrame() in audio.c). This saves one DMA buffer
+ * (2 or 4 kbytes of the 8 kbytes of the non-cacheable RAM_DMA section, see DMA_BUFFER in mpu.h) and the copy of each
+ * frame into the output buffer. Since that buffer isn't cacheable, both DMA streams and the CPU share it without any
+ * D-cache maintenance.
+ *
+ * The output stream reads each sample a full buffer after the input stream has written it, just before it gets
+ * overwritten: both streams are started output first (see startStreams() in disco_sai.c), so that the output DMA,
+ * which moreover prefetches into its FIFOs, stays a few samples ahead of the input DMA. Hence the round-trip latency is
+ * the same as with separate buffers (one half-buffer in, one half-buffer out): only memory and a copy are saved.
+ * The output slip buffer (AUDIO_OUTPUT_SLIP) cannot be used in this mode, since the output position is tied to the input.
+ */
+//#define AUDIO_IN_PLACE
+
 #define AUDIO_OK                            ((uint8_t)0)
 #define AUDIO_ERROR                         ((uint8_t)1)
 #define AUDIO_TIMEOUT                       ((uint8_t)2)
 
-void setInput(uint16_t InputDevice);
-void start_Audio_Processing(int16_t* buf_output, int16_t* buf_input, uint32_t audio_dma_buf_size, uint16_t InputDevice, uint32_t AudioFreq);
+/**
+ * RX/TX phase monitor, see saiMonitorSample() in disco_sai.c.
+ * Positions and phases are in samples (DMA data items), modulo the DMA buffer size.
+ */
+typedef struct {
+	uint32_t samples;		// number of callbacks sampled since the streams were (re)started
+	int32_t phase;			// last RX-to-TX phase offset, i.e. RX position minus TX position
+	int32_t driftMin;		// extreme deviations of the phase from its value right after the (re)start
+	int32_t driftMax;
+	uint32_t driftEvents;	// samples deviating by more than SAI_PHASE_TOLERANCE
+} sai_monitor_t;
+
+#define SAI_PHASE_TOLERANCE		4
+
+uint8_t setInput(uint16_t InputDevice);
+uint8_t setAudioFrequency(uint32_t AudioFreq);
+void saiMonitorSample(void);
+void saiMonitorReset(void);
+void saiMonitorGet(sai_monitor_t *m);
+uint32_t saiGetTxPosition(void);
+uint32_t saiGetRxPosition(void);
+void start_Audio_Processing(audio_sample_t* buf_output, audio_sample_t* buf_input, uint32_t audio_dma_buf_size, uint16_t InputDevice, uint32_t AudioFreq);
 
 #endif /* INC_DISCO_SAI_H_ */
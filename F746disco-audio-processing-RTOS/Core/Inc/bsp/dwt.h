@@ -0,0 +1,20 @@
+/*
+ * dwt.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Cortex-M7 cycle counter (DWT_CYCCNT), for profiling with a 1 cycle resolution (4.6ns at 216MHz).
+ * It wraps around after 2^32 cycles (about 20s), hence durations must be computed as unsigned differences.
+ */
+
+#ifndef INC_DWT_H_
+#define INC_DWT_H_
+
+#include "stm32f7xx_hal.h"
+
+#define DWT_CYCLES()		(DWT->CYCCNT)
+
+void DWT_Init(void);
+uint32_t DWT_CyclesToUs(uint32_t cycles);
+
+#endif /* INC_DWT_H_ */
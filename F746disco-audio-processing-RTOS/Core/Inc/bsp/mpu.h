@@ -10,6 +10,25 @@
 
 #include "stm32f7xx_hal.h"
 
+/*
+ * Internal SRAM memory map (see MPU_Init() and the linker scripts):
+ *
+ * 		0x20000000 - 0x2004DFFF		RAM: data, bss, heap, stacks and the LCD framebuffer; cacheable, write-through
+ * 		0x2004E000 - 0x2004FFFF		RAM_DMA: ".dma_buffers" section, not cacheable (8kbytes)
+ *
+ * Write-through means the memory is always up to date, hence peripherals that read from SRAM (LTDC, SAI output DMA,
+ * SDMMC writes, DMA2D sources) need no cache maintenance, and an invalidation never discards pending CPU writes.
+ * Buffers that a DMA writes to behind the CPU (e.g. the SAI input DMA) go to RAM_DMA with DMA_BUFFER,
+ * or must be invalidated before the CPU reads them (SDMMC reads, see sd_diskio.c).
+ */
+#define DMA_BUFFER __attribute__((section(".dma_buffers"), aligned(32)))
+
+#define RAM_DMA_ADDR		0x2004E000
+#define RAM_DMA_SIZE		MPU_REGION_SIZE_8KB
+
+// uncomment to leave the whole SRAM non-cacheable, as before the memory map above, e.g. for before/after cycle measurements
+//#define SRAM_NOT_CACHEABLE
+
 void MPU_Init();
 
 
@@ -84,6 +84,7 @@ uint32_t wm8994_SetVolume(uint16_t DeviceAddr, uint8_t Volume);
 uint32_t wm8994_SetMute(uint16_t DeviceAddr, uint32_t Cmd);
 uint32_t wm8994_SetOutputMode(uint16_t DeviceAddr, uint8_t Output);
 uint32_t wm8994_SetFrequency(uint16_t DeviceAddr, uint32_t AudioFreq);
+uint32_t wm8994_SetInput(uint16_t DeviceAddr, uint16_t InputDevice, uint8_t Volume);
 uint32_t wm8994_Reset(uint16_t DeviceAddr);
 
 
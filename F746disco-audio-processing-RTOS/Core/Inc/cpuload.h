@@ -0,0 +1,33 @@
+/*
+ * cpuload.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Per-task CPU load and stack usage, from the FreeRTOS run-time stats (see cpuload.c).
+ */
+
+#ifndef INC_CPULOAD_H_
+#define INC_CPULOAD_H_
+
+#include "stdint.h"
+
+#define CPULOAD_MAX_TASKS	20	// 13 tasks so far (11 in Core/Src, USBH_Thread, IDLE), room for a few more
+#define CPULOAD_NAME_LEN	16	// configMAX_TASK_NAME_LEN
+
+typedef struct {
+	char name[CPULOAD_NAME_LEN];
+	uint16_t number;		// task number (xTaskNumber, see trace.c)
+	uint16_t permil;		// share of the CPU over the last period, in 1/1000
+	uint16_t stackFree;		// stack high-water mark: least free stack ever, in words
+} cpuload_task_t;
+
+typedef struct {
+	uint32_t seq;			// incremented at each sample
+	uint32_t count;			// valid entries in tasks[]
+	cpuload_task_t tasks[CPULOAD_MAX_TASKS];	// in creation order
+} cpuload_snapshot_t;
+
+void cpuLoadInit(void);
+void cpuLoadGet(cpuload_snapshot_t *s);
+
+#endif /* INC_CPULOAD_H_ */
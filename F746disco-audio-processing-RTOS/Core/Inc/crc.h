@@ -0,0 +1,18 @@
+/*
+ * crc.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * CRC-32/MPEG-2 on the CRC unit, shared by the tasks that use it (see crc.c).
+ */
+
+#ifndef INC_CRC_H_
+#define INC_CRC_H_
+
+#include "stdint.h"
+
+void crcInit(void);
+uint32_t crcCompute(const void *data, uint32_t len);
+uint32_t crcCompute2(const void *first, uint32_t firstLen, const void *second, uint32_t secondLen);
+
+#endif /* INC_CRC_H_ */
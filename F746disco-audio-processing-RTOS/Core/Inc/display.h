@@ -0,0 +1,51 @@
+/*
+ * display.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Display task: the only user of the LCD once the scheduler runs. Other tasks, and the audio path, post draw
+ * commands that it renders once per frame (see display.c).
+ */
+
+#ifndef INC_DISPLAY_H_
+#define INC_DISPLAY_H_
+
+#include "stdint.h"
+#include "bsp/disco_lcd.h"
+
+#define DISPLAY_OK			((uint8_t)0)
+#define DISPLAY_FULL		((uint8_t)1)	// the command was dropped
+
+#define DISPLAY_TEXT_LEN	67		// longest text, in characters
+#define DISPLAY_COLUMN_MAX	128		// tallest column, in pixels
+
+// command flags:
+#define DISPLAY_OUTLINE		0x01	// rectangle: outline only, else filled
+#define DISPLAY_OPAQUE		0x02	// text: background color behind the glyphs, else transparent
+#define DISPLAY_CENTER		0x04	// text: centered on the screen width, "x" being an offset (see LCD_DrawString())
+#define DISPLAY_BLEND		0x08	// image: blended over what is below with its alpha, else copied
+
+typedef struct {
+	uint32_t frames;		// rendered so far
+	uint32_t commands;		// received so far
+	uint32_t coalesced;		// not rendered, because a later command of the same frame covered them
+	uint32_t dropped;		// queue full
+	uint16_t depth;			// commands pending now
+	uint16_t maxDepth;		// highest depth so far
+	uint32_t renderUs;		// last frame, excluding the wait for the vertical blanking
+	uint32_t maxRenderUs;
+} display_stats_t;
+
+void displayInit(void);
+
+// any task or interrupt, never block:
+uint8_t displayRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t color, uint8_t flags);
+uint8_t displayText(uint16_t x, uint16_t y, const char *text, sFONT *font, uint32_t color, uint32_t backColor, uint8_t flags);
+uint8_t displayColumn(uint16_t x, uint16_t y, const uint16_t *pixels, uint16_t h);
+uint8_t displayMeter(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t value, uint32_t color, uint32_t backColor);
+uint8_t displayImage(uint16_t x, uint16_t y, const LCD_ImageTypeDef *image, uint8_t flags);
+
+void displayFlush(void);
+void displayGetStats(display_stats_t *s);
+
+#endif /* INC_DISPLAY_H_ */
@@ -0,0 +1,39 @@
+/*
+ * images.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * JPEG image loader with a cache of decoded images in SDRAM, see images.c.
+ */
+
+#ifndef INC_IMAGES_H_
+#define INC_IMAGES_H_
+
+#include "stdint.h"
+#include "bsp/disco_lcd.h"
+
+#define IMAGES_OK			((uint8_t)0)	// decoded, in the cache
+#define IMAGES_PENDING		((uint8_t)1)	// queued or being decoded
+#define IMAGES_ERROR		((uint8_t)2)	// not found, or cannot be decoded
+#define IMAGES_FULL			((uint8_t)3)	// all the slots are being loaded, try again later
+
+#define IMAGES_MAX_WIDTH	LCD_SCREEN_WIDTH	// larger images are scaled down, then cropped (see jpegdec.c)
+#define IMAGES_MAX_HEIGHT	LCD_SCREEN_HEIGHT
+
+typedef struct {
+	uint32_t hits;			// imagesGet() found the image decoded
+	uint32_t misses;		// imagesGet() had to queue the image
+	uint32_t decodes;		// successful decodes
+	uint32_t failures;		// failed decodes
+	uint32_t evictions;		// decoded images dropped to make room
+	uint32_t lastDecodeMs;
+	uint32_t maxDecodeMs;
+	uint32_t heapPeak;		// highest JPEG decoder heap use, in bytes (out of JPEG_HEAP_SIZE_BYTES)
+} images_stats_t;
+
+void imagesInit(void);
+uint8_t imagesGet(const char *name, LCD_ImageTypeDef *image);
+uint8_t imagesRequest(const char *name);
+void imagesGetStats(images_stats_t *s);
+
+#endif /* INC_IMAGES_H_ */
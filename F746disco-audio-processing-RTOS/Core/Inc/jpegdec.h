@@ -0,0 +1,32 @@
+/*
+ * jpegdec.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * JPEG to RGB565 decoder on top of libjpeg, see jpegdec.c. Only depends on the C library and libjpeg (with the
+ * configuration of LIBJPEG/Target), hence it also builds on the host (see tools/jpegcheck.c).
+ */
+
+#ifndef INC_JPEGDEC_H_
+#define INC_JPEGDEC_H_
+
+#include <stdio.h>
+#include "stdint.h"
+#include "jpeglib.h"
+
+#define JPEGDEC_OK			((uint8_t)0)
+#define JPEGDEC_ERROR		((uint8_t)1)	// not a JPEG file, corrupted data, or not enough memory (see heapFailures)
+
+typedef struct {
+	uint32_t width, height;			// of the JPEG image
+	uint32_t outWidth, outHeight;	// of the decoded image, after scaling and cropping
+	uint32_t scaleNum;				// the image was scaled by scaleNum / 8
+	uint32_t heapPeak;				// bytes of decoder heap used at the peak
+	uint32_t heapFailures;			// allocations refused because the heap was full
+} jpegdec_info_t;
+
+void jpegdecInit(void *heap, uint32_t heapSize);
+uint8_t jpegdecDecodeMem(const uint8_t *data, uint32_t size, uint16_t *pixels, uint32_t maxWidth, uint32_t maxHeight, jpegdec_info_t *info);
+uint8_t jpegdecDecodeFile(JFILE *file, uint16_t *pixels, uint32_t maxWidth, uint32_t maxHeight, jpegdec_info_t *info);
+
+#endif /* INC_JPEGDEC_H_ */
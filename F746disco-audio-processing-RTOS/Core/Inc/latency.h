@@ -0,0 +1,35 @@
+/*
+ * latency.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Round-trip (ADC -> DSP -> DAC) latency measurement with a loopback cable from the headphone output to the line input.
+ */
+
+#ifndef INC_LATENCY_H_
+#define INC_LATENCY_H_
+
+#include "stdint.h"
+#include "bsp/disco_sai.h"
+
+#define LATENCY_OK			((uint8_t)0)
+#define LATENCY_BUSY		((uint8_t)1)
+#define LATENCY_TIMEOUT		((uint8_t)2)
+#define LATENCY_NO_PEAK		((uint8_t)3)
+
+typedef struct {
+	uint32_t rate;			// nominal sampling rate, in Hz
+	uint32_t blockFrames;	// frames per processed block (AUDIO_BUF_SIZE / 2, fixed at build time)
+	float samples;			// round-trip latency, in frames (sub-sample accuracy)
+	float us;				// same, in microseconds
+	float peakRatio;		// correlation peak / RMS of the correlation: confidence of the detection
+} latency_result_t;
+
+// audio task side:
+uint8_t latencyProcessFrame(const audio_sample_t *in, audio_sample_t *out, uint32_t sampleCount);
+
+// control task side:
+uint8_t latencyMeasure(latency_result_t *result);
+void latencyMeasureAll(void);
+
+#endif /* INC_LATENCY_H_ */
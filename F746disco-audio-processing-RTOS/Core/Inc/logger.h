@@ -0,0 +1,30 @@
+/*
+ * logger.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Deferred logging, safe and cheap from interrupts and from the audio task, and non-blocking printf() (see logger.c).
+ */
+
+#ifndef INC_LOGGER_H_
+#define INC_LOGGER_H_
+
+#include "stdint.h"
+
+#define LOG_MAX_ARGS	4
+
+/**
+ * LOG("format", args...): posts a message, formatted later by the logger task.
+ * At most LOG_MAX_ARGS integer or pointer arguments (no floats); a "%s" argument must point to a string that
+ * outlives the message, e.g. a literal. The format string itself must be a literal.
+ */
+#define LOG(...)		loggerWrite(LOG_NARGS(__VA_ARGS__), __VA_ARGS__)
+
+#define LOG_NARGS(...)	LOG_NARGS_(__VA_ARGS__, LOG_TOO_MANY_ARGUMENTS, 4, 3, 2, 1, 0, 0)
+#define LOG_NARGS_(fmt, _1, _2, _3, _4, _5, n, ...)	n
+
+void loggerInit(void);
+void loggerWrite(int nargs, const char *fmt, ...);
+uint32_t loggerGetDropped(void);
+
+#endif /* INC_LOGGER_H_ */
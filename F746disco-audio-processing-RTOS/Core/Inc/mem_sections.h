@@ -0,0 +1,38 @@
+/*
+ * mem_sections.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Placement of hot code and data in the tightly-coupled memories (see the linker script and the startup code):
+ *
+ * 		ITCM	0x00000000, 16kbytes	zero-wait-state instruction memory, not cached: ITCM_CODE functions,
+ * 										plus the CMSIS-DSP kernels listed in .itcm_text in STM32F746NGHX_FLASH.ld
+ * 		DTCM	0x20000000, 64kbytes	zero-wait-state data memory, not cached: DTCM_DATA and DTCM_BSS variables,
+ * 										placed first in RAM (the rest of the DTCM then holds ordinary .data and .bss)
+ *
+ * ITCM_CODE functions and DTCM_DATA variables are copied from the flash by Reset_Handler, DTCM_BSS variables are zeroed.
+ * Calls b/w the flash and the ITCM are beyond the range of a BL instruction: the linker inserts long branch veneers,
+ * hence ITCM_CODE is meant for functions that loop over a whole frame, not for tiny functions called per sample.
+ * DMA buffers still belong in .dma_buffers (see DMA_BUFFER in mpu.h).
+ *
+ * What landed where: run tools/memreport on the .map file after each build.
+ * Savings per frame: build with AUDIO_PROFILE (see audio.c), with and without TCM_DISABLE below.
+ */
+
+#ifndef INC_MEM_SECTIONS_H_
+#define INC_MEM_SECTIONS_H_
+
+// uncomment to leave ITCM_CODE functions in flash and DTCM_* variables in ordinary RAM (the CMSIS-DSP kernels stay in ITCM)
+//#define TCM_DISABLE
+
+#ifndef TCM_DISABLE
+#define ITCM_CODE		__attribute__((section(".itcm_text")))
+#define DTCM_DATA		__attribute__((section(".dtcm_data")))
+#define DTCM_BSS		__attribute__((section(".dtcm_bss")))
+#else
+#define ITCM_CODE
+#define DTCM_DATA
+#define DTCM_BSS
+#endif
+
+#endif /* INC_MEM_SECTIONS_H_ */
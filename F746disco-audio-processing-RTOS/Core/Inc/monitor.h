@@ -0,0 +1,40 @@
+/*
+ * monitor.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Remote audio monitor: the output of the effect chain, IMA-ADPCM coded and sent as telemetry frames (see monitor.c).
+ * The frame layout below must match tools/tlm.h.
+ */
+
+#ifndef INC_MONITOR_H_
+#define INC_MONITOR_H_
+
+#include "stdint.h"
+#include "stddef.h"
+#include <adpcm.h>
+#include <telemetry.h>
+#include "bsp/disco_sai.h"
+
+#define MONITOR_BLOCK_FRAMES	256		// frames per telemetry frame
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	uint32_t sampleRate;
+	uint32_t position;				// index of the first frame, counted from monitorStart(): a gap means lost frames
+	uint16_t frames;				// up to MONITOR_BLOCK_FRAMES
+	uint8_t channels;				// 2
+	uint8_t reserved;
+	adpcm_state_t state[2];			// decoder state before the first frame, left and right
+	uint8_t data[MONITOR_BLOCK_FRAMES];	// one byte per frame: left code in the low nibble, right code in the high one
+} tlm_audio_t;
+
+#define MONITOR_FRAME_LEN(frames)	(offsetof(tlm_audio_t, data) + (frames))
+
+void monitorInit(void);
+void monitorStart(void);
+void monitorStop(void);
+uint32_t monitorGetOverruns(void);
+void monitorPushBlock(const audio_sample_t *buf, uint32_t sampleCount, uint32_t sampleRate);
+
+#endif /* INC_MONITOR_H_ */
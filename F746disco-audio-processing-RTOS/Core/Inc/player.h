@@ -0,0 +1,30 @@
+/*
+ * player.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * WAV file player used as an alternative audio input: a reader task streams the file
+ * from the SD-card into an SDRAM read-ahead ring, the audio task only reads from the ring.
+ */
+
+#ifndef INC_PLAYER_H_
+#define INC_PLAYER_H_
+
+#include "stdint.h"
+#include "bsp/disco_sai.h"
+
+#define PLAYER_OK			((uint8_t)0)
+#define PLAYER_BUSY			((uint8_t)1)
+#define PLAYER_ERROR		((uint8_t)2)
+
+void playerInit(void);
+uint8_t playerStart(const char *path, uint8_t loop);
+void playerStop(void);
+void playerSeek(uint32_t ms);
+uint8_t playerIsPlaying(void);
+uint8_t playerIsActive(void);
+uint32_t playerGetSampleRate(void);
+uint32_t playerGetUnderruns(void);
+const audio_sample_t* playerSource(const audio_sample_t *live, uint32_t sampleCount);
+
+#endif /* INC_PLAYER_H_ */
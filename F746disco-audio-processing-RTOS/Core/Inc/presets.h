@@ -0,0 +1,24 @@
+/*
+ * presets.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Persistent effect settings: append-only log in the top of the QSPI flash (see QSPI_SETTINGS_SIZE in disco_base.h).
+ */
+
+#ifndef INC_PRESETS_H_
+#define INC_PRESETS_H_
+
+#include "stdint.h"
+#include <audio.h>
+
+#define PRESETS_OK			((uint8_t)0)
+#define PRESETS_EMPTY		((uint8_t)1)
+#define PRESETS_ERROR		((uint8_t)2)
+
+uint8_t presetsInit(void);
+uint8_t presetsSave(const audio_settings_t *s);
+uint8_t presetsSaveCurrent(void);
+void presetsService(void);
+
+#endif /* INC_PRESETS_H_ */
@@ -0,0 +1,27 @@
+/*
+ * recorder.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Non-blocking WAV recorder: the audio task pushes blocks into an SDRAM ring,
+ * a low-priority writer task flushes them to the SD-card.
+ */
+
+#ifndef INC_RECORDER_H_
+#define INC_RECORDER_H_
+
+#include "stdint.h"
+#include "bsp/disco_sai.h"
+
+#define RECORDER_OK			((uint8_t)0)
+#define RECORDER_BUSY		((uint8_t)1)
+#define RECORDER_ERROR		((uint8_t)2)
+
+void recorderInit(void);
+uint8_t recorderStart(const char *path, uint32_t sampleRate, uint32_t maxSeconds);
+void recorderStop(void);
+uint8_t recorderIsRecording(void);
+uint32_t recorderGetOverruns(void);
+void recorderPushBlock(const audio_sample_t *buf, uint32_t sampleCount);
+
+#endif /* INC_RECORDER_H_ */
@@ -64,6 +64,9 @@ void DCMI_IRQHandler(void);
 void DMA2D_IRQHandler(void);
 void QUADSPI_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void SDMMC1_IRQHandler(void);
+void DMA2_Stream3_IRQHandler(void);
+void DMA2_Stream6_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -0,0 +1,69 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Binary telemetry stream on USART6 (Arduino D1): level meters, spectrum and frame timing (see telemetry.c).
+ * The frame layouts below must match tools/tlm.h.
+ */
+
+#ifndef INC_TELEMETRY_H_
+#define INC_TELEMETRY_H_
+
+#include "stdint.h"
+
+#define TELEMETRY_VERSION		1
+#define TELEMETRY_BAUD			2000000
+#define TELEMETRY_SPECTRUM_BINS	32
+#define TELEMETRY_MAX_FRAME		320		// largest frame, header included
+
+#define TELEMETRY_OK			((uint8_t)0)
+#define TELEMETRY_BUSY			((uint8_t)1)
+#define TELEMETRY_ERROR			((uint8_t)2)
+
+// frame types:
+#define TLM_METERS			((uint8_t)1)
+#define TLM_SPECTRUM		((uint8_t)2)
+#define TLM_TIMING			((uint8_t)3)
+#define TLM_AUDIO			((uint8_t)4)	// see monitor.h
+
+// all fields little-endian, floats are IEEE 754 single precision:
+typedef struct __attribute__((packed)) {
+	uint8_t type;
+	uint8_t version;		// TELEMETRY_VERSION
+	uint16_t seq;			// incremented at each frame, whatever its type
+	uint32_t tick;			// ms
+} tlm_header_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	float levelL;			// average absolute level, relative to full scale (see accumulateInputLevels() in audio.c)
+	float levelR;
+} tlm_meters_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	uint32_t sampleRate;
+	float bins[TELEMETRY_SPECTRUM_BINS];	// magnitudes, each the maximum of FFT_Length / 2 / TELEMETRY_SPECTRUM_BINS FFT bins
+} tlm_spectrum_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	uint32_t cpuHz;
+	uint32_t frameCycles;
+	uint32_t frameCyclesMax;
+	uint32_t periodCycles;
+	uint32_t wakeCyclesMax;
+	uint32_t lateFrames;
+	uint32_t marginWarnings;
+	uint32_t slips;
+	uint32_t missedWakeups;
+} tlm_timing_t;
+
+void telemetryInit(void);
+void telemetrySetRate(uint32_t hz);
+uint8_t telemetrySend(void *frame, uint32_t len, uint8_t type);
+uint32_t telemetryGetDropped(void);
+void telemetryTxDone(void);
+
+#endif /* INC_TELEMETRY_H_ */
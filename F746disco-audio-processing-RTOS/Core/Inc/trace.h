@@ -0,0 +1,61 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Binary event trace: timestamped records of context switches, audio IRQs and processing stages in an SDRAM ring,
+ * dumped on the VCP on demand (see trace.c). Decode the dump with tools/trace2json.c.
+ */
+
+#ifndef INC_TRACE_H_
+#define INC_TRACE_H_
+
+#include "stdint.h"
+
+#define TRACE_ENABLE	// comment out to compile all trace points out (the FreeRTOS hooks included)
+
+// record types:
+#define TRACE_TASK_IN		((uint8_t)1)	// id: task number (see uxTaskGetSystemState())
+#define TRACE_TASK_OUT		((uint8_t)2)
+#define TRACE_IRQ			((uint8_t)3)	// id: trace_irq_t, arg: IRQ-specific
+#define TRACE_BEGIN			((uint8_t)4)	// id: trace_stage_t, arg: stage-specific (e.g. the effect id)
+#define TRACE_END			((uint8_t)5)
+#define TRACE_MARK			((uint8_t)6)	// id: trace_mark_t, arg: mark-specific
+
+typedef enum {
+	TRACE_IRQ_SAI_RX = 0	// arg: half of the input buffer just filled
+} trace_irq_t;
+
+typedef enum {
+	TRACE_STAGE_FRAME = 0,	// processFrame() as a whole
+	TRACE_STAGE_EFFECT,		// arg: effect_id_t
+	TRACE_STAGE_FFT
+} trace_stage_t;
+
+typedef enum {
+	TRACE_MARK_XRUN = 0,	// arg: late frames so far
+	TRACE_MARK_MISSED		// arg: missed wake-ups so far
+} trace_mark_t;
+
+/**
+ * One record, 8 bytes. Must match tools/trace2json.c.
+ */
+typedef struct {
+	uint32_t cycles;	// DWT cycle counter
+	uint8_t type;
+	uint8_t id;
+	uint16_t arg;
+} trace_record_t;
+
+#ifdef TRACE_ENABLE
+#define TRACE(type, id, arg)	traceRecord((type), (id), (arg))
+#else
+#define TRACE(type, id, arg)
+#endif
+
+void traceRecord(uint8_t type, uint8_t id, uint16_t arg);
+void traceTrigger(void);
+void traceService(void);
+void traceDump(void);
+
+#endif /* INC_TRACE_H_ */
@@ -9,9 +9,15 @@
 #define INC_UI_H_
 
 #include "bsp/disco_lcd.h"
+#include "stdint.h"
 
 
 void uiDisplayBasic(void);
 void uiDisplayInputLevel(double inputLevelL, double inputLevelR);
+void uiDisplayRate(uint32_t rate);
+void uiDisplayInput(uint16_t device);
+void uiDisplayLatency(int row, const char *text);
+void uiDisplayCpuLoad(void);
+void uiHandleTouch(void);
 
 #endif /* INC_UI_H_ */
@@ -0,0 +1,84 @@
+/*
+ * adpcm.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === IMA-ADPCM codec ===
+ *
+ * Each 16-bit sample is coded as a 4-bit step count relative to the previous reconstructed sample (the predictor),
+ * the step size adapting to the signal through a table of 89 sizes. The encoder reconstructs every sample exactly as the
+ * decoder does, so both stay in lockstep as long as the decoder starts from the same state (adpcm_state_t, 4 bytes):
+ * sending the state along with each block of codes lets a decoder start at any block, e.g. after a lost one.
+ *
+ * Coding costs a few tens of cycles per sample, without multiplication or division.
+ */
+
+#include <adpcm.h>
+
+static const int16_t stepTable[89] = { 7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449,
+		494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+		3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818,
+		18500, 20350, 22385, 24623, 27086, 29794, 32767 };
+
+static const int8_t indexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/**
+ * Reconstructs the sample coded by "code" (4 bits) and updates the state. Shared by the encoder and the decoder.
+ */
+static int16_t step(adpcm_state_t *s, uint8_t code) {
+
+	int32_t st = stepTable[s->index];
+	int32_t diff = st >> 3;
+	int32_t p = s->predictor;
+	int32_t index = s->index + indexTable[code];
+
+	if (code & 4)
+		diff += st;
+	if (code & 2)
+		diff += st >> 1;
+	if (code & 1)
+		diff += st >> 2;
+	p += (code & 8) ? -diff : diff;
+
+	s->predictor = (int16_t) (p > 32767 ? 32767 : p < -32768 ? -32768 : p);
+	s->index = (uint8_t) (index < 0 ? 0 : index > 88 ? 88 : index);
+	return s->predictor;
+}
+
+/**
+ * Returns the 4-bit code of "sample", and updates the state.
+ */
+uint8_t adpcmEncode(adpcm_state_t *s, int16_t sample) {
+
+	int32_t st = stepTable[s->index];
+	int32_t diff = sample - s->predictor;
+	uint8_t code = 0;
+
+	if (diff < 0) {
+		code = 8;
+		diff = -diff;
+	}
+	if (diff >= st) {
+		code |= 4;
+		diff -= st;
+	}
+	if (diff >= st >> 1) {
+		code |= 2;
+		diff -= st >> 1;
+	}
+	if (diff >= st >> 2)
+		code |= 1;
+
+	step(s, code);
+	return code;
+}
+
+/**
+ * Returns the sample coded by "code" (4 bits), and updates the state.
+ */
+int16_t adpcmDecode(adpcm_state_t *s, uint8_t code) {
+
+	return step(s, code & 0x0F);
+}
@@ -0,0 +1,98 @@
+/*
+ * arena.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Tiered arena allocator ===
+ *
+ * Effects get their buffers and state from three pools, from the fastest and smallest to the slowest and largest
+ * (see arena_tier_t). Each pool is a bump allocator: arenaAlloc() only advances an offset, there is no per-block free.
+ * The whole chain is built at once, before the streams run or while the audio task doesn't use the chain,
+ * and torn down at once with arenaReset(): never allocate from the audio task while it processes a frame.
+ *
+ * A request that doesn't fit in its pool is refused (NULL) rather than moved to another tier, so that a configuration
+ * never silently ends up slower than designed: the caller decides whether to fall back or to reject the configuration.
+ * High-water marks and refused requests are kept per pool, see arenaReport().
+ */
+
+#include <arena.h>
+#include <stdio.h>
+#include "string.h"
+
+// ----------- Local vars ------------
+
+static arena_pool_t pools[ARENA_TIERS];
+
+// ----------- Functions ------------
+
+/**
+ * Hands the memory [base, base + size) over to the pool of the given tier, which becomes empty.
+ */
+void arenaInitPool(arena_tier_t tier, const char *name, void *base, uint32_t size) {
+
+	if (tier >= ARENA_TIERS)
+		return;
+
+	pools[tier].name = name;
+	pools[tier].base = (uint8_t*) base;
+	pools[tier].size = base ? size : 0;
+	pools[tier].used = 0;
+	pools[tier].highWater = 0;
+	pools[tier].failures = 0;
+}
+
+/**
+ * Returns "size" bytes from the pool of the given tier, aligned on "align" bytes (a power of 2, e.g. 32 for a cache line),
+ * or NULL if they don't fit. The memory is not cleared.
+ */
+void* arenaAlloc(arena_tier_t tier, uint32_t size, uint32_t align) {
+
+	if (tier >= ARENA_TIERS)
+		return NULL;
+
+	arena_pool_t *p = &pools[tier];
+
+	if (align == 0 || (align & (align - 1)))
+		align = sizeof(uint32_t);
+
+	uintptr_t start = ((uintptr_t) p->base + p->used + align - 1) & ~(uintptr_t) (align - 1);
+	uintptr_t offset = start - (uintptr_t) p->base;
+
+	if (p->base == NULL || size > p->size || offset > p->size - size) {
+		p->failures++;
+		return NULL;
+	}
+
+	p->used = offset + size;
+	if (p->used > p->highWater)
+		p->highWater = p->used;
+
+	return (void*) start;
+}
+
+/**
+ * Empties all pools (high-water marks are kept).
+ */
+void arenaReset(void) {
+
+	for (int t = 0; t < ARENA_TIERS; t++)
+		pools[t].used = 0;
+}
+
+const arena_pool_t* arenaGetPool(arena_tier_t tier) {
+
+	return tier < ARENA_TIERS ? &pools[tier] : NULL;
+}
+
+/**
+ * Prints the usage of each pool.
+ */
+void arenaReport(void) {
+
+	for (int t = 0; t < ARENA_TIERS; t++) {
+		arena_pool_t *p = &pools[t];
+		printf("arena: %-6s %7lu / %7lu bytes used, high-water %7lu, %lu refused\n", p->name ? p->name : "-",
+				(unsigned long) p->used, (unsigned long) p->size, (unsigned long) p->highWater, (unsigned long) p->failures);
+	}
+}
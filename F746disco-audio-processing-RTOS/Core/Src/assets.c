@@ -0,0 +1,210 @@
+/*
+ * assets.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === QSPI asset store ===
+ *
+ * Impulse responses, wavetables, presets and images are packed on the host by tools/assetpack into a single binary container
+ * (see assets.h for the format), which is programmed at the beginning of the QSPI flash, e.g. with STM32CubeProgrammer
+ * and the STM32F746G-DISCO external loader:
+ *
+ * 		STM32_Programmer_CLI -c port=SWD -el N25Q128A_STM32F746G-DISCO.stldr -w assets.bin 0x90000000
+ *
+ * Since the QSPI flash is memory-mapped (see MX_QUADSPI_Init()) and cacheable (see mpu.c), effects get plain const pointers
+ * into the flash through assetsData() and read the data in place: nothing has to be copied to SDRAM at boot.
+ * Entries are aligned on cache lines, and IRs may be stored as precomputed partition spectra so that a
+ * partitioned convolution doesn't have to run any FFT on the impulse response itself.
+ *
+ * The flash is not mapped while the preset log is written (see presetsSave()), and any read then faults: code reading
+ * the flash (the entry table or asset data) holds assetsLock() meanwhile. The accessors below take it themselves;
+ * the image loader holds it while it decodes (see images.c) and the display task while the DMA2D reads images in place
+ * (see display.c). The audio task never reads the flash.
+ */
+
+#include <assets.h>
+#include <crc.h>
+#include <stdio.h>
+#include "string.h"
+#include "main.h"
+#include "cmsis_os.h"
+#include "bsp/disco_base.h"
+
+#define ASSETS_BASE		(QSPI_DEVICE_ADDR + QSPI_ASSETS_OFFSET)
+
+static const asset_header_t *header = NULL; // NULL as long as no valid container was found
+static const asset_entry_t *entries;
+static osMutexId qspiMutex = NULL; // see assetsLock()
+
+/**
+ * Validates the container header and entry table. Must be called after MX_QUADSPI_Init() and crcInit().
+ * Returns the number of assets available (0 if the QSPI flash holds no valid container).
+ * Asset data themselves are not checked here (see assetsVerify()), hence this takes only a few microseconds.
+ */
+uint16_t assetsInit(void) {
+
+	const asset_header_t *h = (const asset_header_t*) ASSETS_BASE;
+	const asset_entry_t *e = (const asset_entry_t*) (ASSETS_BASE + sizeof(asset_header_t));
+
+	header = NULL;
+	if (qspiMutex == NULL) {
+		osMutexDef(qspi);
+		qspiMutex = osRecursiveMutexCreate(osMutex(qspi));
+	}
+
+	if (h->magic != ASSETS_MAGIC || h->version != ASSETS_VERSION || h->totalSize > QSPI_ASSETS_MAXSZ_BYTES) {
+		printf("assets: no asset store in QSPI flash\n");
+		return 0;
+	}
+
+	uint32_t tableSize = h->count * sizeof(asset_entry_t);
+	if (sizeof(asset_header_t) + tableSize > h->totalSize
+			|| crcCompute(e, tableSize) != h->tableCrc) {
+		printf("assets: corrupted entry table\n");
+		return 0;
+	}
+
+	for (int i = 0; i < h->count; i++) {
+		if ((e[i].offset % ASSETS_ALIGN) || e[i].offset + e[i].size > h->totalSize || e[i].offset + e[i].size < e[i].offset) {
+			printf("assets: entry %d out of bounds\n", i);
+			return 0;
+		}
+	}
+
+	header = h;
+	entries = e;
+	printf("assets: %d assets, %lu bytes\n", h->count, h->totalSize);
+	return h->count;
+}
+
+/**
+ * Takes the ownership of the memory-mapped QSPI flash: while held, presetsSave() can't unmap it. Recursive.
+ * Tasks only; no-op before the scheduler is started, when nothing runs concurrently.
+ */
+void assetsLock(void) {
+
+	if (qspiMutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+		osRecursiveMutexWait(qspiMutex, osWaitForever);
+}
+
+void assetsUnlock(void) {
+
+	if (qspiMutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+		osRecursiveMutexRelease(qspiMutex);
+}
+
+/**
+ * Looks up an asset by name and type. Returns NULL if not found.
+ * The entry lives in the flash: hold assetsLock() while reading it, or its data.
+ */
+const asset_entry_t* assetsFind(const char *name, asset_type_t type) {
+
+	const asset_entry_t *e = NULL;
+
+	if (header == NULL)
+		return NULL;
+
+	assetsLock();
+	for (int i = 0; i < header->count && e == NULL; i++) {
+		if (entries[i].type == type && strncmp(entries[i].name, name, ASSETS_NAME_LEN) == 0)
+			e = &entries[i];
+	}
+	assetsUnlock();
+	return e;
+}
+
+/**
+ * Zero-copy access: returns a pointer to the asset data in the memory-mapped QSPI flash.
+ */
+const void* assetsData(const asset_entry_t *entry) {
+
+	return (const void*) (ASSETS_BASE + entry->offset);
+}
+
+/**
+ * Checks the CRC of the asset data (reads the whole asset from the flash, so this is not meant for the audio task).
+ * The CRC unit is shared with presets.c and telemetry.c (see crc.c): they wait meanwhile.
+ */
+uint8_t assetsVerify(const asset_entry_t *entry) {
+
+	assetsLock();
+	uint8_t ok = crcCompute(assetsData(entry), entry->size) == entry->crc;
+	assetsUnlock();
+	return ok;
+}
+
+/**
+ * Copies the entry out of the flash, so that it can be read without holding assetsLock(). Returns 0 if not found.
+ */
+static uint8_t findCopy(const char *name, asset_type_t type, asset_entry_t *copy, const void **data) {
+
+	assetsLock();
+	const asset_entry_t *e = assetsFind(name, type);
+	if (e != NULL) {
+		*copy = *e;
+		*data = assetsData(e);
+	}
+	assetsUnlock();
+	return e != NULL;
+}
+
+/**
+ * Convenience accessor for partitioned convolution: returns the packed arm_rfft_fast_f32() spectra of the IR partitions,
+ * partitionCount blocks of 2 * partitionLength floats each, or NULL if there is no such IR.
+ */
+const float* assetsGetIRPartitions(const char *name, uint32_t *partitionLength, uint32_t *partitionCount) {
+
+	asset_entry_t e;
+	const void *data;
+
+	if (!findCopy(name, ASSET_IR_PARTITIONS, &e, &data) || e.size != e.param0 * e.param1 * 2 * sizeof(float))
+		return NULL;
+
+	*partitionLength = e.param0;
+	*partitionCount = e.param1;
+	return (const float*) data;
+}
+
+/**
+ * Looks up an image, checks its size against its format, and returns its pixels (NULL if not found or inconsistent).
+ * For ASSET_IMAGE_L8, *clut points to the palette of *clutSize colors, else it is NULL.
+ */
+const void* assetsGetImage(const char *name, uint32_t *width, uint32_t *height, uint32_t *format, const uint32_t **clut, uint32_t *clutSize) {
+
+	asset_entry_t e;
+	const void *data;
+	uint32_t bpp, clutBytes = 0;
+
+	if (!findCopy(name, ASSET_IMAGE, &e, &data))
+		return NULL;
+
+	*width = e.param0 & 0xFFFF;
+	*height = e.param0 >> 16;
+	*format = e.param1 & 0xFFFF;
+	*clutSize = e.param1 >> 16;
+
+	switch (*format) {
+	case ASSET_IMAGE_ARGB8888:
+		bpp = 4;
+		break;
+	case ASSET_IMAGE_RGB565:
+	case ASSET_IMAGE_ARGB4444:
+		bpp = 2;
+		break;
+	case ASSET_IMAGE_L8:
+		bpp = 1;
+		if (*clutSize == 0 || *clutSize > 256)
+			return NULL;
+		clutBytes = (*clutSize * 4 + ASSETS_ALIGN - 1) & ~(ASSETS_ALIGN - 1);
+		break;
+	default:
+		return NULL;
+	}
+
+	if (e.size != clutBytes + *width * *height * bpp)
+		return NULL;
+
+	*clut = clutBytes ? (const uint32_t*) data : NULL;
+	return (const uint8_t*) data + clutBytes;
+}
@@ -19,6 +19,8 @@
  * - HAL_SAI_RxHalfCpltCallback() gets called whenever the receive (=input) buffer is half-full
  * - HAL_SAI_RxCpltCallback() gets called whenever the receive (=input) buffer is full
  *
+ * Samples are audio_sample_t, i.e. int16_t, or int32_t holding 24-bit samples if AUDIO_SAMPLE_24IN32 is defined (see disco_sai.h).
+ *
  * As a result, one audio frame has a size of AUDIO_DMA_BUF_SIZE/2. But since one audio frame
  * contains interleaved L and R stereo samples, its true duration is AUDIO_DMA_BUF_SIZE/4.
  *
@@ -41,17 +43,53 @@
  *  The variable is written by HAL_SAI_RxHalfCpltCallback() and HAL_SAI_RxCpltCallback() audio in DMA transfer callbacks.
  *  It is read inside the main audio loop (see audioLoop()).
  *
- *  If RTOS is to used, Signals may be used to communicate between the DMA IRQ Handler and the main audio loop audioloop().
+ *  With the RTOS, the audio loop runs in its own task (see audioInit()), at the highest application priority,
+ *  and each RX callback records which half has just been filled (rxHalf) and wakes the task up with a direct-to-task
+ *  notification (vTaskNotifyGiveFromISR()), the lightest wake-up path FreeRTOS offers. The notification value counts
+ *  the callbacks: more than one pending when the task wakes up means a frame was missed (see missedWakeups).
+ *  The IRQ-to-task wake-up latency is measured at each frame with the cycle counter (see wakeHist and audioReportMonitor()).
+ *
+ * === RX/TX phase and output slip buffer ===
+ *
+ *  Each RX callback wakes the audio task up, which processes the input half-buffer that has just been received.
+ *  The processed frame is then copied into buf_output at writePos, which is advanced by one frame each time:
+ *  buf_output is thus used as a ring ("slip buffer") whose write position is not tied to the half-buffers.
+ *
+ *  With both streams in phase, writePos is the beginning of the half the output DMA will read next, i.e. the margin
+ *  (number of samples the output DMA still has to transmit before it reaches writePos) is one frame when processing starts,
+ *  and the processing deadline is that margin. The margin is checked at each frame: it gets smaller if the streams drift
+ *  apart (see saiMonitorSample() in disco_sai.c), and a warning is counted whenever it drops below AUDIO_MARGIN_MIN.
+ *  If AUDIO_OUTPUT_SLIP is defined, writePos is then moved back to one frame ahead of the output DMA,
+ *  at the cost of one discontinuity in the output.
+ *
+ * === In-place processing (AUDIO_IN_PLACE, see disco_sai.h) ===
+ *
+ *  buf_output is then an alias of buf_input: each half is processed in place right after it has been received,
+ *  and the output DMA transmits it during the next frame but one, just ahead of the input DMA that overwrites it.
+ *  writePos is always the half being processed, and the margin is checked as above. The buffer is in the non-cacheable
+ *  RAM_DMA section (DMA_BUFFER, see mpu.h), as the separate buffers are: the CPU reads what the input DMA wrote and the
+ *  output DMA reads what the CPU wrote without any D-cache maintenance.
  *
  */
 
 #include <audio.h>
 #include <ui.h>
+#include <recorder.h>
+#include <monitor.h>
+#include <player.h>
+#include <latency.h>
+#include <arena.h>
+#include <trace.h>
+#include <logger.h>
 #include <stdio.h>
 #include "string.h"
 #include <math.h>
+#include "main.h"
 #include "bsp/disco_sai.h"
 #include "bsp/disco_base.h"
+#include "bsp/mpu.h"
+#include "bsp/dwt.h"
+#include "mem_sections.h"
 #include "cmsis_os.h"
 #include "arm_math.h"
 
@@ -60,9 +98,22 @@ extern SAI_HandleTypeDef hsai_BlockB2;
 extern DMA_HandleTypeDef hdma_sai2_a;
 extern DMA_HandleTypeDef hdma_sai2_b;
 
-extern osThreadId defaultTaskHandle;
 extern osThreadId uiTaskHandle;
 
+// ---------- Audio task and wake-up from the RX DMA callbacks ----------
+
+#define AUDIO_TASK_PRIORITY		osPriorityRealtime	// highest application priority (osPriorityNormal: that of the former default task)
+//#define AUDIO_WAKE_SIGNAL							// former wake-up path (osSignalSet()/osSignalWait()), to compare wake-up latencies
+
+#define WAKE_HIST_BINS	8	// IRQ-to-task wake-up latency, bin i counts latencies < 2^i us, the last one everything above
+
+static osThreadId audioTaskHandle;
+static volatile uint8_t rxHalf;				// half of buf_input just filled by the RX DMA: 0 = first, 1 = second
+static volatile uint32_t rxIrqCycles;		// DWT_CYCLES() at the last RX callback
+static uint32_t wakeHist[WAKE_HIST_BINS];
+static uint32_t wakeCyclesMax = 0;
+static uint32_t missedWakeups = 0;			// RX callbacks the audio task woke up too late for
+
 // ---------- communication b/w DMA IRQ Handlers and the main while loop -------------
 
 //typedef enum {
@@ -83,37 +134,94 @@ extern osThreadId uiTaskHandle;
 #define FFT_Length (AUDIO_BUF_SIZE / 2)
 
 
-// DMA buffers are in embedded RAM:
-int16_t buf_input[AUDIO_DMA_BUF_SIZE];
-int16_t buf_output[AUDIO_DMA_BUF_SIZE];
-int16_t *buf_input_half = buf_input + AUDIO_DMA_BUF_SIZE / 2;
-int16_t *buf_output_half = buf_output + AUDIO_DMA_BUF_SIZE / 2;
+// DMA buffers are in the non-cacheable part of the embedded RAM (see mpu.h):
+#ifdef AUDIO_IN_PLACE
+// a single buffer shared by both DMA streams, see processFrame():
+DMA_BUFFER audio_sample_t buf_input[AUDIO_DMA_BUF_SIZE];
+#define buf_output buf_input
+#else
+DMA_BUFFER audio_sample_t buf_input[AUDIO_DMA_BUF_SIZE];
+DMA_BUFFER audio_sample_t buf_output[AUDIO_DMA_BUF_SIZE];
+#endif
+audio_sample_t *buf_input_half = buf_input + AUDIO_DMA_BUF_SIZE / 2;
+audio_sample_t *buf_output_half = buf_output + AUDIO_DMA_BUF_SIZE / 2;
+
+// the effect chain works on normalized floats in [-1, 1), and only saturates when converting back to audio_sample_t:
+static float *frame;	// AUDIO_BUF_SIZE floats in the fast pool, see buildChain()
+
+// ---------- Output slip buffer (see processFrame()) ----------
+
+//#define AUDIO_OUTPUT_SLIP							// restore the margin whenever it gets out of bounds
+#define AUDIO_MARGIN_MIN	(AUDIO_BUF_SIZE / 8)	// in samples
+
+#if defined(AUDIO_OUTPUT_SLIP) && defined(AUDIO_IN_PLACE)
+#error "AUDIO_OUTPUT_SLIP requires separate input and output buffers"
+#endif
+
+#ifndef AUDIO_IN_PLACE
+DTCM_BSS static audio_sample_t outFrame[AUDIO_BUF_SIZE];	// processed frame, before it is copied into buf_output
+#endif
+static uint32_t writePos;						// position in buf_output of the next frame
+static uint8_t writePosValid = 0;				// 0 until the first frame after the streams were (re)started
+static uint32_t marginWarnings = 0;				// margin out of bounds when a frame was about to be processed
+static uint32_t lateFrames = 0;					// output DMA reached writePos before the frame was written
+static uint32_t slips = 0;
+
+// ---------- Profiling (see audioReportMonitor()) ----------
+
+//#define AUDIO_PROFILE		// print the cycle count of processFrame() every 2s
+
+static uint32_t frameCycles = 0;		// last frame
+static uint32_t frameCyclesMax = 0;		// since the last report
+static uint32_t frameCyclesSum = 0;
+static uint32_t frameCount = 0;
+static uint32_t statsCyclesMax = 0;		// since the last audioGetStats()
+static uint32_t statsWakeCyclesMax = 0;
 
 // Définition de la structure pour le calcul de la FFT
-arm_rfft_fast_instance_f32 FFT_struct;
-float32_t aFFT_Output_f32[FFT_Length];
-float32_t aFFT_Input_f32[FFT_Length];
+DTCM_BSS arm_rfft_fast_instance_f32 FFT_struct;
+DTCM_BSS float32_t aFFT_Output_f32[FFT_Length];
+DTCM_BSS float32_t aFFT_Input_f32[FFT_Length];
 
 
-static int pos = 0;
+// ---------- Memory of the effect chain (see arena.c and buildChain()) ----------
+
+#define ARENA_FAST_SIZE		5120	// frame + FFT tables
+#define ARENA_NORMAL_SIZE	1024	// coefficients
+
+DTCM_BSS static uint8_t arenaFast[ARENA_FAST_SIZE] __attribute__((aligned(32)));
+static uint8_t arenaNormal[ARENA_NORMAL_SIZE] __attribute__((aligned(32)));
+// the bulk pool is the SDRAM scratch region, see AUDIO_SCRATCH_ADDR in disco_base.h
 
-// ------------- scratch float buffer for long delays, reverbs or long impulse response FIR based on float implementations ---------
+static float *echoLine = NULL;	// echo delay line (floats, interleaved L/R) in the bulk pool, NULL if it didn't fit
+static uint32_t echoLineLen = 0;	// in samples
 
-uint32_t scratch_offset = 0; // see doc in processAudio()
-#define AUDIO_SCRATCH_SIZE   AUDIO_SCRATCH_MAXSZ_WORDS
+static int pos = 0;
 
 
 
 // ------------ Private Function Prototypes ------------
 
-static void processAudio(int16_t*, int16_t*);
+static void audioTask(void const *argument);
+static uint32_t waitForFrame(void);
+static void processFrame(audio_sample_t *in);
+static void wakeAudioTask(uint8_t half, int32_t signal);
+static uint8_t buildChain(void);
+static void pinFFTTables(arm_rfft_fast_instance_f32 *S);
+static void processAudio(audio_sample_t*, audio_sample_t*);
 static void accumulateInputLevels();
-static float readFromAudioScratch(int pos);
-static void writeToAudioScratch(float val, int pos);
-static void no_effect(int16_t *out, int16_t *in);
-static void echo_effect(int16_t *out, int16_t *in);
-static void overdrive_effect(int16_t *out, int16_t *in);
-static void noise_gate(int16_t *out, int16_t *in);
+static void samplesToFloat(const audio_sample_t *in, float *out, uint32_t n);
+static void samplesFromFloat(float *in, audio_sample_t *out, uint32_t n);
+static void no_effect(float *out, float *in);
+static void echo_effect(float *out, float *in);
+static void overdrive_effect(float *out, float *in);
+static void noise_gate(float *out, float *in);
+static void updateSettings();
+static void configureEffects();
+static void fadeIn(float *buf);
+static void fadeOut(float *buf);
+static void fadeOutAndWait(void);
+static void fadeInAgain(void);
 
 // ----------- Local vars ------------
 
@@ -123,9 +231,70 @@ double inputLevelR = 0;
 double inputLevelL_cp = 0;
 double inputLevelR_cp = 0;
 
+// ----------- Effect settings ------------
+
+// settings in use, only read and written by the audio task:
+static audio_settings_t settings = {
+		.version = AUDIO_SETTINGS_VERSION,
+		.chain = { FX_NONE },
+		.echoDry = 0.4,
+		.echoWet = 0.6,
+		.echoFeedback = 0.4,
+		.echoDelayMs = 800,
+		.gateThreshold = 0.001,
+		.gateAttenuation = 100000 };
+
+// settings posted by other tasks (UI, presets...), picked up by the audio task at the beginning of the next frame:
+static audio_settings_t pendingSettings;
+static volatile uint8_t pendingSettingsValid = 0;
+
+// rate and input posted by audioApplySettings(), applied by the control task (see audioApplyStreamSettings()), 0 if none:
+static volatile uint32_t requestedRate = 0;
+static volatile uint16_t requestedInput = 0;
+
+// ----------- Sampling rate and input ------------
+
+static uint32_t sampleRate;							// rate the effects are configured for, only used by the audio task
+static volatile uint32_t pendingSampleRate = 0;	// new rate posted by audioSetSampleRate(), 0 if none
+
+static uint16_t inputDevice = INPUT_DEVICE_DIGITAL_MICROPHONE_2; // see audioSetInput()
+
+// ----------- Output fades around stream reconfigurations (see fadeOutAndWait()) ------------
+
+#define FADE_LENGTH		(8 * AUDIO_BUF_SIZE)	// in samples, must be a multiple of AUDIO_BUF_SIZE
+#define FADE_TIMEOUT	500						// ms
+
+static uint32_t fadePos = 0;					// fade-in position, FADE_LENGTH once the fade-in is over
+static uint32_t fadeOutPos = 0;
+static volatile uint8_t fadeOutRequest = 0;		// set by a control task before it reconfigures the streams
+static volatile uint8_t fadeInRequest = 0;		// set by the control task once done
+static volatile uint32_t silentFrames = 0;		// frames output in silence since the fade-out completed
+
+// ----------- Effect state derived from the settings and the sampling rate (see configureEffects()) ------------
+
+static int echoDelay; // in samples (interleaved L/R)
+
 
 // ----------- Functions ------------
 
+/**
+ * Creates the audio task, which runs audioLoop(). Called from main() before the scheduler is started.
+ */
+void audioInit(void) {
+
+	osThreadDef(audioTask, audioTask, AUDIO_TASK_PRIORITY, 0, 1024);
+	audioTaskHandle = osThreadCreate(osThread(audioTask), NULL);
+}
+
+static void audioTask(void const *argument) {
+
+	LOG("audioTask\n");
+	audioLoop();
+
+	// In case we accidentally exit from task loop
+	osThreadTerminate(NULL);
+}
+
 /**
  * This is the main audio loop (aka infinite while loop) which is responsible for real time audio processing tasks:
  * - transferring recorded audio from the DMA buffer to buf_input[]
@@ -134,20 +303,28 @@ double inputLevelR_cp = 0;
  */
 void audioLoop() {
 
+	if (buildChain() != AUDIO_OK)
+		Error_Handler();
+
 	arm_rfft_fast_init_f32(&FFT_struct, FFT_Length);
+	pinFFTTables(&FFT_struct);
 
 	/* J'ai commenté pour mettre en place le RTOS*/
 //	uiDisplayBasic();
 
-	/* Initialize SDRAM buffers */
-	memset((int16_t*) AUDIO_SCRATCH_ADDR, 0, AUDIO_SCRATCH_SIZE * 2); // note that the size argument here always refers to bytes whatever the data type
+	/* the DMA buffers are not initialized by the startup code (see .dma_buffers in the linker script) */
+	memset(buf_input, 0, sizeof(buf_input));
+	memset(buf_output, 0, sizeof(buf_output));
 
 //	audio_rec_buffer_state = BUFFER_OFFSET_NONE;
 
-	// input device: INPUT_DEVICE_INPUT_LINE_1 or INPUT_DEVICE_DIGITAL_MICROPHONE_2 (not fully functional yet as you also need to change things in main.c:MX_SAI2_Init())
+	// input device: INPUT_DEVICE_INPUT_LINE_1 or INPUT_DEVICE_DIGITAL_MICROPHONE_2, can be switched at runtime with audioSetInput()
 	// AudioFreq: AUDIO_FREQUENCY_48K, AUDIO_FREQUENCY_16K, etc (but also change accordingly hsai_BlockA2.Init.AudioFrequency in main.c, line 855)
 	//start_Audio_Processing(buf_output, buf_input, AUDIO_DMA_BUF_SIZE, INPUT_DEVICE_DIGITAL_MICROPHONE_2, SAI_AUDIO_FREQUENCY_16K); // AUDIO_FREQUENCY_48K);
-	start_Audio_Processing(buf_output, buf_input, AUDIO_DMA_BUF_SIZE, INPUT_DEVICE_DIGITAL_MICROPHONE_2, hsai_BlockA2.Init.AudioFrequency);
+	// the rate can then be changed at runtime, see audioSetSampleRate()
+	sampleRate = hsai_BlockA2.Init.AudioFrequency;
+	configureEffects();
+	start_Audio_Processing(buf_output, buf_input, AUDIO_DMA_BUF_SIZE, inputDevice, sampleRate);
 
 	/* main audio loop */
 	while (1) {
@@ -176,29 +353,237 @@ void audioLoop() {
 //			asm("NOP");
 //		}
 
-		// Permet d'attendre que la première trame DMA soit complètement rempli avant de procéder au process audio
-		osSignalWait(0x0001, osWaitForever);
-		processAudio(buf_output, buf_input);
-		calculateFFT(buf_output);
+		// Permet d'attendre qu'une demi-trame DMA soit complètement remplie avant de procéder au process audio
+		processFrame(waitForFrame() ? buf_input_half : buf_input);
+	}
+}
+
+/**
+ * Blocks until the RX DMA has filled a half of buf_input, and returns which one (0 = first, 1 = second).
+ * Records the wake-up latency into wakeHist.
+ */
+ITCM_CODE static uint32_t waitForFrame(void) {
+
+#ifdef AUDIO_WAKE_SIGNAL
+	osSignalWait(0x0003, osWaitForever); // 0x0001: RxCplt, 0x0002: RxHalfCplt
+#else
+	uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	if (pending > 1) {
+		missedWakeups += pending - 1;
+		TRACE(TRACE_MARK, TRACE_MARK_MISSED, missedWakeups);
+	}
+#endif
+	uint32_t half = rxHalf;
+
+	uint32_t cycles = DWT_CYCLES() - rxIrqCycles;
+	uint32_t us = DWT_CyclesToUs(cycles);
+	int bin = 0;
+	while (bin < WAKE_HIST_BINS - 1 && us >= (1u << bin))
+		bin++;
+	wakeHist[bin]++;
+	if (cycles > wakeCyclesMax)
+		wakeCyclesMax = cycles;
+	if (cycles > statsWakeCyclesMax)
+		statsWakeCyclesMax = cycles;
+
+	return half;
+}
+
+/**
+ * Processes the input half-buffer "in" that has just been received, and writes the result into the output slip buffer,
+ * or back into "in" itself if AUDIO_IN_PLACE is defined.
+ */
+ITCM_CODE static void processFrame(audio_sample_t *in) {
+
+	uint32_t start = DWT_CYCLES();
+
+	TRACE(TRACE_BEGIN, TRACE_STAGE_FRAME, 0);
+	updateSettings();
+
+#ifdef AUDIO_IN_PLACE
+	writePos = in - buf_input;
+#else
+	if (!writePosValid) {
+		// streams in phase: the output DMA has just started reading the other half
+		writePos = in - buf_input;
+		writePosValid = 1;
+	}
+#endif
+
+	uint32_t margin = (writePos + AUDIO_DMA_BUF_SIZE - saiGetTxPosition()) % AUDIO_DMA_BUF_SIZE;
+
+	// too close to the output DMA, or overlapping samples not transmitted yet:
+	if (margin < AUDIO_MARGIN_MIN || margin > AUDIO_BUF_SIZE + SAI_PHASE_TOLERANCE) {
+		marginWarnings++;
+#ifdef AUDIO_OUTPUT_SLIP
+		writePos = (saiGetTxPosition() + AUDIO_BUF_SIZE) % AUDIO_DMA_BUF_SIZE;
+		margin = AUDIO_BUF_SIZE;
+		slips++;
+#endif
+	}
+
+#ifdef AUDIO_IN_PLACE
+	audio_sample_t *outFrame = in; // not cacheable, see buf_input
+#endif
+
+	// test sequence instead of the effects while measuring (see latency.c), else WAV file instead of the CODEC input while playing (see player.c):
+	if (!latencyProcessFrame(in, outFrame, AUDIO_BUF_SIZE))
+		processAudio(outFrame, (audio_sample_t*) playerSource(in, AUDIO_BUF_SIZE));
+
+#ifndef AUDIO_IN_PLACE
+	uint32_t first = AUDIO_DMA_BUF_SIZE - writePos;
+	if (first > AUDIO_BUF_SIZE)
+		first = AUDIO_BUF_SIZE;
+	memcpy(buf_output + writePos, outFrame, first * sizeof(audio_sample_t));
+	memcpy(buf_output, outFrame + first, (AUDIO_BUF_SIZE - first) * sizeof(audio_sample_t));
+#endif
+
+	// if the output DMA went past writePos in the meantime, the margin has wrapped around:
+	if ((writePos + AUDIO_DMA_BUF_SIZE - saiGetTxPosition()) % AUDIO_DMA_BUF_SIZE > margin) {
+		lateFrames++;
+		TRACE(TRACE_MARK, TRACE_MARK_XRUN, lateFrames);
+		traceTrigger(); // keeps what led to it in the trace, see trace.c
+	}
+
+	writePos = (writePos + AUDIO_BUF_SIZE) % AUDIO_DMA_BUF_SIZE;
+
+	recorderPushBlock(outFrame, AUDIO_BUF_SIZE); // never blocks, see recorder.c
+	monitorPushBlock(outFrame, AUDIO_BUF_SIZE, sampleRate); // same, see monitor.c
+	calculateFFT(outFrame);
+	TRACE(TRACE_END, TRACE_STAGE_FRAME, 0);
+
+	frameCycles = DWT_CYCLES() - start;
+	if (frameCycles > frameCyclesMax)
+		frameCyclesMax = frameCycles;
+	if (frameCycles > statsCyclesMax)
+		statsCyclesMax = frameCycles;
+	frameCyclesSum += frameCycles;
+	frameCount++;
+}
+
+/**
+ * Allocates the memory of the effect chain from the arena pools (see arena.c): the frame and per-sample state in the fast pool,
+ * delay lines in the bulk pool. Called once by the audio task before the streams are started, never while processing a frame.
+ * Delay lines are sized for their maximum setting at the highest sampling rate, so that changing the settings or the rate
+ * never needs to allocate, and settings that would need more are refused by audioApplySettings().
+ * Returns AUDIO_ERROR if the frame itself doesn't fit; an effect whose memory doesn't fit is bypassed.
+ */
+static uint8_t buildChain(void) {
+
+	arenaInitPool(ARENA_FAST, "fast", arenaFast, sizeof(arenaFast));
+	arenaInitPool(ARENA_NORMAL, "normal", arenaNormal, sizeof(arenaNormal));
+	arenaInitPool(ARENA_BULK, "bulk", (void*) AUDIO_SCRATCH_ADDR, AUDIO_SCRATCH_MAXSZ_BYTES);
+
+	frame = arenaAlloc(ARENA_FAST, AUDIO_BUF_SIZE * sizeof(float), 32);
+
+	// echo: odd maximum delay, see configureEffects()
+	echoLineLen = 2 * (ECHO_MAX_MS * SAI_AUDIO_FREQUENCY_48K / 1000);
+	echoLine = arenaAlloc(ARENA_BULK, echoLineLen * sizeof(float), 32);
+	if (echoLine)
+		memset(echoLine, 0, echoLineLen * sizeof(float));
+	else {
+		echoLineLen = 0;
+		LOG("audio: no room for the echo line, echo bypassed\n");
+	}
+
+	arenaReport();
+	return frame ? AUDIO_OK : AUDIO_ERROR;
+}
+
+/**
+ * Copies the twiddle factors and the bit reversal table of an initialized FFT instance from the CMSIS-DSP constant tables
+ * (in flash) into the fast pool (DTCM), and points the instance to the copies. Leaves the instance untouched if they don't fit.
+ */
+static void pinFFTTables(arm_rfft_fast_instance_f32 *S) {
+
+	float32_t *fftTwiddleRFFT = arenaAlloc(ARENA_FAST, S->fftLenRFFT * sizeof(float32_t), 8);
+	float32_t *fftTwiddleCFFT = arenaAlloc(ARENA_FAST, 2 * S->Sint.fftLen * sizeof(float32_t), 8); // complex FFT of length fftLenRFFT/2
+	uint16_t *fftBitRevTable = arenaAlloc(ARENA_FAST, S->Sint.bitRevLength * sizeof(uint16_t), 4);
+
+	if (fftTwiddleRFFT == NULL || fftTwiddleCFFT == NULL || fftBitRevTable == NULL)
+		return;
+
+	memcpy(fftTwiddleRFFT, S->pTwiddleRFFT, S->fftLenRFFT * sizeof(float32_t));
+	memcpy(fftTwiddleCFFT, S->Sint.pTwiddle, 2 * S->Sint.fftLen * sizeof(float32_t));
+	memcpy(fftBitRevTable, S->Sint.pBitRevTable, S->Sint.bitRevLength * sizeof(uint16_t));
+
+	S->pTwiddleRFFT = fftTwiddleRFFT;
+	S->Sint.pTwiddle = fftTwiddleCFFT;
+	S->Sint.pBitRevTable = fftBitRevTable;
+}
 
-		// Permet d'attendre que la seconde trame DMA soit complètement rempli avant de procéder au process audio
-		osSignalWait(0x0002, osWaitForever);
-		processAudio(buf_output_half, buf_input_half);
-		calculateFFT(buf_output_half);
+/**
+ * Prints the RX/TX phase monitor and slip buffer statistics whenever they have changed. Called periodically by the UI task.
+ */
+void audioReportMonitor(void) {
+
+	static uint32_t lastPrint = 0;
+	static uint32_t lastCount = 0;
+	sai_monitor_t m;
+
+	if (HAL_GetTick() - lastPrint < 2000)
+		return;
+	lastPrint = HAL_GetTick();
+
+#ifdef AUDIO_PROFILE
+	// one frame lasts SystemCoreClock * (AUDIO_BUF_SIZE / 2) / rate cycles:
+	uint32_t period = (uint32_t) ((uint64_t) SystemCoreClock * (AUDIO_BUF_SIZE / 2) / audioGetSampleRate());
+	uint32_t n = frameCount; // may be incremented by the audio task meanwhile, the figures are only indicative
+	if (n) {
+		uint32_t avg = frameCyclesSum / n;
+		printf("audio: frame %lu cycles avg (%lu us, %lu%% of %lu), %lu max\n", avg, DWT_CyclesToUs(avg), 100 * avg / period,
+				period, frameCyclesMax);
+		frameCyclesSum = 0;
+		frameCyclesMax = 0;
+		frameCount = 0;
 	}
+
+	printf("audio: wake-up latency (us) <1:%lu <2:%lu <4:%lu <8:%lu <16:%lu <32:%lu <64:%lu >=64:%lu, max %lu cycles, %lu missed\n",
+			wakeHist[0], wakeHist[1], wakeHist[2], wakeHist[3], wakeHist[4], wakeHist[5], wakeHist[6], wakeHist[7],
+			wakeCyclesMax, missedWakeups);
+	memset(wakeHist, 0, sizeof(wakeHist));
+	wakeCyclesMax = 0;
+#endif
+
+	saiMonitorGet(&m);
+	if (m.driftEvents + marginWarnings + lateFrames == lastCount)
+		return;
+	lastCount = m.driftEvents + marginWarnings + lateFrames;
+
+	printf("audio: RX/TX phase %ld (drift %ld..%ld, %lu events), margin warnings %lu, late frames %lu, slips %lu\n",
+			m.phase, m.driftMin, m.driftMax, m.driftEvents, marginWarnings, lateFrames, slips);
+}
+
+/**
+ * Copies the frame timing and xrun counters (e.g. for the telemetry, see telemetry.c), and restarts the maxima.
+ * May be called from any task, the figures are only indicative.
+ */
+void audioGetStats(audio_stats_t *s) {
+
+	s->frameCycles = frameCycles;
+	s->frameCyclesMax = statsCyclesMax;
+	s->periodCycles = (uint32_t) ((uint64_t) SystemCoreClock * (AUDIO_BUF_SIZE / 2) / audioGetSampleRate());
+	s->wakeCyclesMax = statsWakeCyclesMax;
+	s->lateFrames = lateFrames;
+	s->marginWarnings = marginWarnings;
+	s->slips = slips;
+	s->missedWakeups = missedWakeups;
+	statsCyclesMax = 0;
+	statsWakeCyclesMax = 0;
 }
 
 /*
  * Function that realize the FFT calculation of a signal
  */
-void calculateFFT(int16_t *in){
+ITCM_CODE void calculateFFT(audio_sample_t *in){
 
-	 for (int i = 0; i < FFT_Length; i++){
-		 aFFT_Input_f32[i] = in[i];
-	 }
+	 TRACE(TRACE_BEGIN, TRACE_STAGE_FFT, 0);
+	 samplesToFloat(in, aFFT_Input_f32, FFT_Length);
 
 	 arm_rfft_fast_f32(&FFT_struct, aFFT_Input_f32, aFFT_Output_f32, 0);
 	 arm_cmplx_mag_f32(aFFT_Output_f32, aFFT_Input_f32, FFT_Length/2);
+	 arm_scale_f32(aFFT_Input_f32, 32768.0f, aFFT_Input_f32, FFT_Length/2); // magnitudes in 16-bit units, whatever the sample format (see the spectrogram in main.c)
+	 TRACE(TRACE_END, TRACE_STAGE_FFT, 0);
 	 osSignalSet(uiTaskHandle, 0x0003);
  }
 
@@ -210,29 +595,251 @@ void calculateFFT(int16_t *in){
  * with left channel samples at even positions,
  * and right channel samples at odd positions.
  */
-static void accumulateInputLevels() {
+ITCM_CODE static void accumulateInputLevels() {
 
 	// Left channel:
-	uint32_t lvl = 0;
+	uint64_t lvl = 0; // 32-bit samples would overflow a 32-bit accumulator
 	for (int i = 0; i < AUDIO_DMA_BUF_SIZE; i += 2) {
-		int16_t v = (int16_t) buf_output[i];
+		int32_t v = buf_output[i];
 		if (v > 0)
 			lvl += v;
 		else
-			lvl -= v;
+			lvl -= (int64_t) v;
 	}
-	inputLevelL += (double) lvl / AUDIO_DMA_BUF_SIZE / (1 << 15);
+	inputLevelL += (double) lvl / AUDIO_DMA_BUF_SIZE / AUDIO_SAMPLE_FULL_SCALE;
 
 	// Right channel:
 	lvl = 0;
 	for (int i = 1; i < AUDIO_DMA_BUF_SIZE; i += 2) {
-		int16_t v = (int16_t) buf_output[i];
+		int32_t v = buf_output[i];
 		if (v > 0)
 			lvl += v;
 		else
-			lvl -= v;
+			lvl -= (int64_t) v;
+	}
+	inputLevelR += (double) lvl / AUDIO_DMA_BUF_SIZE / AUDIO_SAMPLE_FULL_SCALE;
+}
+
+// --------------------------- Settings ---------------------------
+
+/**
+ * Copies the settings currently in use. May be called from any task.
+ */
+void audioGetSettings(audio_settings_t *s) {
+
+	taskENTER_CRITICAL(); // the audio task can't update them in the middle of the copy
+	*s = pendingSettingsValid ? pendingSettings : settings;
+	taskEXIT_CRITICAL();
+
+	s->sampleRate = audioGetSampleRate();
+	s->inputDevice = inputDevice;
+	s->reserved = 0;
+}
+
+/**
+ * Posts new settings to the audio task, which applies them at the beginning of the next frame. May be called from any task.
+ * Returns AUDIO_ERROR, and leaves the current settings untouched, if they have another layout or don't fit in the memory
+ * allocated for the chain (see buildChain()).
+ */
+uint8_t audioApplySettings(const audio_settings_t *s) {
+
+	if (s->version != AUDIO_SETTINGS_VERSION)
+		return AUDIO_ERROR;
+	if (!(s->echoDelayMs >= 0.0f && s->echoDelayMs <= ECHO_MAX_MS))
+		return AUDIO_ERROR;
+	if (s->sampleRate != SAI_AUDIO_FREQUENCY_16K && s->sampleRate != SAI_AUDIO_FREQUENCY_48K)
+		return AUDIO_ERROR;
+	if (s->inputDevice != INPUT_DEVICE_INPUT_LINE_1 && s->inputDevice != INPUT_DEVICE_DIGITAL_MICROPHONE_2)
+		return AUDIO_ERROR;
+
+	taskENTER_CRITICAL();
+	pendingSettings = *s;
+	pendingSettingsValid = 1;
+	requestedRate = s->sampleRate;
+	requestedInput = s->inputDevice;
+	taskEXIT_CRITICAL();
+	return AUDIO_OK;
+}
+
+/**
+ * Switches to the sampling rate and the input of the last audioApplySettings(), if not done yet.
+ * Unlike the effect settings, they reconfigure the CODEC (see audioSetSampleRate() and audioSetInput()), hence this must
+ * be called by the control task, e.g. periodically by the UI task. Returns 1 if the rate or the input were changed.
+ */
+uint8_t audioApplyStreamSettings(void) {
+
+	uint32_t rate = requestedRate;
+	uint16_t device = requestedInput;
+	uint8_t changed = 0;
+
+	if (rate == 0)
+		return 0;
+	requestedRate = 0;
+
+	if (rate != audioGetSampleRate()) {
+		if (audioSetSampleRate(rate) != AUDIO_OK)
+			printf("audio: cannot restore %lu Hz\n", rate);
+		changed = 1;
+	}
+	if (device != inputDevice) {
+		if (audioSetInput(device) != AUDIO_OK)
+			printf("audio: cannot restore the input\n");
+		changed = 1;
+	}
+	return changed;
+}
+
+/**
+ * Switches the sampling rate of the running streams (see setAudioFrequency() in disco_sai.c), e.g. b/w 16kHz and 48kHz.
+ * The output is faded out beforehand, then the audio task reconfigures the effects for the new rate, and fades the output in.
+ *
+ * Blocks for a few milliseconds: must be called from a control task (e.g. the UI task), never from the audio task.
+ * Fails while recording, since a WAV file has a single sampling rate.
+ */
+uint8_t audioSetSampleRate(uint32_t rate) {
+
+	uint8_t ret;
+
+	if (rate == audioGetSampleRate())
+		return AUDIO_OK;
+	if (recorderIsRecording())
+		return AUDIO_ERROR;
+
+	fadeOutAndWait();
+
+	ret = setAudioFrequency(rate);
+
+	taskENTER_CRITICAL();
+	pendingSampleRate = rate;
+	taskEXIT_CRITICAL();
+
+	fadeInAgain();
+	return ret;
+}
+
+/**
+ * Switches the input b/w INPUT_DEVICE_INPUT_LINE_1 and INPUT_DEVICE_DIGITAL_MICROPHONE_2 while the output keeps running
+ * (see setInput() in disco_sai.c): the output is faded out, the input stream is reconfigured and restarted in phase
+ * with the output stream, then the output is faded in again. As the SAI only carries one of both inputs at a time,
+ * the crossfade goes through silence (2 x FADE_LENGTH samples plus up to one DMA buffer).
+ *
+ * Blocks for a few frames: must be called from a control task (e.g. the UI task), the audio task itself never waits.
+ */
+uint8_t audioSetInput(uint16_t device) {
+
+	uint8_t ret;
+
+	if (device == inputDevice)
+		return AUDIO_OK;
+
+	fadeOutAndWait();
+
+	ret = setInput(device);
+	if (ret == AUDIO_OK)
+		inputDevice = device;
+
+	fadeInAgain();
+	return ret;
+}
+
+/**
+ * Returns the current input device.
+ */
+uint16_t audioGetInput(void) {
+
+	return inputDevice;
+}
+
+/**
+ * Control task side: asks the audio task to fade the output out, and waits until both halves of the output DMA buffer
+ * hold silence, so that the streams can be stopped or reconfigured inaudibly. Gives up after FADE_TIMEOUT.
+ */
+static void fadeOutAndWait(void) {
+
+	uint32_t start = HAL_GetTick();
+
+	fadeOutRequest = 1;
+	while (silentFrames < 2 && HAL_GetTick() - start < FADE_TIMEOUT)
+		osDelay(1);
+}
+
+/**
+ * Control task side: asks the audio task to fade the output in again after fadeOutAndWait().
+ */
+static void fadeInAgain(void) {
+
+	// both at once, otherwise the audio task might process a frame in between, unfaded
+	taskENTER_CRITICAL();
+	fadeOutRequest = 0;
+	fadeInRequest = 1;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * Returns the nominal sampling rate of the streams. May be called from any task.
+ */
+uint32_t audioGetSampleRate(void) {
+
+	uint32_t rate = pendingSampleRate;
+
+	return rate ? rate : sampleRate;
+}
+
+/**
+ * Called by the audio task before processing a frame.
+ */
+static void updateSettings() {
+
+	if (fadeInRequest) {
+		fadeInRequest = 0;
+		fadeOutPos = 0;
+		silentFrames = 0;
+		fadePos = 0;
+		writePosValid = 0; // the streams have been restarted
 	}
-	inputLevelR += (double) lvl / AUDIO_DMA_BUF_SIZE / (1 << 15);
+
+	if (pendingSampleRate) {
+
+		taskENTER_CRITICAL();
+		sampleRate = pendingSampleRate;
+		pendingSampleRate = 0;
+		taskEXIT_CRITICAL();
+
+		configureEffects();
+
+		// the streams have been restarted: flush what the echo line holds at the old rate
+		if (echoLine)
+			memset(echoLine, 0, (echoDelay + 1) * sizeof(float));
+		pos = 0;
+	}
+
+	if (!pendingSettingsValid)
+		return;
+
+	taskENTER_CRITICAL();
+	settings = pendingSettings;
+	pendingSettingsValid = 0;
+	taskEXIT_CRITICAL();
+
+	configureEffects();
+}
+
+/**
+ * Derives the rate-dependent state of each effect (delay lengths, coefficients...) from the settings and the sampling rate.
+ * Called by the audio task whenever either of them changes: effects with rate-dependent parameters must be handled here.
+ */
+static void configureEffects() {
+
+	// echo: the delay line lives in the bulk pool (see buildChain()), and pos wraps after echoDelay + 1 samples,
+	// which must be even for the L/R interleaving to be preserved:
+	int maxDelay = echoLineLen ? (int) (echoLineLen & ~1) - 1 : 1;
+	int frames = settings.echoDelayMs * sampleRate / 1000;
+
+	echoDelay = frames ? 2 * frames - 1 : 1;
+	if (echoDelay > maxDelay)
+		echoDelay = maxDelay;
+	if (pos > echoDelay)
+		pos = 0;
 }
 
 // --------------------------- Callbacks implementation ---------------------------
@@ -243,7 +850,8 @@ static void accumulateInputLevels() {
 void HAL_SAI_RxCpltCallback(SAI_HandleTypeDef *hsai) {
 	/* Commenter pour le RTOS */
 //	audio_rec_buffer_state = BUFFER_OFFSET_FULL;
-	osSignalSet(defaultTaskHandle, 0x0001);
+	saiMonitorSample();
+	wakeAudioTask(1, 0x0001);
 	return;
 }
 
@@ -253,40 +861,85 @@ void HAL_SAI_RxCpltCallback(SAI_HandleTypeDef *hsai) {
 void HAL_SAI_RxHalfCpltCallback(SAI_HandleTypeDef *hsai) {
 	/* Commenter pour le RTOS */
 //	audio_rec_buffer_state = BUFFER_OFFSET_HALF;
-	osSignalSet(defaultTaskHandle, 0x0002);
+	saiMonitorSample();
+	wakeAudioTask(0, 0x0002);
 	return;
 }
 
-// --------------------------- Audio scratch buffer ---------------------------
-
 /**
- * Read a sample from the audio scratch buffer in SDRAM at position "pos"
+ * Wakes the audio task up from an RX DMA callback: "half" of buf_input has just been filled.
  */
-static float readFromAudioScratch(int pos) {
+static void wakeAudioTask(uint8_t half, int32_t signal) {
+
+	rxIrqCycles = DWT_CYCLES();
+	rxHalf = half;
+	TRACE(TRACE_IRQ, TRACE_IRQ_SAI_RX, half);
+
+#ifdef AUDIO_WAKE_SIGNAL
+	osSignalSet(audioTaskHandle, signal);
+#else
+	BaseType_t woken = pdFALSE;
+	vTaskNotifyGiveFromISR(audioTaskHandle, &woken);
+	portYIELD_FROM_ISR(woken);
+#endif
+}
+
+// --------------------------- Sample format conversion ---------------------------
 
-	__IO float *pSdramAddress = (float*) AUDIO_SCRATCH_ADDR;
-	pSdramAddress += pos;
-	return *(__IO float*) pSdramAddress;
+/**
+ * Converts n samples from the DMA format to normalized floats in [-1, 1).
+ */
+ITCM_CODE static void samplesToFloat(const audio_sample_t *in, float *out, uint32_t n) {
 
+#ifdef AUDIO_SAMPLE_24IN32
+	arm_q31_to_float((q31_t*) in, out, n);
+#else
+	arm_q15_to_float((q15_t*) in, out, n);
+#endif
 }
 
 /**
- * Write the given value to the audio scratch buffer in SDRAM at position "pos"
+ * Converts n normalized floats back to the DMA format, with saturation.
  */
-static void writeToAudioScratch(float val, int pos) {
-
-	__IO float *pSdramAddress = (float*) AUDIO_SCRATCH_ADDR;
-	pSdramAddress += pos;
-	*(__IO float*) pSdramAddress = val;
+ITCM_CODE static void samplesFromFloat(float *in, audio_sample_t *out, uint32_t n) {
 
+#ifdef AUDIO_SAMPLE_24IN32
+	arm_float_to_q31(in, (q31_t*) out, n);
+#else
+	arm_float_to_q15(in, (q15_t*) out, n);
+#endif
 }
 
 // --------------------------- AUDIO ALGORITHMS ---------------------------
 
+/**
+ * Linear fade-in over FADE_LENGTH samples, applied at start-up and after each stream reconfiguration.
+ */
+ITCM_CODE static void fadeIn(float *buf) {
+
+	for (int n = 0; n < AUDIO_BUF_SIZE && fadePos < FADE_LENGTH; n++, fadePos++)
+		buf[n] *= fadePos * (1.0f / FADE_LENGTH);
+}
+
+/**
+ * Linear fade-out over FADE_LENGTH samples, then silence (see fadeOutAndWait()).
+ */
+ITCM_CODE static void fadeOut(float *buf) {
+
+	if (fadeOutPos >= FADE_LENGTH) {
+		memset(buf, 0, AUDIO_BUF_SIZE * sizeof(float));
+		silentFrames++;
+		return;
+	}
+
+	for (int n = 0; n < AUDIO_BUF_SIZE; n++, fadeOutPos++)
+		buf[n] *= (FADE_LENGTH - fadeOutPos) * (1.0f / FADE_LENGTH);
+}
+
 /**
  * No effect function which simply reproduces the input on the output
  */
-static void no_effect(int16_t *out, int16_t *in) {
+ITCM_CODE static void no_effect(float *out, float *in) {
 
 	float A = 1.0;
 
@@ -301,20 +954,24 @@ static void no_effect(int16_t *out, int16_t *in) {
  * ("fb") are adjustable, as well as the "wet/dry" mix between the
  * "reverberated" (wet) sound and the "dry" sound.
 */
-static void echo_effect(int16_t *out, int16_t *in) {
+ITCM_CODE static void echo_effect(float *out, float *in) {
 
 	float memory;
 
-	float DRY = 0.4;
-	float WET = 0.6;
-	float fb = 0.4;
-	int delay = 50 * AUDIO_BUF_SIZE;
+	float DRY = settings.echoDry;
+	float WET = settings.echoWet;
+	float fb = settings.echoFeedback;
+	int delay = echoDelay;
+	float *line = echoLine;
+
+	if (line == NULL)
+		return; // bypassed, see buildChain()
 
 	for (int n = 0; n < AUDIO_BUF_SIZE; n++)
 	{
-		memory = in[n] + fb * readFromAudioScratch(pos);
+		memory = in[n] + fb * line[pos];
 		out[n] = DRY * in[n] + WET * memory;
-		writeToAudioScratch(out[n],pos);
+		line[pos] = out[n];
 
 		if (pos < delay)
 		{
@@ -330,11 +987,11 @@ static void echo_effect(int16_t *out, int16_t *in) {
 
 
 
-static void noise_gate(int16_t *out, int16_t *in) {
+ITCM_CODE static void noise_gate(float *out, float *in) {
 
 	// Le noise gate fonctionne à coup sur ! mais le problème c'est qu'il faut le géré par rapport au niveau sonore
-	float threshold = 0.001;
-	float attenuation = 100000;
+	float threshold = settings.gateThreshold;
+	float attenuation = settings.gateAttenuation;
 
 	for (int n = 0; n < AUDIO_BUF_SIZE; n++) {
 		if (in[n] > threshold){
@@ -351,14 +1008,40 @@ static void noise_gate(int16_t *out, int16_t *in) {
  * have just been transferred from the CODEC
  * (keep in mind that this number represents interleaved L and R samples,
  * hence the true corresponding duration of this audio frame is AUDIO_BUF_SIZE/2 divided by the sampling frequency).
+ *
+ * The input is first converted to floats, then each effect of the chain (see audio_settings_t) processes the frame in place,
+ * and the result is converted back to the output format.
  */
-static void processAudio(int16_t *out, int16_t *in) {
+ITCM_CODE static void processAudio(audio_sample_t *out, audio_sample_t *in) {
 
 	LED_On(); // for oscilloscope measurements...
 
-	no_effect(out, in); // If you want no effect on the audio output
-//	echo_effect(out, in); // If you want a echo effect on the audio output
-//	noise_gate(out, in);
+	samplesToFloat(in, frame, AUDIO_BUF_SIZE);
+	no_effect(frame, frame);
+
+	for (int i = 0; i < AUDIO_CHAIN_MAX; i++) {
+		if (settings.chain[i] != FX_NONE)
+			TRACE(TRACE_BEGIN, TRACE_STAGE_EFFECT, settings.chain[i]);
+		switch (settings.chain[i]) {
+		case FX_ECHO:
+			echo_effect(frame, frame);
+			break;
+		case FX_NOISE_GATE:
+			noise_gate(frame, frame);
+			break;
+		default:
+			break;
+		}
+		if (settings.chain[i] != FX_NONE)
+			TRACE(TRACE_END, TRACE_STAGE_EFFECT, settings.chain[i]);
+	}
+
+	if (fadeOutRequest)
+		fadeOut(frame);
+	else if (fadePos < FADE_LENGTH)
+		fadeIn(frame);
+
+	samplesFromFloat(frame, out, AUDIO_BUF_SIZE);
 
 	LED_Off();
 }
@@ -59,7 +59,7 @@ extern UART_HandleTypeDef huart1; // needed below, defined in main.c
  */
 int __io_putchar(int ch){
 
-	HAL_UART_Transmit(&huart1, (uint8_t *)&ch, 1, 0xFFFF); // beware blocking call! TODO => use DMA
+	HAL_UART_Transmit(&huart1, (uint8_t *)&ch, 1, 0xFFFF); // beware blocking call! only used before the scheduler starts and from interrupts, see _write() in logger.c
 	return ch;
 }
 
@@ -0,0 +1,220 @@
+/*
+ * disco_dma2d.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Interrupt-driven DMA2D job queue ===
+ *
+ * The LCD primitives (see the LL_ functions in disco_lcd.c) no longer configure the DMA2D through the HAL and
+ * poll for the end of each transfer: they build a job, i.e. the register values of the transfer (dma2d_job_t),
+ * and submit it to a ring of DMA2D_QUEUE_LEN jobs. The engine runs the jobs back to back: the transfer-complete
+ * interrupt (HAL_DMA2D_IRQHandler() -> JobEnded()) writes the registers of the next job and starts it, so the
+ * drawing task only blocks when the ring is full or when it really needs the pixels:
+ *
+ * 		ticket = DISCO_DMA2D_Submit(&job);	// returns at once
+ * 		...
+ * 		DISCO_DMA2D_Wait(ticket);			// sleeps on a semaphore until the job is done
+ *
+ * Tickets are the running count of submitted jobs, and a job is done once as many jobs have ended.
+ * Jobs run in submission order, hence waiting for the last ticket (DISCO_DMA2D_WaitIdle()) waits for all of them.
+ *
+ * There is a single waiter: the LCD driver is not reentrant anyway (one drawing task at a time).
+ * The completion is signalled with a semaphore rather than a task notification because the notification value of
+ * the UI task already carries its CMSIS signals (see osSignalWait() in startUITask()).
+ *
+ * Before the scheduler starts (e.g. LCD_Init()), jobs run synchronously, in polling mode.
+ *
+ * CLUT loads are jobs too (DMA2D_JOB_CLUT_LOAD): they end with the CLUT transfer complete interrupt, which the HAL
+ * reports through HAL_DMA2D_CLUTLoadingCpltCallback().
+ */
+
+#include "bsp/disco_dma2d.h"
+#include "cmsis_os.h"
+
+extern DMA2D_HandleTypeDef hdma2d; // see main.c, the IRQ handler is in stm32f7xx_it.c
+
+#define DMA2D_IT_CLUT	(DMA2D_IT_CTC | DMA2D_IT_CAE)
+#define DMA2D_IT_ALL	(DMA2D_IT_TC | DMA2D_IT_TE | DMA2D_IT_CE | DMA2D_IT_CLUT)
+#define DMA2D_FLAG_ERR	(DMA2D_FLAG_TE | DMA2D_FLAG_CE | DMA2D_FLAG_CAE)
+#define DMA2D_FLAG_END	(DMA2D_FLAG_TC | DMA2D_FLAG_CTC | DMA2D_FLAG_ERR)
+
+// ----------- Local vars ------------
+
+static dma2d_job_t queue[DMA2D_QUEUE_LEN];
+static volatile uint32_t submitted = 0;		// tickets: job n is in queue[(n - 1) % DMA2D_QUEUE_LEN]
+static volatile uint32_t completed = 0;
+static volatile uint8_t running = 0;
+static volatile uint32_t waitTicket = 0;	// 0 if no task waits
+static volatile uint32_t errors = 0;
+static osSemaphoreId doneSem;
+
+// ------------ Private Function Prototypes ------------
+
+static void StartJob(const dma2d_job_t *job, uint32_t interrupts);
+static void JobEnded(DMA2D_HandleTypeDef *hdma2d);
+static void JobError(DMA2D_HandleTypeDef *hdma2d);
+
+// ----------- Functions ------------
+
+/**
+ * Must be called after MX_DMA2D_Init() (DMA2D clock and interrupt) and before any submission.
+ */
+void DISCO_DMA2D_Init(void) {
+
+	hdma2d.XferCpltCallback = JobEnded;
+	hdma2d.XferErrorCallback = JobError;
+
+	osSemaphoreDef(dma2dDone);
+	doneSem = osSemaphoreCreate(osSemaphore(dma2dDone), 1);
+	osSemaphoreWait(doneSem, 0); // created available
+}
+
+/**
+ * Queues a job (copied, so "job" may live on the stack) and returns its ticket.
+ * Blocks only if DMA2D_QUEUE_LEN jobs are already pending.
+ */
+uint32_t DISCO_DMA2D_Submit(const dma2d_job_t *job) {
+
+	uint32_t ticket;
+
+	if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+		StartJob(job, 0);
+		while ((DMA2D->ISR & DMA2D_FLAG_END) == 0)
+			;
+		if (DMA2D->ISR & DMA2D_FLAG_ERR)
+			errors++;
+		DMA2D->IFCR = DMA2D_FLAG_END;
+		completed = ++submitted;
+		return submitted;
+	}
+
+	for (;;) {
+		taskENTER_CRITICAL();
+		if (submitted - completed < DMA2D_QUEUE_LEN)
+			break;
+		taskEXIT_CRITICAL();
+		DISCO_DMA2D_Wait(completed + 1); // the oldest one
+	}
+
+	queue[submitted % DMA2D_QUEUE_LEN] = *job;
+	ticket = ++submitted;
+	if (!running) {
+		running = 1;
+		StartJob(&queue[(ticket - 1) % DMA2D_QUEUE_LEN], DMA2D_IT_ALL);
+	}
+	taskEXIT_CRITICAL();
+
+	return ticket;
+}
+
+uint8_t DISCO_DMA2D_IsDone(uint32_t ticket) {
+
+	return (int32_t) (completed - ticket) >= 0;
+}
+
+/**
+ * Blocks until the job "ticket" (and hence all the jobs submitted before it) is done.
+ * Gives up after DMA2D_WAIT_TIMEOUT_MS, aborting the transfer in progress and dropping the pending jobs.
+ */
+void DISCO_DMA2D_Wait(uint32_t ticket) {
+
+	uint32_t start = HAL_GetTick();
+
+	while (!DISCO_DMA2D_IsDone(ticket)) {
+
+		waitTicket = ticket;
+		if (DISCO_DMA2D_IsDone(ticket)) // ended before waitTicket was set
+			break;
+		osSemaphoreWait(doneSem, DMA2D_WAIT_TIMEOUT_MS);
+
+		if (!DISCO_DMA2D_IsDone(ticket) && HAL_GetTick() - start >= DMA2D_WAIT_TIMEOUT_MS) {
+			taskENTER_CRITICAL();
+			DMA2D->CR = (DMA2D->CR & ~DMA2D_IT_ALL) | DMA2D_CR_ABORT;
+			DMA2D->IFCR = DMA2D_FLAG_END;
+			completed = submitted;
+			running = 0;
+			errors++;
+			taskEXIT_CRITICAL();
+		}
+	}
+	waitTicket = 0;
+}
+
+/**
+ * Blocks until all the jobs submitted so far are done, e.g. before the CPU draws into the framebuffer.
+ */
+void DISCO_DMA2D_WaitIdle(void) {
+
+	if (submitted != completed)
+		DISCO_DMA2D_Wait(submitted);
+}
+
+/**
+ * Number of jobs ended by a transfer or configuration error, or by a timeout, since the reset.
+ */
+uint32_t DISCO_DMA2D_GetErrors(void) {
+
+	return errors;
+}
+
+static void StartJob(const dma2d_job_t *job, uint32_t interrupts) {
+
+	if (job->CR == DMA2D_JOB_CLUT_LOAD) {
+		DMA2D->FGCMAR = job->FGCMAR;
+		DMA2D->FGPFCCR = job->FGPFCCR;
+		DMA2D->CR = interrupts & DMA2D_IT_CLUT;
+		DMA2D->FGPFCCR = job->FGPFCCR | DMA2D_FGPFCCR_START;
+		return;
+	}
+
+	DMA2D->FGMAR = job->FGMAR;
+	DMA2D->FGOR = job->FGOR;
+	DMA2D->FGPFCCR = job->FGPFCCR;
+	DMA2D->FGCOLR = job->FGCOLR;
+	DMA2D->BGMAR = job->BGMAR;
+	DMA2D->BGOR = job->BGOR;
+	DMA2D->BGPFCCR = job->BGPFCCR;
+	DMA2D->BGCOLR = job->BGCOLR;
+	DMA2D->OPFCCR = job->OPFCCR;
+	DMA2D->OCOLR = job->OCOLR;
+	DMA2D->OMAR = job->OMAR;
+	DMA2D->OOR = job->OOR;
+	DMA2D->NLR = job->NLR;
+	DMA2D->CR = (job->CR & DMA2D_CR_MODE) | interrupts | DMA2D_CR_START;
+}
+
+/**
+ * Transfer-complete interrupt, through HAL_DMA2D_IRQHandler(): chains the next job, and wakes the waiting task up
+ * once its job is done.
+ */
+static void JobEnded(DMA2D_HandleTypeDef *hdma2d) {
+
+	completed++;
+	if (completed != submitted)
+		StartJob(&queue[completed % DMA2D_QUEUE_LEN], DMA2D_IT_ALL);
+	else
+		running = 0;
+
+	if (waitTicket != 0 && DISCO_DMA2D_IsDone(waitTicket)) {
+		waitTicket = 0;
+		osSemaphoreRelease(doneSem);
+	}
+}
+
+/**
+ * CLUT transfer complete interrupt, through HAL_DMA2D_IRQHandler() (weak function of the HAL).
+ */
+void HAL_DMA2D_CLUTLoadingCpltCallback(DMA2D_HandleTypeDef *hdma2d) {
+
+	JobEnded(hdma2d);
+}
+
+/**
+ * Transfer, configuration or CLUT access error interrupt: the job is dropped, the next one starts.
+ */
+static void JobError(DMA2D_HandleTypeDef *hdma2d) {
+
+	errors++;
+	JobEnded(hdma2d);
+}
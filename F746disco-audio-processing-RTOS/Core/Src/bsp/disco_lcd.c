@@ -11,11 +11,14 @@
 /* Includes ------------------------------------------------------------------*/
 #include "bsp/disco_lcd.h"
 #include "bsp/disco_base.h"
+#include "bsp/disco_dma2d.h"
 #include "main.h"
 #include "fonts.h"
 #include "types.h"
 #include "main.h"
 #include "stdio.h"
+#include "string.h"
+#include "cmsis_os.h"
 
 #define POLY_X(Z)              ((int32_t)((Points + Z)->X))
 #define POLY_Y(Z)              ((int32_t)((Points + Z)->Y))
@@ -23,7 +26,6 @@
 #define ABS(X)  ((X) > 0 ? (X) : -(X))
 
 extern LTDC_HandleTypeDef  hltdc;
-extern DMA2D_HandleTypeDef hdma2d;
 
 // if the LCD framebuffer is in RAM (as opposed to external SDRAM), frameBuf[] holds it.
 // In this case it takes up around 255kb of the available 320ko of RAM, beware!
@@ -31,14 +33,56 @@ extern DMA2D_HandleTypeDef hdma2d;
 	uint16_t frameBuf[LCD_SCREEN_WIDTH * LCD_SCREEN_HEIGHT];
 	//ALIGN_32BYTES (static uint8_t frameBuf[2*LCD_SCREEN_WIDTH * LCD_SCREEN_HEIGHT]);
 	static uint32_t frameBuf0 = (uint32_t)& frameBuf[0];
-	//#define __CleanDCache() SCB_CleanDCache_by_Addr((uint32_t*)frameBuf0, LCD_SCREEN_WIDTH * LCD_SCREEN_HEIGHT*2) // SO SLOW...
-	//#define __CleanDCache() SCB_CleanDCache() // we no longer need it if we're using the MPU to disable
-	#define __CleanDCache()
-#else
-	#define __CleanDCache()
 #endif
 
+// No cache maintenance at all, neither per primitive nor per frame: the MPU makes both the SRAM and the SDRAM write-through
+// (see mpu.h and MPU_Init()), so that CPU writes are in memory by the time the DMA2D or the LTDC read them.
+
+// ---------- double buffering (FB in SDRAM only) ----------
+
+#define LCD_DIRTY_MAX	16	// beyond that, rectangles get merged
+
+typedef struct {
+	int16_t x0, y0, x1, y1; // x1 and y1 excluded
+} Rect;
+
+uint32_t lcdDrawBuffer;					// where the primitives draw, see __GetAddress()
+#ifdef FB_IN_SDRAM
+_Static_assert(2 * LCD_FB_SIZE_BYTES <= SDRAM_WRITE_READ_ADDR - LCD_FRAME_BUFFER, "both framebuffers must fit below SDRAM_WRITE_READ_ADDR (see disco_base.h)");
+
+static uint32_t lcdShownBuffer;			// scanned out by the LTDC
+static Rect dirty[LCD_DIRTY_MAX];		// drawn since the last swap
+static int dirtyCount = 0;
+static osSemaphoreId vsyncSem;			// given by the LTDC reload interrupt
+#endif
+
+// ---------- text: A8 glyph atlas and string cache, in SDRAM at LCD_TEXT_BUF_ADDR ----------
+
+#define GLYPH_COUNT			('~' - ' ' + 1)
+#define GLYPH_MAX_HEIGHT	24		// Font24
+#define TEXT_CACHE_SLOTS	12
+#define TEXT_CACHE_LEN		40		// longest cached string, longer ones are rendered at each call
+#define TEXT_SLOT_BYTES		(LCD_SCREEN_WIDTH * GLYPH_MAX_HEIGHT)
+
+typedef struct {
+	const sFONT *font;
+	uint8_t *glyphs;		// GLYPH_COUNT glyphs of Width x Height coverage bytes (0x00 or 0xFF), NULL if it didn't fit
+} GlyphAtlas;
+
+typedef struct {
+	const sFONT *font;		// NULL while free
+	uint32_t lastUse;
+	char text[TEXT_CACHE_LEN + 1];
+	uint8_t *image;			// rendered string, A8, one TEXT_SLOT_BYTES slot
+	uint32_t ticket;		// last DMA2D job reading the image
+} TextCacheEntry;
 
+static GlyphAtlas atlas[5];
+static const GlyphAtlas *pAtlas = NULL;	// atlas of pFont, NULL if none (then DrawChar() draws bit by bit)
+static TextCacheEntry textCache[TEXT_CACHE_SLOTS];
+static uint8_t *textScratch;			// strings longer than TEXT_CACHE_LEN
+static uint32_t textScratchTicket = 0;
+static uint32_t textUse = 0;
 
 
 static uint32_t StrokeColor;
@@ -58,10 +102,20 @@ static void DrawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_
 static void DrawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t color);
 #endif
 static void FillTriangle(uint16_t x1, uint16_t x2, uint16_t x3, uint16_t y1, uint16_t y2, uint16_t y3);
-static void LL_FillBuffer(void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t withColor);
-static void LL_ConvertLineToARGB8888(void * pSrc, void *pDst, uint32_t xSize, uint32_t InputColorMode);
+static uint32_t LL_FillBuffer(void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t withColor);
+static uint32_t LL_ConvertBuffer(const void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t SrcOffLine, uint32_t DstOffLine, uint32_t InputColorMode);
 static uint16_t ARGB888ToRGB565(uint32_t RGB_Code);
 static void DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length, uint32_t Color8888);
+static void MarkDirty(int Xpos, int Ypos, int Width, int Height);
+static void BuildAtlas(void);
+static const uint8_t* RenderString(const uint8_t *Text, uint32_t Length, uint32_t *Width, uint32_t **Ticket);
+static uint32_t DrawA8(const uint8_t *pImage, uint32_t ImageWidth, uint16_t Xpos, uint16_t Ypos, const boolean_t isOpaqueBackground);
+static uint32_t LL_BlendA8(const void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t SrcOffLine, uint32_t DstOffLine, const boolean_t isOpaqueBackground);
+static uint32_t LL_LoadCLUT(const uint32_t *pCLUT, uint32_t Size);
+static uint32_t LL_DrawImage(const void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t SrcOffLine, uint32_t DstOffLine, uint32_t InputColorMode, uint32_t CLUTSize, const boolean_t isBlended);
+#ifdef FB_IN_SDRAM
+static uint32_t LL_CopyBuffer(void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine);
+#endif
 
 
 // ============================================= on/off =============================================
@@ -79,12 +133,27 @@ void LCD_Init(void){
 	if (hltdc.LayerCfg[0].PixelFormat == LTDC_PIXEL_FORMAT_RGB565) Error("Pixel Format Error: should be RGB888, check MX_LTDC_Init() or define PF_565");
 #endif
 
+	DISCO_DMA2D_Init();
+
 #ifndef FB_IN_SDRAM
 	HAL_LTDC_SetAddress(&hltdc, frameBuf0, 0);
+	lcdDrawBuffer = frameBuf0;
+#else
+	// front buffer at LCD_FRAME_BUFFER (see MX_LTDC_Init()), back buffer right after, both blank at first
+	lcdShownBuffer = LCD_FRAME_BUFFER;
+	lcdDrawBuffer = LCD_FRAME_BUFFER + LCD_FB_SIZE_BYTES;
+	HAL_LTDC_SetAddress(&hltdc, lcdShownBuffer, 0);
+	LL_FillBuffer((uint32_t *)lcdShownBuffer, LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT, 0, LCD_COLOR_WHITE);
+	LL_FillBuffer((uint32_t *)lcdDrawBuffer, LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT, 0, LCD_COLOR_WHITE);
+
+	osSemaphoreDef(lcdVsync);
+	vsyncSem = osSemaphoreCreate(osSemaphore(lcdVsync), 1);
+	osSemaphoreWait(vsyncSem, 0); // created available
 #endif
 
 	LCD_DisplayOn();
 
+	BuildAtlas();
 	LCD_SetFont(&LCD_DEFAULT_FONT);
 
 	LCD_SetBackColor(LCD_COLOR_WHITE);
@@ -240,6 +309,52 @@ void LCD_Reload(uint32_t ReloadType)
 	HAL_LTDC_Reload (&hltdc, ReloadType);
 }
 
+// ================================================ Double buffering ================================================
+
+/**
+ * @brief  Shows what has been drawn since the last call: the back buffer becomes the front buffer at the next vertical
+ *         blanking (hence no tearing), then the rectangles drawn into it are copied into the new back buffer by the DMA2D,
+ *         so that both buffers hold the same picture again. Blocks until the vertical blanking, i.e. caps the refresh
+ *         rate of the caller to the panel rate (about 60Hz). Returns immediately if nothing has been drawn.
+ *         Task context only. Does nothing if the FB is in RAM (single buffer, primitives draw straight into it).
+ * @retval None
+ */
+void LCD_SwapBuffers(void)
+{
+#ifdef FB_IN_SDRAM
+	uint32_t drawn = lcdDrawBuffer;
+
+	if (dirtyCount == 0)
+		return;
+
+	DISCO_DMA2D_WaitIdle(); // the frame must be complete
+	HAL_LTDC_SetAddress_NoReload(&hltdc, drawn, 0);
+	LCD_Reload(LTDC_RELOAD_VERTICAL_BLANKING); // enables the reload interrupt, see HAL_LTDC_ReloadEventCallback()
+	osSemaphoreWait(vsyncSem, LCD_VSYNC_TIMEOUT_MS);
+
+	lcdDrawBuffer = lcdShownBuffer;
+	lcdShownBuffer = drawn;
+
+	for (int i = 0; i < dirtyCount; i++) {
+		Rect *r = &dirty[i];
+		uint32_t offset = LCD_BYTES_PER_PIXEL * (LCD_SCREEN_WIDTH * r->y0 + r->x0);
+		LL_CopyBuffer((void *)(lcdShownBuffer + offset), (void *)(lcdDrawBuffer + offset), r->x1 - r->x0, r->y1 - r->y0,
+				LCD_SCREEN_WIDTH - (r->x1 - r->x0));
+	}
+	dirtyCount = 0;
+#endif
+}
+
+/**
+ * @brief  LTDC reload interrupt: the new front buffer is being scanned out.
+ */
+void HAL_LTDC_ReloadEventCallback(LTDC_HandleTypeDef *hltdc)
+{
+#ifdef FB_IN_SDRAM
+	osSemaphoreRelease(vsyncSem);
+#endif
+}
+
 // ================================================ Colors ================================================
 
 /**
@@ -289,6 +404,11 @@ void LCD_SetBackColor(uint32_t Color)
 void LCD_SetFont(sFONT *fonts)
 {
 	pFont = fonts;
+
+	pAtlas = NULL;
+	for (int i = 0; i < sizeof(atlas) / sizeof(atlas[0]); i++)
+		if (atlas[i].font == fonts && atlas[i].glyphs != NULL)
+			pAtlas = &atlas[i];
 }
 
 
@@ -302,6 +422,7 @@ void LCD_SetFont(sFONT *fonts)
  */
 uint32_t LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos)
 {
+	DISCO_DMA2D_WaitIdle();
 #ifdef PF_565
 	/* Read data value from SDRAM memory */
 	return *(__IO uint16_t*) (__GetAddress(Xpos, Ypos));
@@ -319,9 +440,9 @@ uint32_t LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos)
  */
 void LCD_DrawPixel(uint16_t Xpos, uint16_t Ypos)
 {
+	DISCO_DMA2D_WaitIdle();
 	__DrawPixel(Xpos, Ypos, STROKE_COLOR);
-	__CleanDCache();
-
+	MarkDirty(Xpos, Ypos, 1, 1);
 }
 
 /**
@@ -333,9 +454,9 @@ void LCD_DrawPixel(uint16_t Xpos, uint16_t Ypos)
  */
 void LCD_DrawPixel_Color(uint16_t Xpos, uint16_t Ypos, uint16_t color)
 {
+	DISCO_DMA2D_WaitIdle();
 	__DrawPixel(Xpos, Ypos, color);
-	__CleanDCache();
-
+	MarkDirty(Xpos, Ypos, 1, 1);
 }
 
 /**
@@ -346,8 +467,9 @@ void LCD_DrawPixel_Color(uint16_t Xpos, uint16_t Ypos, uint16_t color)
  */
 void LCD_FillPixel(uint16_t Xpos, uint16_t Ypos)
 {
+	DISCO_DMA2D_WaitIdle();
 	__DrawPixel(Xpos, Ypos, FILL_COLOR);
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, 1, 1);
 }
 
 /**
@@ -358,8 +480,9 @@ void LCD_FillPixel(uint16_t Xpos, uint16_t Ypos)
  */
 void LCD_ErasePixel(uint16_t Xpos, uint16_t Ypos)
 {
+	DISCO_DMA2D_WaitIdle();
 	__DrawPixel(Xpos, Ypos, BACK_COLOR);
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, 1, 1);
 }
 
 /**
@@ -369,7 +492,8 @@ void LCD_ErasePixel(uint16_t Xpos, uint16_t Ypos)
 void LCD_Clear()
 {
 	/* Clear the LCD */
-	LL_FillBuffer((uint32_t *)(hltdc.LayerCfg[0].FBStartAdress), LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT, 0, BackColor);
+	LL_FillBuffer((uint32_t *)lcdDrawBuffer, LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT, 0, BackColor);
+	MarkDirty(0, 0, LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT);
 }
 
 /**
@@ -398,8 +522,10 @@ void LCD_ClearStringAtLine(uint32_t Line)
  */
 void LCD_DrawChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii, const boolean_t isOpaqueBackground)
 {
-	DrawChar(Xpos, Ypos, &pFont->table[(Ascii-' ') * pFont->Height * ((pFont->Width + 7) / 8)], isOpaqueBackground);
-
+	if (pAtlas != NULL && Ascii >= ' ' && Ascii <= '~')
+		DrawA8(pAtlas->glyphs + (Ascii-' ') * pFont->Width * pFont->Height, pFont->Width, Xpos, Ypos, isOpaqueBackground);
+	else
+		DrawChar(Xpos, Ypos, &pFont->table[(Ascii-' ') * pFont->Height * ((pFont->Width + 7) / 8)], isOpaqueBackground);
 }
 
 /**
@@ -456,6 +582,15 @@ void LCD_DrawString(uint16_t Xpos, uint16_t Ypos, uint8_t *Text, Text_AlignModeT
 		ref_column = 1;
 	}
 
+	/* Whole string in a single DMA2D pass, see RenderString() */
+	if (pAtlas != NULL)
+	{
+		uint32_t width, *ticket;
+		const uint8_t *image = RenderString(Text, size, &width, &ticket);
+		*ticket = DrawA8(image, width, ref_column, Ypos, isOpaqueBackground);
+		return;
+	}
+
 	/* Send the string character by character on LCD */
 	while ((*Text != 0) & (((LCD_SCREEN_WIDTH - (i*pFont->Width)) & 0xFFFF) >= pFont->Width))
 	{
@@ -490,13 +625,13 @@ void LCD_DrawStringAtLine(uint16_t Line, uint8_t *ptr, const boolean_t isOpaqueB
 void LCD_DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
 {
 	LL_FillBuffer((uint32_t *)__GetAddress(Xpos, Ypos), Length, 1, 0, StrokeColor);
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, Length, 1);
 }
 
 void LCD_EraseHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
 {
 	LL_FillBuffer((uint32_t *)__GetAddress(Xpos, Ypos), Length, 1, 0, BackColor);
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, Length, 1);
 }
 
 /**
@@ -505,6 +640,7 @@ void LCD_EraseHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
 static void DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length, uint32_t Color8888)
 {
 	LL_FillBuffer((uint32_t *)__GetAddress(Xpos, Ypos), Length, 1, 0, Color8888);
+	MarkDirty(Xpos, Ypos, Length, 1);
 }
 
 /**
@@ -517,13 +653,13 @@ static void DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length, uint32_t Co
 void LCD_DrawVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
 {
 	LL_FillBuffer((uint32_t *)__GetAddress(Xpos, Ypos), 1, Length, (LCD_SCREEN_WIDTH - 1), StrokeColor);
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, 1, Length);
 }
 
 void LCD_EraseVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
 {
 	LL_FillBuffer((uint32_t *)__GetAddress(Xpos, Ypos), 1, Length, (LCD_SCREEN_WIDTH - 1), BackColor);
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, 1, Length);
 }
 
 
@@ -537,12 +673,10 @@ void LCD_EraseVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
  */
 void LCD_DrawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2){
 	DrawLine(x1, y1, x2, y2, STROKE_COLOR);
-	__CleanDCache();
 }
 
 void LCD_EraseLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2){
 	DrawLine(x1, y1, x2, y2, BACK_COLOR);
-	__CleanDCache();
 }
 
 
@@ -565,6 +699,9 @@ static void DrawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_
 	x = x1;                       /* Start x off at the first pixel */
 	y = y1;                       /* Start y off at the first pixel */
 
+	MarkDirty(x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, deltax + 1, deltay + 1);
+	DISCO_DMA2D_WaitIdle();
+
 	if (x2 >= x1)                 /* The x-values are increasing */
 	{
 		xinc1 = 1;
@@ -640,7 +777,8 @@ void LCD_DrawRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height)
 	LL_FillBuffer((uint32_t *)__GetAddress(Xpos, Ypos), 1, Height, (LCD_SCREEN_WIDTH - 1), StrokeColor);
 	LL_FillBuffer((uint32_t *)__GetAddress((Xpos+Width), Ypos), 1, Height, (LCD_SCREEN_WIDTH - 1), StrokeColor);
 
-	__CleanDCache();
+	MarkDirty(Xpos, Ypos, Width + 1, Height + 1);
+
 }
 
 /**
@@ -660,6 +798,9 @@ void LCD_DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius)
 	current_x = 0;
 	current_y = Radius;
 
+	MarkDirty(Xpos - Radius, Ypos - Radius, 2 * Radius + 1, 2 * Radius + 1);
+	DISCO_DMA2D_WaitIdle();
+
 	while (current_x <= current_y)
 	{
 		__DrawPixel((Xpos + current_x), (Ypos - current_y), STROKE_COLOR);
@@ -689,7 +830,6 @@ void LCD_DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius)
 		}
 		current_x++;
 	}
-	__CleanDCache();
 }
 
 /**
@@ -717,7 +857,6 @@ void LCD_DrawPolygon(pPoint Points, uint16_t PointCount)
 		DrawLine(x, y, Points->X, Points->Y, STROKE_COLOR);
 	}
 
-	__CleanDCache();
 }
 
 /**
@@ -738,6 +877,9 @@ void LCD_DrawEllipse(int Xpos, int Ypos, int XRadius, int YRadius)
 
 	k = (float)(rad2/rad1);
 
+	MarkDirty(Xpos - XRadius, Ypos - YRadius, 2 * XRadius + 1, 2 * YRadius + 1);
+	DISCO_DMA2D_WaitIdle();
+
 	do {
 		__DrawPixel((Xpos-(uint16_t)(x/k)), (Ypos+y), STROKE_COLOR);
 		__DrawPixel((Xpos+(uint16_t)(x/k)), (Ypos+y), STROKE_COLOR);
@@ -753,7 +895,6 @@ void LCD_DrawEllipse(int Xpos, int Ypos, int XRadius, int YRadius)
 	}
 	while (y <= 0);
 
-	__CleanDCache();
 }
 
 
@@ -766,11 +907,12 @@ void LCD_DrawEllipse(int Xpos, int Ypos, int XRadius, int YRadius)
  *
  * Example of use : LCD_DrawBitmap(150, 65, (uint8_t *)stlogo);
  */
-void LCD_DrawBitmap(uint32_t Xpos, uint32_t Ypos, uint8_t *pbmp) // TODO check + DCache
+void LCD_DrawBitmap(uint32_t Xpos, uint32_t Ypos, uint8_t *pbmp) // one DMA2D transfer per line (BMP lines are bottom-up), see LCD_DrawImage()
 {
 	uint32_t index = 0, width = 0, height = 0, bit_pixel = 0;
 	uint32_t address;
 	uint32_t input_color_mode = 0;
+	uint32_t ticket = 0;
 
 	/* Get bitmap data address offset */
 	index = pbmp[10] + (pbmp[11] << 8) + (pbmp[12] << 16)  + (pbmp[13] << 24);
@@ -802,6 +944,8 @@ void LCD_DrawBitmap(uint32_t Xpos, uint32_t Ypos, uint8_t *pbmp) // TODO check +
 		input_color_mode = CM_RGB888;
 	}
 
+	MarkDirty(Xpos, Ypos, width, height);
+
 	/* Bypass the bitmap header */
 	pbmp += (index + (width * (height - 1) * (bit_pixel/8)));
 
@@ -809,7 +953,7 @@ void LCD_DrawBitmap(uint32_t Xpos, uint32_t Ypos, uint8_t *pbmp) // TODO check +
 	for(index=0; index < height; index++) // for every line...
 	{
 		/* Pixel format conversion */
-		LL_ConvertLineToARGB8888((uint32_t *)pbmp, (uint32_t *)address, width, input_color_mode);
+		ticket = LL_ConvertBuffer(pbmp, (uint32_t *)address, width, 1, 0, 0, input_color_mode);
 
 		/* Increment the source and destination buffers */
 #ifdef PF_565
@@ -819,6 +963,68 @@ void LCD_DrawBitmap(uint32_t Xpos, uint32_t Ypos, uint8_t *pbmp) // TODO check +
 #endif
 		pbmp -= width*(bit_pixel/8);
 	}
+
+	/* the bitmap belongs to the caller */
+	DISCO_DMA2D_Wait(ticket);
+}
+
+/**
+ * @brief  Draws an image in a single DMA2D transfer, converting its pixels to the FB pixel format (PFC), and optionally
+ *         blending it over the FB with its alpha channel (CM_ARGB4444, CM_ARGB8888, or CM_L8 with an ARGB palette).
+ *         L8 images first queue a CLUT load. The image is clipped to the screen.
+ *         The transfer is queued: the pixels (and palette) must stay valid until it is done, see DISCO_DMA2D_WaitIdle().
+ *         They may live in the memory-mapped QSPI flash, the internal flash or SDRAM, all of which the DMA2D reads
+ *         directly (no cache maintenance needed, the SDRAM is write-through, see mpu.c).
+ * @param  Xpos: X position
+ * @param  Ypos: Y position
+ * @param  pImage: image
+ * @param  isBlended: if true, blends the image with the FB according to its alpha channel; if false, copies it
+ * @retval None
+ */
+void LCD_DrawImage(uint16_t Xpos, uint16_t Ypos, const LCD_ImageTypeDef *pImage, const boolean_t isBlended)
+{
+	uint32_t w = pImage->width, h = pImage->height;
+	uint32_t clutSize = pImage->colorMode == CM_L8 ? pImage->clutSize : 0;
+
+	if (Xpos >= LCD_SCREEN_WIDTH || Ypos >= LCD_SCREEN_HEIGHT || w == 0 || h == 0)
+		return;
+	if (pImage->colorMode == CM_L8 && (pImage->clut == NULL || clutSize == 0 || clutSize > 256))
+		return;
+	if (Xpos + w > LCD_SCREEN_WIDTH)
+		w = LCD_SCREEN_WIDTH - Xpos;
+	if (Ypos + h > LCD_SCREEN_HEIGHT)
+		h = LCD_SCREEN_HEIGHT - Ypos;
+
+	if (clutSize)
+		LL_LoadCLUT(pImage->clut, clutSize);
+	LL_DrawImage(pImage->pixels, (void *)__GetAddress(Xpos, Ypos), w, h, pImage->width - w, LCD_SCREEN_WIDTH - w,
+			pImage->colorMode, clutSize, isBlended);
+	MarkDirty(Xpos, Ypos, w, h);
+}
+
+/**
+ * @brief  Draws a vertical column of RGB565 pixels, e.g. one time slice of a spectrogram, in a single DMA2D transfer.
+ * @param  Xpos: X position
+ * @param  Ypos: Y position of the top pixel
+ * @param  pixels: Pixels, from top to bottom
+ * @param  Height: Number of pixels
+ * @param  isWaited: true to return once the DMA2D is done with the pixels, false to return at once: the pixels must
+ *         then stay valid until DISCO_DMA2D_WaitIdle() (as in display.c, which draws a whole batch before waiting)
+ * @retval None
+ */
+void LCD_DrawColumn(uint16_t Xpos, uint16_t Ypos, const uint16_t *pixels, uint16_t Height, const boolean_t isWaited)
+{
+	if (Xpos >= LCD_SCREEN_WIDTH || Ypos >= LCD_SCREEN_HEIGHT || Height == 0)
+		return;
+	if (Ypos + Height > LCD_SCREEN_HEIGHT)
+		Height = LCD_SCREEN_HEIGHT - Ypos;
+
+	/* one pixel per line, i.e. the source is read contiguously and the FB with a stride of one screen line */
+	uint32_t ticket = LL_ConvertBuffer(pixels, (void *)__GetAddress(Xpos, Ypos), 1, Height, 0, LCD_SCREEN_WIDTH - 1, DMA2D_INPUT_RGB565);
+	MarkDirty(Xpos, Ypos, 1, Height);
+
+	if (isWaited)
+		DISCO_DMA2D_Wait(ticket);
 }
 
 /**
@@ -835,6 +1041,7 @@ void LCD_FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height)
 
 	/* Fill the rectangle */
 	LL_FillBuffer((uint32_t *)x_address, Width, Height, (LCD_SCREEN_WIDTH - Width), FillColor);
+	MarkDirty(Xpos, Ypos, Width, Height);
 }
 
 
@@ -881,8 +1088,6 @@ void LCD_FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius)
 		current_x++;
 	}
 
-	__CleanDCache();
-
 }
 
 /**
@@ -950,7 +1155,6 @@ void LCD_FillPolygon(pPoint Points, uint16_t PointCount)
 	FillTriangle(X_first, X_center, X2, Y_first, Y_center, Y2);
 	FillTriangle(X_center, X2, X_first, Y_center, Y2, Y_first);
 
-	__CleanDCache();
 }
 
 /**
@@ -986,7 +1190,6 @@ void LCD_FillEllipse(int Xpos, int Ypos, int XRadius, int YRadius) // TODO check
 	}
 	while (y <= 0);
 
-	__CleanDCache();
 }
 
 
@@ -996,7 +1199,7 @@ void LCD_FillEllipse(int Xpos, int Ypos, int XRadius, int YRadius) // TODO check
  *******************************************************************************/
 
 /**
- * @brief  Draws a character on LCD.
+ * @brief  Draws a character on LCD, pixel by pixel (fonts without an atlas only, see BuildAtlas()).
  * @param  Xpos: Line where to display the character shape
  * @param  Ypos: Start column address
  * @param  c: Pointer to the character data
@@ -1015,6 +1218,9 @@ static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c, const boole
 
 	offset =  8 *((width + 7)/8) -  width ;
 
+	MarkDirty(Xpos, Ypos, width, height);
+	DISCO_DMA2D_WaitIdle();
+
 	for(i = 0; i < height; i++)
 	{
 		pchar = ((uint8_t *)c + (width + 7)/8 * i);
@@ -1050,7 +1256,6 @@ static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c, const boole
 		Ypos++;
 	}
 
-	__CleanDCache();
 }
 
 /**
@@ -1130,10 +1335,175 @@ static void FillTriangle(uint16_t x1, uint16_t x2, uint16_t x3, uint16_t y1, uin
 		y += yinc2;                 /* Change the y as appropriate */
 	}
 
-	__CleanDCache();
+}
+
+/**
+ * @brief  Adds a rectangle to the areas drawn since the last LCD_SwapBuffers(), clipped to the screen.
+ *         Overlapping or touching rectangles are merged (e.g. the pixels of a line), and when the list is full the
+ *         rectangle is merged with the one whose area grows the least.
+ */
+static void MarkDirty(int Xpos, int Ypos, int Width, int Height)
+{
+#ifdef FB_IN_SDRAM
+	Rect n = { Xpos < 0 ? 0 : Xpos, Ypos < 0 ? 0 : Ypos,
+			Xpos + Width > LCD_SCREEN_WIDTH ? LCD_SCREEN_WIDTH : Xpos + Width,
+			Ypos + Height > LCD_SCREEN_HEIGHT ? LCD_SCREEN_HEIGHT : Ypos + Height };
+	int best = -1;
+	int32_t bestGrowth = INT32_MAX;
+
+	if (n.x0 >= n.x1 || n.y0 >= n.y1)
+		return;
+
+	for (int i = 0; i < dirtyCount; i++) {
+		Rect *r = &dirty[i];
+		Rect u = { r->x0 < n.x0 ? r->x0 : n.x0, r->y0 < n.y0 ? r->y0 : n.y0, r->x1 > n.x1 ? r->x1 : n.x1, r->y1 > n.y1 ? r->y1 : n.y1 };
+		int32_t growth = (u.x1 - u.x0) * (u.y1 - u.y0) - (r->x1 - r->x0) * (r->y1 - r->y0);
+
+		if (n.x0 <= r->x1 && n.x1 >= r->x0 && n.y0 <= r->y1 && n.y1 >= r->y0) {
+			*r = u; // overlapping or touching
+			return;
+		}
+		if (growth < bestGrowth) {
+			bestGrowth = growth;
+			best = i;
+		}
+	}
+
+	if (dirtyCount < LCD_DIRTY_MAX)
+		dirty[dirtyCount++] = n;
+	else {
+		Rect *r = &dirty[best];
+		if (n.x0 < r->x0) r->x0 = n.x0;
+		if (n.y0 < r->y0) r->y0 = n.y0;
+		if (n.x1 > r->x1) r->x1 = n.x1;
+		if (n.y1 > r->y1) r->y1 = n.y1;
+	}
+#endif
+}
+
+/**
+ * @brief  Expands the 1 bit per pixel Font8 to Font24 into A8 glyph atlases (one coverage byte per pixel) that the
+ *         DMA2D can blend directly, and lays out the string cache. The text buffer is in SDRAM, see LCD_TEXT_BUF_ADDR.
+ */
+static void BuildAtlas(void)
+{
+	static sFONT *const fonts[] = { &Font8, &Font12, &Font16, &Font20, &Font24 };
+	uint8_t *p = (uint8_t *)LCD_TEXT_BUF_ADDR;
+	uint8_t *end = p + LCD_TEXT_BUF_SIZE_BYTES;
+
+	for (int i = 0; i < TEXT_CACHE_SLOTS; i++) {
+		textCache[i].font = NULL;
+		textCache[i].lastUse = 0;
+		textCache[i].image = p;
+		textCache[i].ticket = 0;
+		p += TEXT_SLOT_BYTES;
+	}
+	textScratch = p;
+	p += TEXT_SLOT_BYTES;
+
+	for (int f = 0; f < sizeof(fonts) / sizeof(fonts[0]); f++) {
+		const sFONT *font = fonts[f];
+		uint32_t bytesPerRow = (font->Width + 7) / 8;
+
+		atlas[f].font = font;
+		atlas[f].glyphs = NULL;
+		if (font->Height > GLYPH_MAX_HEIGHT || p + GLYPH_COUNT * font->Width * font->Height > end)
+			continue;
+
+		atlas[f].glyphs = p;
+		for (uint32_t c = 0; c < GLYPH_COUNT; c++)
+			for (uint32_t y = 0; y < font->Height; y++) {
+				const uint8_t *row = &font->table[(c * font->Height + y) * bytesPerRow];
+				for (uint32_t x = 0; x < font->Width; x++)
+					*p++ = (row[x >> 3] & (0x80 >> (x & 7))) ? 0xFF : 0x00;
+			}
+	}
+}
+
+/**
+ * @brief  Returns the A8 image of a string in the current font, from the cache if it was drawn recently (labels,
+ *         units, button texts...), else rendered glyph row by glyph row into the least recently used slot.
+ *         Only the characters that fit in the screen width are rendered, as LCD_DrawString() always did.
+ * @param  Width: returns the image width, in pixels (the height is the font height)
+ * @param  Ticket: returns where to store the ticket of the DMA2D job that reads the image, so that the slot isn't
+ *         rendered again before that job is done
+ */
+static const uint8_t* RenderString(const uint8_t *Text, uint32_t Length, uint32_t *Width, uint32_t **Ticket)
+{
+	uint32_t w = pFont->Width, h = pFont->Height;
+	uint32_t count = Length < LCD_SCREEN_WIDTH / w ? Length : LCD_SCREEN_WIDTH / w;
+	uint8_t *image = textScratch;
+
+	*Width = count * w;
+	*Ticket = &textScratchTicket;
+	textUse++;
+
+	if (Length <= TEXT_CACHE_LEN) {
+		TextCacheEntry *lru = &textCache[0];
+
+		for (int i = 0; i < TEXT_CACHE_SLOTS; i++) {
+			TextCacheEntry *e = &textCache[i];
+			if (e->font == pFont && strcmp(e->text, (const char *)Text) == 0) {
+				e->lastUse = textUse;
+				*Ticket = &e->ticket;
+				return e->image;
+			}
+			if (e->lastUse < lru->lastUse)
+				lru = e;
+		}
+
+		lru->font = pFont;
+		lru->lastUse = textUse;
+		memcpy(lru->text, Text, Length + 1);
+		image = lru->image;
+		*Ticket = &lru->ticket;
+	}
+
+	DISCO_DMA2D_Wait(**Ticket);
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t c = (Text[i] >= ' ' && Text[i] <= '~') ? Text[i] : '?';
+		const uint8_t *glyph = pAtlas->glyphs + (c - ' ') * w * h;
+		for (uint32_t y = 0; y < h; y++)
+			memcpy(image + y * count * w + i * w, glyph + y * w, w);
+	}
+	return image;
+}
+
+/**
+ * @brief  Draws an A8 image (glyph or rendered string, font height) with the stroke color, clipped to the screen.
+ * @retval DMA2D job ticket
+ */
+static uint32_t DrawA8(const uint8_t *pImage, uint32_t ImageWidth, uint16_t Xpos, uint16_t Ypos, const boolean_t isOpaqueBackground)
+{
+	uint32_t w = ImageWidth, h = pFont->Height, ticket;
+
+	if (Xpos >= LCD_SCREEN_WIDTH || Ypos >= LCD_SCREEN_HEIGHT || w == 0)
+		return 0;
+	if (Xpos + w > LCD_SCREEN_WIDTH)
+		w = LCD_SCREEN_WIDTH - Xpos;
+	if (Ypos + h > LCD_SCREEN_HEIGHT)
+		h = LCD_SCREEN_HEIGHT - Ypos;
+
+	ticket = LL_BlendA8(pImage, (void *)__GetAddress(Xpos, Ypos), w, h, ImageWidth - w, LCD_SCREEN_WIDTH - w, isOpaqueBackground);
+	MarkDirty(Xpos, Ypos, w, h);
+	return ticket;
 }
 
 // ================================================ DMA2D based functions  ================================================
+// These build DMA2D jobs (register images) and queue them, see disco_dma2d.c: they return before the transfer is done.
+
+#ifdef PF_565
+#define FB_OUTPUT_MODE	DMA2D_OUTPUT_RGB565
+#define FB_INPUT_MODE	DMA2D_INPUT_RGB565
+#else
+#define FB_OUTPUT_MODE	DMA2D_OUTPUT_ARGB8888
+#define FB_INPUT_MODE	DMA2D_INPUT_ARGB8888
+#endif
+
+// FGPFCCR/BGPFCCR value: input color mode, alpha mode and alpha
+#define JOB_PFCCR(ColorMode, AlphaMode, Alpha)	((ColorMode) | ((AlphaMode) << DMA2D_FGPFCCR_AM_Pos) | ((uint32_t)(Alpha) << DMA2D_FGPFCCR_ALPHA_Pos))
+#define JOB_NLR(xSize, ySize)					(((xSize) << DMA2D_NLR_PL_Pos) | (ySize))
 
 /**
  * @brief  Fills a buffer.
@@ -1142,80 +1512,186 @@ static void FillTriangle(uint16_t x1, uint16_t x2, uint16_t x3, uint16_t y1, uin
  * @param  ySize: Buffer height
  * @param  OffLine: Offset
  * @param  withColor: fill color in ARGB888 format (even if FB may use RGB565)
- * @retval None
+ * @retval DMA2D job ticket
  */
-static void LL_FillBuffer(void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t withColor)
+static uint32_t LL_FillBuffer(void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t withColor)
 {
-	/* Register to memory mode with ARGB8888 as color Mode */
-	hdma2d.Init.Mode         = DMA2D_R2M;
+	dma2d_job_t job = { 0 };
+
+	/* Register to memory mode, the output color is in the FB pixel format */
+	job.CR = DMA2D_R2M;
+	job.OPFCCR = FB_OUTPUT_MODE;
 #ifdef PF_565
-	/* RGB565 "output" format */
-	hdma2d.Init.ColorMode    = DMA2D_RGB565;
+	job.OCOLR = ARGB888ToRGB565(withColor);
 #else
-	/* ARGB8888 "output" format */
-	hdma2d.Init.ColorMode    = DMA2D_ARGB8888;
+	job.OCOLR = withColor;
 #endif
-	hdma2d.Init.OutputOffset = OffLine;
+	job.OMAR = (uint32_t)pDst;
+	job.OOR = OffLine;
+	job.NLR = JOB_NLR(xSize, ySize);
 
-	hdma2d.Instance = DMA2D;
+	return DISCO_DMA2D_Submit(&job);
+}
 
-	/* DMA2D Initialization */
-	if(HAL_DMA2D_Init(&hdma2d) == HAL_OK)
+#ifdef FB_IN_SDRAM
+/**
+ * @brief  Copies a rectangle b/w two buffers with the FB pixel format and size.
+ * @param  pSrc: Pointer to the top left pixel in the source buffer
+ * @param  pDst: Pointer to the top left pixel in the destination buffer
+ * @param  xSize: Rectangle width
+ * @param  ySize: Rectangle height
+ * @param  OffLine: Offset from the end of a line to the start of the next one, in pixels (same in both buffers)
+ * @retval DMA2D job ticket
+ */
+static uint32_t LL_CopyBuffer(void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine)
+{
+	dma2d_job_t job = { 0 };
+
+	job.CR = DMA2D_M2M;
+	job.FGMAR = (uint32_t)pSrc;
+	job.FGOR = OffLine;
+	job.FGPFCCR = JOB_PFCCR(FB_INPUT_MODE, DMA2D_NO_MODIF_ALPHA, 0xFF);
+	job.OPFCCR = FB_OUTPUT_MODE;
+	job.OMAR = (uint32_t)pDst;
+	job.OOR = OffLine;
+	job.NLR = JOB_NLR(xSize, ySize);
+
+	return DISCO_DMA2D_Submit(&job);
+}
+#endif
+
+/**
+ * @brief  Draws an A8 image into the FB with the stroke color, in a single blending pass.
+ *         The foreground layer is the image with the stroke color. The background layer is either the FB itself, or
+ *         for an opaque background the same image with its alpha forced to 0xFF and the background color, i.e. a
+ *         plain rectangle, which saves reading the FB.
+ * @param  pSrc: Pointer to the top left pixel of the image
+ * @param  pDst: Pointer to the top left pixel in the FB
+ * @param  xSize: Width
+ * @param  ySize: Height
+ * @param  SrcOffLine: Line offset in the image, in pixels
+ * @param  DstOffLine: Line offset in the FB, in pixels
+ * @retval DMA2D job ticket
+ */
+static uint32_t LL_BlendA8(const void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t SrcOffLine, uint32_t DstOffLine, const boolean_t isOpaqueBackground)
+{
+	dma2d_job_t job = { 0 };
+
+	job.CR = DMA2D_M2M_BLEND;
+
+	/* Foreground layer: coverage as alpha, stroke color */
+	job.FGMAR = (uint32_t)pSrc;
+	job.FGOR = SrcOffLine;
+	job.FGPFCCR = JOB_PFCCR(DMA2D_INPUT_A8, DMA2D_NO_MODIF_ALPHA, 0xFF);
+	job.FGCOLR = StrokeColor & 0x00FFFFFF;
+
+	/* Background layer */
+	if (isOpaqueBackground == true)
 	{
-		if(HAL_DMA2D_ConfigLayer(&hdma2d, 0) == HAL_OK)
-		{
-			if (HAL_DMA2D_Start(&hdma2d, withColor, (uint32_t)pDst, xSize, ySize) == HAL_OK)
-			{
-				/* Polling For DMA transfer */
-				HAL_DMA2D_PollForTransfer(&hdma2d, 10); // TODO : adapt to to CMSIS-RTOS
-			}
-		}
+		job.BGMAR = (uint32_t)pSrc;
+		job.BGOR = SrcOffLine;
+		job.BGPFCCR = JOB_PFCCR(DMA2D_INPUT_A8, DMA2D_REPLACE_ALPHA, 0xFF);
+		job.BGCOLR = BackColor & 0x00FFFFFF;
+	}
+	else
+	{
+		job.BGMAR = (uint32_t)pDst;
+		job.BGOR = DstOffLine;
+		job.BGPFCCR = JOB_PFCCR(FB_INPUT_MODE, DMA2D_NO_MODIF_ALPHA, 0xFF);
 	}
+
+	job.OPFCCR = FB_OUTPUT_MODE;
+	job.OMAR = (uint32_t)pDst;
+	job.OOR = DstOffLine;
+	job.NLR = JOB_NLR(xSize, ySize);
+
+	return DISCO_DMA2D_Submit(&job);
 }
 
 /**
- * @brief  Copy a line to the FB in ARGB8888 pixel format. (utilisé uniquement par DrawBitMap)
- * @param  pSrc: Pointer to source buffer
- * @param  pDst: Output color
- * @param  xSize: Buffer width
- * @param  ColorMode: Input color mode
- * @retval None
+ * @brief  Copy a rectangle to the FB, converting it to the FB pixel format (LCD_DrawBitmap(), LCD_DrawColumn()).
+ * @param  pSrc: Pointer to the top left pixel in the source buffer
+ * @param  pDst: Pointer to the top left pixel in the FB
+ * @param  xSize: Rectangle width
+ * @param  ySize: Rectangle height
+ * @param  SrcOffLine: Line offset in the source buffer, in pixels
+ * @param  DstOffLine: Line offset in the FB, in pixels
+ * @param  InputColorMode: Input color mode
+ * @retval DMA2D job ticket
  */
-static void LL_ConvertLineToARGB8888(void *pSrc, void *pDst, uint32_t xSize, uint32_t InputColorMode) // TODO check
+static uint32_t LL_ConvertBuffer(const void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t SrcOffLine, uint32_t DstOffLine, uint32_t InputColorMode)
 {
-	/* Configure the DMA2D Mode, Color Mode and output offset */
-	hdma2d.Init.Mode         = DMA2D_M2M_PFC;
+	dma2d_job_t job = { 0 };
+
+	job.CR = DMA2D_M2M_PFC;
+	job.FGMAR = (uint32_t)pSrc;
+	job.FGOR = SrcOffLine;
+	job.FGPFCCR = JOB_PFCCR(InputColorMode, DMA2D_NO_MODIF_ALPHA, 0xFF);
+	job.OPFCCR = FB_OUTPUT_MODE;
+	job.OMAR = (uint32_t)pDst;
+	job.OOR = DstOffLine;
+	job.NLR = JOB_NLR(xSize, ySize);
+
+	return DISCO_DMA2D_Submit(&job);
+}
 
-	/* Framebuffer pixel format : */
-#ifdef PF_565
-	/* RGB565 "output" format */
-	hdma2d.Init.ColorMode    = DMA2D_RGB565;
-#else
-	/* ARGB8888 "output" format */
-	hdma2d.Init.InputColorMode    = DMA2D_ARGB8888;
-#endif
-	hdma2d.Init.OutputOffset = 0;
+/**
+ * @brief  Loads the foreground CLUT, for the L8 transfers queued after it.
+ * @param  pCLUT: ARGB8888 colors
+ * @param  Size: Number of colors, 1 to 256
+ * @retval DMA2D job ticket
+ */
+static uint32_t LL_LoadCLUT(const uint32_t *pCLUT, uint32_t Size)
+{
+	dma2d_job_t job = { 0 };
+
+	job.CR = DMA2D_JOB_CLUT_LOAD;
+	job.FGCMAR = (uint32_t)pCLUT;
+	job.FGPFCCR = DMA2D_INPUT_L8 | (DMA2D_CCM_ARGB8888 << DMA2D_FGPFCCR_CCM_Pos) | ((Size - 1) << DMA2D_FGPFCCR_CS_Pos);
+
+	return DISCO_DMA2D_Submit(&job);
+}
 
-	/* Active Layer Configuration */
-	hdma2d.LayerCfg[0].AlphaMode = DMA2D_NO_MODIF_ALPHA;
-	hdma2d.LayerCfg[0].InputAlpha = 0xFF;
-	hdma2d.LayerCfg[0].InputColorMode = InputColorMode;
-	hdma2d.LayerCfg[0].InputOffset = 0;
+/**
+ * @brief  Copies or blends an image into the FB, converting it to the FB pixel format.
+ *         Without blending, an image already in the FB pixel format is copied as is (DMA2D_M2M, no conversion).
+ * @param  pSrc: Pointer to the top left pixel of the image
+ * @param  pDst: Pointer to the top left pixel in the FB
+ * @param  xSize: Width
+ * @param  ySize: Height
+ * @param  SrcOffLine: Line offset in the image, in pixels
+ * @param  DstOffLine: Line offset in the FB, in pixels
+ * @param  InputColorMode: Color mode of the image
+ * @param  CLUTSize: Number of colors of the loaded CLUT (DMA2D_INPUT_L8 only, see LL_LoadCLUT())
+ * @param  isBlended: Blends the image over the FB with its alpha
+ * @retval DMA2D job ticket
+ */
+static uint32_t LL_DrawImage(const void *pSrc, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t SrcOffLine, uint32_t DstOffLine, uint32_t InputColorMode, uint32_t CLUTSize, const boolean_t isBlended)
+{
+	dma2d_job_t job = { 0 };
 
-	hdma2d.Instance = DMA2D;
+	job.FGMAR = (uint32_t)pSrc;
+	job.FGOR = SrcOffLine;
+	job.FGPFCCR = JOB_PFCCR(InputColorMode, DMA2D_NO_MODIF_ALPHA, 0xFF);
+	if (CLUTSize)
+		job.FGPFCCR |= (DMA2D_CCM_ARGB8888 << DMA2D_FGPFCCR_CCM_Pos) | ((CLUTSize - 1) << DMA2D_FGPFCCR_CS_Pos);
 
-	/* DMA2D Initialization */
-	if(HAL_DMA2D_Init(&hdma2d) == HAL_OK)
+	if (isBlended == true)
 	{
-		if(HAL_DMA2D_ConfigLayer(&hdma2d, 1) == HAL_OK)
-		{
-			if (HAL_DMA2D_Start(&hdma2d, (uint32_t)pSrc, (uint32_t)pDst, xSize, 1) == HAL_OK)
-			{
-				/* Polling For DMA transfer */
-				HAL_DMA2D_PollForTransfer(&hdma2d, 10);
-			}
-		}
+		job.CR = DMA2D_M2M_BLEND;
+		job.BGMAR = (uint32_t)pDst;
+		job.BGOR = DstOffLine;
+		job.BGPFCCR = JOB_PFCCR(FB_INPUT_MODE, DMA2D_NO_MODIF_ALPHA, 0xFF);
 	}
+	else
+		job.CR = InputColorMode == FB_INPUT_MODE ? DMA2D_M2M : DMA2D_M2M_PFC;
+
+	job.OPFCCR = FB_OUTPUT_MODE;
+	job.OMAR = (uint32_t)pDst;
+	job.OOR = DstOffLine;
+	job.NLR = JOB_NLR(xSize, ySize);
+
+	return DISCO_DMA2D_Submit(&job);
 }
 
 // =============================== utilities ====================================
@@ -41,7 +41,9 @@
 #include "bsp/disco_sai.h"
 #include "bsp/wm8994.h"
 #include "stdio.h"
+#include "string.h"
 #include "main.h"
+#include <logger.h>
 
 
 extern SAI_HandleTypeDef hsai_BlockA2; // see main.c
@@ -49,6 +51,20 @@ extern SAI_HandleTypeDef hsai_BlockB2;
 extern DMA_HandleTypeDef hdma_sai2_a;
 extern DMA_HandleTypeDef hdma_sai2_b;
 
+// streams started by start_Audio_Processing(), restarted by setAudioFrequency():
+static audio_sample_t *saiBufOutput;
+static audio_sample_t *saiBufInput;
+static uint32_t saiBufSize;
+
+static volatile uint8_t rxRestartPending = 0; // input stream restart armed by setInput(), see HAL_SAI_TxCpltCallback()
+
+// RX/TX phase monitor:
+static sai_monitor_t monitor;
+static int32_t phaseRef = -1; // phase right after the streams were (re)started, -1 until it has been sampled
+
+static uint8_t inputVolume(uint16_t InputDevice);
+static void startStreams(void);
+
 // -------------------------------- functions --------------------------------
 
 void Error_Handler();
@@ -65,7 +81,7 @@ void Error_Handler();
  *
  * @retval AUDIO_OK if correct communication, else wrong communication
  */
-void start_Audio_Processing(int16_t *buf_output, int16_t *buf_input,
+void start_Audio_Processing(audio_sample_t *buf_output, audio_sample_t *buf_input,
 		uint32_t audio_dma_buf_size, uint16_t InputDevice, uint32_t AudioFreq) {
 
 	if ((InputDevice != INPUT_DEVICE_INPUT_LINE_1)
@@ -82,37 +98,208 @@ void start_Audio_Processing(int16_t *buf_output, int16_t *buf_input,
 	/* Initialize the codec internal registers */
 	wm8994_Init(AUDIO_I2C_ADDRESS, InputDevice | OUTPUT_DEVICE_HEADPHONE, 100, AudioFreq);
 	/* set lower initial volume for Line In */
-	if (InputDevice == INPUT_DEVICE_INPUT_LINE_1)
-		wm8994_SetVolume(AUDIO_I2C_ADDRESS, 75);
-	else if (InputDevice == INPUT_DEVICE_DIGITAL_MICROPHONE_2)
-		wm8994_SetVolume(AUDIO_I2C_ADDRESS, 200);
+	wm8994_SetVolume(AUDIO_I2C_ADDRESS, inputVolume(InputDevice));
 	// unmute CODEC output
 	wm8994_SetMute(AUDIO_I2C_ADDRESS, AUDIO_MUTE_OFF);
 
 	//  Start DMA transfers
 
-	/* Start Recording */
-	HAL_SAI_Receive_DMA(&hsai_BlockB2, (uint8_t*) buf_input, audio_dma_buf_size);
-	/* Start Playback */
-	HAL_SAI_Transmit_DMA(&hsai_BlockA2, (uint8_t*) buf_output, audio_dma_buf_size);
+	saiBufOutput = buf_output;
+	saiBufInput = buf_input;
+	saiBufSize = audio_dma_buf_size;
 
+	saiMonitorReset();
+	startStreams();
 }
 
-// work underway (so far the audio input choice b/w Mic and Line is carried out in main.c: MX_SAI2_Init())
-void setInput(uint16_t InputDevice) {
+/**
+ * Changes the sampling rate of the running streams: the CODEC output is muted, both DMA streams are stopped,
+ * SAI2 and the CODEC are reconfigured for AudioFreq, then the streams are restarted from zeroed buffers.
+ *
+ * Only the SAI master clock divider changes: PLLSAI also clocks the LTDC and the 48MHz domain (USB, SDMMC),
+ * hence it is left untouched, and the actual rate is the nearest one the divider can reach (see HAL_SAI_Init()).
+ *
+ * Takes a few milliseconds (I2C transfers to the CODEC), hence it must be called from a control task, not from the audio task.
+ * Also, the touchscreen shares the I2C bus with the CODEC, so the caller should be the task that polls the touchscreen.
+ *
+ * @param AudioFreq SAI_AUDIO_FREQUENCY_16K, SAI_AUDIO_FREQUENCY_48K, etc
+ * @retval AUDIO_OK or AUDIO_ERROR
+ */
+uint8_t setAudioFrequency(uint32_t AudioFreq) {
+
+	uint8_t ret = AUDIO_OK;
 
-	if ((InputDevice != INPUT_DEVICE_INPUT_LINE_1) && (InputDevice != INPUT_DEVICE_DIGITAL_MICROPHONE_2)) Error_Handler();
+	if (saiBufSize == 0)
+		return AUDIO_ERROR; // streams not started yet
 
-	HAL_SAI_Abort(&hsai_BlockB2);
-	HAL_SAI_DeInit(&hsai_BlockB2);
+	wm8994_SetMute(AUDIO_I2C_ADDRESS, AUDIO_MUTE_ON);
+
+	HAL_SAI_DMAStop(&hsai_BlockB2);
+	HAL_SAI_DMAStop(&hsai_BlockA2);
+
+	// block B is a slave to block A, hence it only needs to be re-enabled after block A has been reconfigured
+	hsai_BlockA2.Init.AudioFrequency = AudioFreq;
+	if (HAL_SAI_Init(&hsai_BlockA2) != HAL_OK || HAL_SAI_Init(&hsai_BlockB2) != HAL_OK)
+		ret = AUDIO_ERROR;
+	__HAL_SAI_ENABLE(&hsai_BlockA2); // same bug fix as in MX_SAI2_Init()
+	__HAL_SAI_ENABLE(&hsai_BlockB2);
+
+	if (wm8994_SetFrequency(AUDIO_I2C_ADDRESS, AudioFreq) != 0)
+		ret = AUDIO_ERROR;
+
+	memset(saiBufOutput, 0, saiBufSize * sizeof(audio_sample_t));
+	memset(saiBufInput, 0, saiBufSize * sizeof(audio_sample_t));
+
+	rxRestartPending = 0; // both streams are restarted together here
+	saiMonitorReset();
+	startStreams();
+
+	wm8994_SetMute(AUDIO_I2C_ADDRESS, AUDIO_MUTE_OFF);
+
+	return ret;
+}
+
+/**
+ * Switches the audio input b/w LineIn and MicIn while the output stream keeps running:
+ * the input stream is stopped, the CODEC input path and the SAI input slots are reconfigured,
+ * then the input stream restart is armed for the next wrap-around of the output DMA buffer (see HAL_SAI_TxCpltCallback()),
+ * so that both streams are in phase again, exactly as when they are started together by start_Audio_Processing().
+ *
+ * The audio task receives no frame until the input stream has restarted, hence the output must be faded out
+ * beforehand (see audioSetInput() in audio.c). Takes a few milliseconds (I2C transfers to the CODEC),
+ * hence it must be called from a control task, like setAudioFrequency().
+ *
+ * @param InputDevice is either INPUT_DEVICE_DIGITAL_MICROPHONE_2 or INPUT_DEVICE_INPUT_LINE_1
+ * @retval AUDIO_OK or AUDIO_ERROR
+ */
+uint8_t setInput(uint16_t InputDevice) {
+
+	uint8_t ret = AUDIO_OK;
+
+	if ((InputDevice != INPUT_DEVICE_INPUT_LINE_1) && (InputDevice != INPUT_DEVICE_DIGITAL_MICROPHONE_2))
+		return AUDIO_ERROR;
+	if (saiBufSize == 0)
+		return AUDIO_ERROR; // streams not started yet
+
+	HAL_SAI_DMAStop(&hsai_BlockB2);
+
+	if (wm8994_SetInput(AUDIO_I2C_ADDRESS, InputDevice, inputVolume(InputDevice)) != 0)
+		ret = AUDIO_ERROR;
 
 	if (InputDevice == INPUT_DEVICE_DIGITAL_MICROPHONE_2) hsai_BlockB2.SlotInit.SlotActive = CODEC_AUDIOFRAME_MICIN; // dig mic 2
 	else if (InputDevice == INPUT_DEVICE_INPUT_LINE_1) hsai_BlockB2.SlotInit.SlotActive = CODEC_AUDIOFRAME_LINEIN; // line in
 
-	HAL_SAI_Init(&hsai_BlockB2);
-	__HAL_SAI_ENABLE(&hsai_BlockB2);
+	if (HAL_SAI_Init(&hsai_BlockB2) != HAL_OK)
+		ret = AUDIO_ERROR;
 
-	// TODO : HAL_SAI_Receive_DMA(&hsai_BlockB2, (uint8_t*)buf_input, audio_dma_buf_size);
+	// block B gets enabled by HAL_SAI_Receive_DMA(), in the output DMA interrupt:
+	rxRestartPending = 1;
+
+	return ret;
+}
+
+/*------------------------------------------------------------------------------
+ RX/TX phase monitor
+ ----------------------------------------------------------------------------*/
+
+/**
+ * Samples the positions of both DMA streams (from their NDTR counters) and updates the RX-to-TX phase statistics.
+ * Called from the four SAI DMA callbacks, i.e. twice per audio frame on each stream.
+ *
+ * Both SAI blocks share the same bit clock, hence the phase should never move once the streams are running:
+ * a drift means that a stream has been stopped, has lost data (e.g. DMA FIFO error) or has been restarted out of phase,
+ * after which the audio loop would no longer process the halves it expects (see the slip buffer in audio.c).
+ */
+void saiMonitorSample(void) {
+
+	if (saiBufSize == 0 || hsai_BlockB2.State != HAL_SAI_STATE_BUSY_RX)
+		return; // input stream stopped, see setInput()
+
+	uint32_t txPos = saiBufSize - __HAL_DMA_GET_COUNTER(&hdma_sai2_a);
+	uint32_t rxPos = saiBufSize - __HAL_DMA_GET_COUNTER(&hdma_sai2_b);
+	int32_t phase = (rxPos + saiBufSize - txPos) % saiBufSize;
+
+	monitor.phase = phase;
+	monitor.samples++;
+
+	if (phaseRef < 0) {
+		phaseRef = phase;
+		return;
+	}
+
+	// deviation from the reference phase, in [-saiBufSize/2, saiBufSize/2):
+	int32_t drift = (phase - phaseRef + saiBufSize + saiBufSize / 2) % saiBufSize - saiBufSize / 2;
+
+	if (drift < monitor.driftMin)
+		monitor.driftMin = drift;
+	if (drift > monitor.driftMax)
+		monitor.driftMax = drift;
+	if (drift > SAI_PHASE_TOLERANCE || drift < -SAI_PHASE_TOLERANCE)
+		monitor.driftEvents++;
+}
+
+/**
+ * Forgets the reference phase: called whenever a stream is (re)started.
+ */
+void saiMonitorReset(void) {
+
+	phaseRef = -1;
+	monitor.samples = 0;
+	monitor.driftMin = 0;
+	monitor.driftMax = 0;
+}
+
+/**
+ * Copies the monitor statistics. May be called from any task.
+ */
+void saiMonitorGet(sai_monitor_t *m) {
+
+	__disable_irq();
+	*m = monitor;
+	__enable_irq();
+}
+
+/**
+ * Current position of the output DMA stream in its buffer.
+ */
+uint32_t saiGetTxPosition(void) {
+
+	return saiBufSize - __HAL_DMA_GET_COUNTER(&hdma_sai2_a);
+}
+
+/**
+ * Current position of the input DMA stream in its buffer.
+ */
+uint32_t saiGetRxPosition(void) {
+
+	return saiBufSize - __HAL_DMA_GET_COUNTER(&hdma_sai2_b);
+}
+
+/**
+ * Starts both DMA streams from the beginning of their buffers.
+ * If they share a single buffer (see AUDIO_IN_PLACE in disco_sai.h), the output stream must read each sample before
+ * the input stream overwrites it, hence it is started first. Otherwise the input stream is started first, as it is a slave.
+ */
+static void startStreams(void) {
+
+	if (saiBufOutput == saiBufInput) {
+		/* Start Playback */
+		HAL_SAI_Transmit_DMA(&hsai_BlockA2, (uint8_t*) saiBufOutput, saiBufSize);
+		/* Start Recording */
+		HAL_SAI_Receive_DMA(&hsai_BlockB2, (uint8_t*) saiBufInput, saiBufSize);
+	}
+	else {
+		HAL_SAI_Receive_DMA(&hsai_BlockB2, (uint8_t*) saiBufInput, saiBufSize);
+		HAL_SAI_Transmit_DMA(&hsai_BlockA2, (uint8_t*) saiBufOutput, saiBufSize);
+	}
+}
+
+/**
+ * CODEC volume for each input (lower for Line In).
+ */
+static uint8_t inputVolume(uint16_t InputDevice) {
+
+	return InputDevice == INPUT_DEVICE_INPUT_LINE_1 ? 75 : 200;
 }
 
 
@@ -121,17 +308,30 @@ void setInput(uint16_t InputDevice) {
  ----------------------------------------------------------------------------*/
 
 void HAL_SAI_TxCpltCallback(SAI_HandleTypeDef *hsai) {
+
+	// the output DMA has just wrapped around to the beginning of the buffer: restart the input DMA from
+	// the beginning of its own buffer too, i.e. in phase with the output (see setInput()), and a few samples behind it
+	// if both share a single buffer (see startStreams())
+	if (rxRestartPending) {
+		rxRestartPending = 0;
+		saiMonitorReset();
+		HAL_SAI_Receive_DMA(&hsai_BlockB2, (uint8_t*) saiBufInput, saiBufSize);
+	}
+
+	saiMonitorSample();
 }
 
 void HAL_SAI_TxHalfCpltCallback(SAI_HandleTypeDef *hsai) {
+
+	saiMonitorSample();
 }
 
 void HAL_SAI_ErrorCallback(SAI_HandleTypeDef *hsai) {
 
 	if (hsai == &hsai_BlockA2)
-		printf("DMA Out error\n");
+		LOG("DMA Out error\n");
 	else if (hsai == &hsai_BlockB2)
-		printf("DMA In error\n");
+		LOG("DMA In error\n");
 }
 
 // other callbacks are in audio_processing.c TODO : move here
@@ -0,0 +1,26 @@
+/*
+ * dwt.c
+ *
+ *  Created on: Oct 19, 2026
+ */
+
+#include "bsp/dwt.h"
+
+/**
+ * Enables the cycle counter. It keeps running in the background at no cost.
+ */
+void DWT_Init(void) {
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55; // unlock the DWT registers (Cortex-M7 only)
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Converts a number of cycles into microseconds.
+ */
+uint32_t DWT_CyclesToUs(uint32_t cycles) {
+
+	return (uint32_t) ((uint64_t) cycles * 1000000 / SystemCoreClock);
+}
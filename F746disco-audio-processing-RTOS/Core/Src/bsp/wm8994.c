@@ -9,6 +9,7 @@
 #include "bsp/wm8994.h"
 #include "bsp/disco_base.h"
 #include "bsp/disco_i2c.h"
+#include "bsp/disco_sai.h"
 #include "stm32f7xx_hal.h"
 
 /* Uncomment this line to enable verifying data sent to codec after each write
@@ -355,6 +356,18 @@ uint32_t wm8994_Init(uint16_t DeviceAddr, uint16_t OutputInputDevice, uint8_t Vo
     break;
   }
 
+#ifdef AUDIO_SAMPLE_24IN32
+  if(input_device == INPUT_DEVICE_DIGITAL_MIC1_MIC2)
+  {
+  /* AIF1 Word Length = 32-bits, AIF1 Format = DSP mode */
+  counter += CODEC_IO_Write(DeviceAddr, 0x300, 0x4078);
+  }
+  else
+  {
+  /* AIF1 Word Length = 32-bits, AIF1 Format = I2S */
+  counter += CODEC_IO_Write(DeviceAddr, 0x300, 0x4070);
+  }
+#else
   if(input_device == INPUT_DEVICE_DIGITAL_MIC1_MIC2)
   {
   /* AIF1 Word Length = 16-bits, AIF1 Format = DSP mode */
@@ -365,6 +378,7 @@ uint32_t wm8994_Init(uint16_t DeviceAddr, uint16_t OutputInputDevice, uint8_t Vo
   /* AIF1 Word Length = 16-bits, AIF1 Format = I2S (Default Register Value) */
   counter += CODEC_IO_Write(DeviceAddr, 0x300, 0x4010);
   }
+#endif
 
   /* slave mode */
   counter += CODEC_IO_Write(DeviceAddr, 0x302, 0x0000);
@@ -917,6 +931,113 @@ uint32_t wm8994_SetFrequency(uint16_t DeviceAddr, uint32_t AudioFreq)
   return counter;
 }
 
+/**
+  * @brief Switches the input path b/w line in 1 and digital microphone 2 once the codec is running,
+  *        leaving the output path untouched (headphone output, as configured by wm8994_Init()).
+  *        This writes the same input registers as wm8994_Init(), and disables the mixer paths of the other input.
+  * @param DeviceAddr: Device address on communication Bus.
+  * @param InputDevice: INPUT_DEVICE_INPUT_LINE_1 or INPUT_DEVICE_DIGITAL_MICROPHONE_2
+  * @param Volume: same as for wm8994_SetVolume()
+  * @retval 0 if correct communication, else wrong communication
+  */
+uint32_t wm8994_SetInput(uint16_t DeviceAddr, uint16_t InputDevice, uint8_t Volume)
+{
+  uint32_t counter = 0;
+
+  switch (InputDevice)
+  {
+  case INPUT_DEVICE_DIGITAL_MICROPHONE_2 :
+    /* Disable the ADCL/ADCR to AIF1 Timeslot 0 mixer paths and DRC1 */
+    counter += CODEC_IO_Write(DeviceAddr, 0x606, 0x0000);
+    counter += CODEC_IO_Write(DeviceAddr, 0x607, 0x0000);
+    counter += CODEC_IO_Write(DeviceAddr, 0x440, 0x0000);
+
+    /* Enable AIF1ADC2 (Left), Enable AIF1ADC2 (Right)
+     * Enable DMICDAT2 (Left), Enable DMICDAT2 (Right)
+     * Enable Left ADC, Enable Right ADC */
+    counter += CODEC_IO_Write(DeviceAddr, 0x04, 0x0C30);
+
+    /* Enable AIF1 DRC2 Signal Detect & DRC in AIF1ADC2 Left/Right Timeslot 1 */
+    counter += CODEC_IO_Write(DeviceAddr, 0x450, 0x00DB);
+
+    /* Disable IN1L, IN1R, IN2L, IN2R, Enable Thermal sensor & shutdown */
+    counter += CODEC_IO_Write(DeviceAddr, 0x02, 0x6000);
+
+    /* Enable the DMIC2(Left) to AIF1 Timeslot 1 (Left) mixer path */
+    counter += CODEC_IO_Write(DeviceAddr, 0x608, 0x0002);
+
+    /* Enable the DMIC2(Right) to AIF1 Timeslot 1 (Right) mixer path */
+    counter += CODEC_IO_Write(DeviceAddr, 0x609, 0x0002);
+
+    /* GPIO1 pin configuration GP1_DIR = output, GP1_FN = AIF1 DRC2 signal detect */
+    counter += CODEC_IO_Write(DeviceAddr, 0x700, 0x000E);
+
+    /* Enable bias generator, VMID, HPOUT1, SPKOUT, and Microphone bias 1 generator */
+    counter += CODEC_IO_Write(DeviceAddr, 0x01, 0x3303 | 0x0013);
+
+    /* ADC oversample enable */
+    counter += CODEC_IO_Write(DeviceAddr, 0x620, 0x0002);
+
+    /* AIF ADC2 HPF enable, HPF cut = voice mode 1 fc=127Hz at fs=8kHz */
+    counter += CODEC_IO_Write(DeviceAddr, 0x411, 0x3800);
+    break;
+
+  case INPUT_DEVICE_INPUT_LINE_1 :
+    /* Disable the DMIC2 to AIF1 Timeslot 1 mixer paths and DRC2 */
+    counter += CODEC_IO_Write(DeviceAddr, 0x608, 0x0000);
+    counter += CODEC_IO_Write(DeviceAddr, 0x609, 0x0000);
+    counter += CODEC_IO_Write(DeviceAddr, 0x450, 0x0000);
+
+    /* IN1LN_TO_IN1L, IN1LP_TO_VMID, IN1RN_TO_IN1R, IN1RP_TO_VMID */
+    counter += CODEC_IO_Write(DeviceAddr, 0x28, 0x0011);
+
+    /* IN1L/IN1R to MIXINL/MIXINR, without the +30dB (see wm8994_Init()) */
+    counter += CODEC_IO_Write(DeviceAddr, 0x29, 0x0020);
+    counter += CODEC_IO_Write(DeviceAddr, 0x2A, 0x0020);
+
+    /* Enable AIF1ADC1 (Left), Enable AIF1ADC1 (Right)
+     * Enable Left ADC, Enable Right ADC */
+    counter += CODEC_IO_Write(DeviceAddr, 0x04, 0x0303);
+
+    /* Enable AIF1 DRC1 Signal Detect & DRC in AIF1ADC1 Left/Right Timeslot 0 */
+    counter += CODEC_IO_Write(DeviceAddr, 0x440, 0x00DB);
+
+    /* Enable IN1L and IN1R, Disable IN2L and IN2R, Enable Thermal sensor & shutdown */
+    counter += CODEC_IO_Write(DeviceAddr, 0x02, 0x6350);
+
+    /* Enable the ADCL(Left) to AIF1 Timeslot 0 (Left) mixer path */
+    counter += CODEC_IO_Write(DeviceAddr, 0x606, 0x0002);
+
+    /* Enable the ADCR(Right) to AIF1 Timeslot 0 (Right) mixer path */
+    counter += CODEC_IO_Write(DeviceAddr, 0x607, 0x0002);
+
+    /* GPIO1 pin configuration GP1_DIR = output, GP1_FN = AIF1 DRC1 signal detect */
+    counter += CODEC_IO_Write(DeviceAddr, 0x700, 0x000D);
+
+    /* Enable bias generator, VMID, HPOUT1 and SPKOUT, Disable Microphone bias 1 generator */
+    counter += CODEC_IO_Write(DeviceAddr, 0x01, 0x3303);
+
+    /* Disable mute on IN1L and IN1R, Volume = +0dB */
+    counter += CODEC_IO_Write(DeviceAddr, 0x18, 0x000B);
+    counter += CODEC_IO_Write(DeviceAddr, 0x1A, 0x000B);
+
+    /* AIF ADC1 HPF enable, HPF cut = hifi mode fc=4Hz at fs=48kHz */
+    counter += CODEC_IO_Write(DeviceAddr, 0x410, 0x1800);
+    break;
+
+  default:
+    /* Actually, no other input devices supported */
+    return 1;
+  }
+
+  inputEnabled = 1;
+
+  /* Volume Control */
+  counter += wm8994_SetVolume(DeviceAddr, Volume);
+
+  return counter;
+}
+
 /**
   * @brief Resets wm8994 registers.
   * @param DeviceAddr: Device address on communication Bus.
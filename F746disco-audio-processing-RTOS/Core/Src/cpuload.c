@@ -0,0 +1,150 @@
+/*
+ * cpuload.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Per-task CPU load ===
+ *
+ * The FreeRTOS run-time stats (configGENERATE_RUN_TIME_STATS, see FreeRTOSConfig.h) count the time each task runs
+ * in CPU cycles, read from the DWT cycle counter at each context switch (a single load, see bsp/dwt.h).
+ * The counters wrap around after about 20s at 216MHz, hence the monitor task samples them every CPULOAD_PERIOD_MS and
+ * only uses the differences b/w two samples: the load of a task is its share of the cycles elapsed over the last period
+ * (interrupts are charged to the task they interrupted). Along with it, the stack high-water mark of each task is sampled.
+ *
+ * The latest sample is shown on the LCD by the UI task (see uiDisplayCpuLoad()) and printed on the VCP every
+ * CPULOAD_PRINT_EVERY samples. The cost of the accounting itself is the load of the monitor task (well under 1%,
+ * see the "cpuLoad" line) plus one counter read per context switch.
+ */
+
+#include <cpuload.h>
+#include <stdio.h>
+#include "string.h"
+#include "cmsis_os.h"
+
+#define CPULOAD_PERIOD_MS		1000
+#define CPULOAD_PRINT_EVERY		5		// samples
+
+// ----------- Local vars ------------
+
+static TaskStatus_t status[CPULOAD_MAX_TASKS];
+static UBaseType_t prevNumber[CPULOAD_MAX_TASKS];	// task numbers and run-time counters at the previous sample
+static uint32_t prevCounter[CPULOAD_MAX_TASKS];
+static UBaseType_t prevCount = 0;
+
+static cpuload_snapshot_t snapshot;	// written by the monitor task, copied by cpuLoadGet()
+
+static osThreadId cpuLoadTaskHandle;
+
+// ------------ Private Function Prototypes ------------
+
+static void cpuLoadTask(void const *argument);
+static void sample(void);
+static void print(void);
+
+// ----------- Functions ------------
+
+/**
+ * Creates the monitor task. Must be called before the scheduler is started.
+ */
+void cpuLoadInit(void) {
+
+	osThreadDef(cpuLoad, cpuLoadTask, osPriorityBelowNormal, 0, 512);
+	cpuLoadTaskHandle = osThreadCreate(osThread(cpuLoad), NULL);
+}
+
+/**
+ * Copies the latest sample. May be called from any task.
+ */
+void cpuLoadGet(cpuload_snapshot_t *s) {
+
+	taskENTER_CRITICAL();
+	*s = snapshot;
+	taskEXIT_CRITICAL();
+}
+
+static void cpuLoadTask(void const *argument) {
+
+	uint32_t n = 0;
+
+	for (;;) {
+		osDelay(CPULOAD_PERIOD_MS);
+		sample();
+		if (++n % CPULOAD_PRINT_EVERY == 0)
+			print();
+	}
+}
+
+/**
+ * Samples the run-time counters and the stack high-water marks of all tasks, and updates the snapshot.
+ * If there are more tasks than CPULOAD_MAX_TASKS, uxTaskGetSystemState() fills nothing: the previous snapshot is kept.
+ */
+static void sample(void) {
+
+	static uint32_t prevTotal = 0;
+	static uint8_t tooMany = 0;
+	cpuload_snapshot_t s;
+	uint32_t total = 0;
+	UBaseType_t count = uxTaskGetSystemState(status, CPULOAD_MAX_TASKS, &total);
+
+	if (count == 0) {
+		if (!tooMany)
+			printf("cpu: %lu tasks, only %u slots, see CPULOAD_MAX_TASKS\n", (uint32_t) uxTaskGetNumberOfTasks(),
+					CPULOAD_MAX_TASKS);
+		tooMany = 1;
+		return;
+	}
+	tooMany = 0;
+
+	uint32_t elapsed = total - prevTotal;
+
+	// in creation order:
+	for (UBaseType_t i = 1; i < count; i++)
+		for (UBaseType_t j = i; j > 0 && status[j - 1].xTaskNumber > status[j].xTaskNumber; j--) {
+			TaskStatus_t t = status[j];
+			status[j] = status[j - 1];
+			status[j - 1] = t;
+		}
+
+	memset(&s, 0, sizeof(s));
+	s.count = count;
+
+	for (UBaseType_t i = 0; i < count; i++) {
+
+		uint32_t ran = status[i].ulRunTimeCounter;
+		for (UBaseType_t k = 0; k < prevCount; k++)
+			if (prevNumber[k] == status[i].xTaskNumber) {
+				ran -= prevCounter[k];
+				break;
+			}
+		if (ran > elapsed) // task created during the period
+			ran = elapsed;
+
+		strncpy(s.tasks[i].name, status[i].pcTaskName, CPULOAD_NAME_LEN - 1);
+		s.tasks[i].number = (uint16_t) status[i].xTaskNumber;
+		s.tasks[i].permil = elapsed ? (uint16_t) ((uint64_t) ran * 1000 / elapsed) : 0;
+		s.tasks[i].stackFree = (uint16_t) status[i].usStackHighWaterMark;
+
+		prevNumber[i] = status[i].xTaskNumber;
+		prevCounter[i] = status[i].ulRunTimeCounter;
+	}
+	prevCount = count;
+	prevTotal = total;
+
+	taskENTER_CRITICAL();
+	s.seq = snapshot.seq + 1;
+	snapshot = s;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * Prints the latest sample on the VCP. No float support in printf (newlib-nano), hence the loads in tenths of a percent.
+ */
+static void print(void) {
+
+	printf("cpu: %-16s %7s %10s\n", "task", "load", "stack free");
+	for (uint32_t i = 0; i < snapshot.count; i++) {
+		cpuload_task_t *t = &snapshot.tasks[i];
+		printf("cpu: %-16s %3u.%u%% %5u words\n", t->name, t->permil / 10, t->permil % 10, t->stackFree);
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * crc.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Shared CRC unit ===
+ *
+ * The CRC unit, as configured by MX_CRC_Init(), computes CRC-32/MPEG-2 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF,
+ * no reflection, no final XOR). HAL_CRC_Calculate() resets its data register, then feeds it the data: a computation
+ * preempted by another one comes out wrong. Its users hence go through crcCompute(), which serializes them:
+ * - assets.c: entry table at boot, and assetsVerify(), which reads a whole asset from the QSPI flash (milliseconds
+ *   for a large one),
+ * - presets.c: preset records,
+ * - telemetry.c: telemetry frames.
+ *
+ * A mutex rather than a scheduler lock, so that a long asset check only delays the other CRC users, not every task.
+ * Tasks only.
+ */
+
+#include <crc.h>
+#include "main.h"
+#include "cmsis_os.h"
+
+extern CRC_HandleTypeDef hcrc; // see main.c
+
+// ----------- Local vars ------------
+
+static osMutexId crcMutex = NULL;
+
+// ------------ Private Function Prototypes ------------
+
+static void lock(void);
+static void unlock(void);
+
+// ----------- Functions ------------
+
+/**
+ * Creates the mutex. Must be called after MX_CRC_Init() and before the scheduler is started.
+ */
+void crcInit(void) {
+
+	if (crcMutex == NULL) {
+		osMutexDef(crc);
+		crcMutex = osMutexCreate(osMutex(crc));
+	}
+}
+
+/**
+ * CRC of data[0..len).
+ */
+uint32_t crcCompute(const void *data, uint32_t len) {
+
+	lock();
+	uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t*) data, len);
+	unlock();
+	return crc;
+}
+
+/**
+ * CRC of first[0..firstLen) followed by second[0..secondLen), e.g. a header and its payload.
+ */
+uint32_t crcCompute2(const void *first, uint32_t firstLen, const void *second, uint32_t secondLen) {
+
+	lock();
+	HAL_CRC_Calculate(&hcrc, (uint32_t*) first, firstLen);
+	uint32_t crc = HAL_CRC_Accumulate(&hcrc, (uint32_t*) second, secondLen);
+	unlock();
+	return crc;
+}
+
+/**
+ * No-op before the scheduler is started, when nothing runs concurrently.
+ */
+static void lock(void) {
+
+	if (crcMutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+		osMutexWait(crcMutex, osWaitForever);
+}
+
+static void unlock(void) {
+
+	if (crcMutex != NULL && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+		osMutexRelease(crcMutex);
+}
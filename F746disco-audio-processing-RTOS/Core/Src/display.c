@@ -0,0 +1,398 @@
+/*
+ * display.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Display task ===
+ *
+ * The LCD driver (disco_lcd.c) keeps the current font and colors in globals, hence two tasks drawing at the same time
+ * would mix them up. Once the scheduler runs, the display task is the only one to call it: the UI task, diagnostic
+ * code or the audio task post compact draw commands instead (rectangle, text, pixel column, meter bar, image), which never
+ * block:
+ *
+ * - a slot of a ring of DISPLAY_QUEUE_LEN commands in SDRAM (see DISPLAY_BUF_ADDR in disco_base.h) is claimed by
+ *   incrementing the write index with LDREX/STREX, filled in, then published by writing its sequence number last,
+ *   as for the logger (see logger.c). If the ring is full, the command is dropped and counted.
+ * - the display task takes all the commands published since the last frame, draws them in order, frees their slots,
+ *   and shows the frame with LCD_SwapBuffers(), which waits for the vertical blanking: commands pile up meanwhile,
+ *   so there is one batch per panel refresh (about 60Hz) at most.
+ * - within a batch, a command is skipped if a later command of the same kind covers it entirely (same rectangle,
+ *   meter or column, or an opaque text at least as long at the same place): e.g. the input levels, posted at every
+ *   audio block, are drawn once per frame.
+ *
+ * displayGetStats() returns the queue depth and the render time of the frames, the latter from the first command to
+ * the end of the last DMA2D transfer.
+ */
+
+#include <display.h>
+#include <assets.h>
+#include "string.h"
+#include "cmsis_os.h"
+#include "bsp/disco_base.h"
+#include "bsp/disco_dma2d.h"
+#include "bsp/dwt.h"
+
+#define DISPLAY_QUEUE_LEN	64		// must be a power of two
+#define DISPLAY_SIG_CMD		0x0001	// commands were published
+
+typedef enum {
+	CMD_RECT = 1, CMD_TEXT, CMD_COLUMN, CMD_METER, CMD_IMAGE
+} display_cmd_type_t;
+
+typedef struct {
+	volatile uint32_t seq;	// index + 1 once the command is complete
+	uint8_t type;
+	uint8_t flags;
+	uint16_t value;			// meter: filled length, in pixels
+	uint16_t x, y, w, h;	// text: w is the length
+	uint32_t color;
+	uint32_t backColor;
+	sFONT *font;
+	union {
+		char text[DISPLAY_TEXT_LEN + 1];
+		uint16_t pixels[DISPLAY_COLUMN_MAX];
+		LCD_ImageTypeDef image;	// the pixels themselves are not copied
+	};
+} display_cmd_t;
+
+_Static_assert(DISPLAY_QUEUE_LEN * sizeof(display_cmd_t) <= DISPLAY_BUF_SIZE_BYTES, "display commands don't fit in DISPLAY_BUF_SIZE_BYTES");
+
+// ----------- Local vars ------------
+
+static display_cmd_t *const cmds = (display_cmd_t*) DISPLAY_BUF_ADDR;
+static volatile uint32_t cmdWr = 0;		// commands claimed so far
+static volatile uint32_t cmdRd = 0;		// commands drawn so far (display task only)
+static display_stats_t stats;
+
+static osThreadId displayTaskHandle = NULL;
+
+// ------------ Private Function Prototypes ------------
+
+static void displayTask(void const *argument);
+static display_cmd_t* claim(uint8_t type, uint32_t *index);
+static void publish(display_cmd_t *c, uint32_t index);
+static uint8_t isCovered(const display_cmd_t *c, uint32_t from, uint32_t end);
+static uint8_t readsFlash(uint32_t from, uint32_t end);
+static void render(const display_cmd_t *c);
+
+// ----------- Functions ------------
+
+/**
+ * Clears the ring and creates the display task. Must be called before the scheduler is started, after LCD_Init().
+ */
+void displayInit(void) {
+
+	memset(cmds, 0, DISPLAY_QUEUE_LEN * sizeof(display_cmd_t));
+	memset(&stats, 0, sizeof(stats));
+
+	osThreadDef(display, displayTask, osPriorityLow, 0, 384);
+	displayTaskHandle = osThreadCreate(osThread(display), NULL);
+}
+
+/**
+ * Filled rectangle, or its outline with DISPLAY_OUTLINE (as LCD_DrawRect(), i.e. w + 1 by h + 1 pixels).
+ */
+uint8_t displayRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t color, uint8_t flags) {
+
+	uint32_t i;
+	display_cmd_t *c = claim(CMD_RECT, &i);
+
+	if (c == NULL)
+		return DISPLAY_FULL;
+	c->flags = flags;
+	c->x = x;
+	c->y = y;
+	c->w = w;
+	c->h = h;
+	c->color = color;
+	publish(c, i);
+	return DISPLAY_OK;
+}
+
+/**
+ * Text in "font", truncated to DISPLAY_TEXT_LEN characters. Flags: DISPLAY_OPAQUE, DISPLAY_CENTER.
+ */
+uint8_t displayText(uint16_t x, uint16_t y, const char *text, sFONT *font, uint32_t color, uint32_t backColor, uint8_t flags) {
+
+	uint32_t i;
+	size_t len = strlen(text);
+	display_cmd_t *c = claim(CMD_TEXT, &i);
+
+	if (c == NULL)
+		return DISPLAY_FULL;
+	if (len > DISPLAY_TEXT_LEN)
+		len = DISPLAY_TEXT_LEN;
+	memcpy(c->text, text, len);
+	c->text[len] = 0;
+	c->flags = flags;
+	c->x = x;
+	c->y = y;
+	c->w = len;
+	c->font = font;
+	c->color = color;
+	c->backColor = backColor;
+	publish(c, i);
+	return DISPLAY_OK;
+}
+
+/**
+ * Column of "h" RGB565 pixels (copied, at most DISPLAY_COLUMN_MAX), from (x, y) downwards.
+ */
+uint8_t displayColumn(uint16_t x, uint16_t y, const uint16_t *pixels, uint16_t h) {
+
+	uint32_t i;
+	display_cmd_t *c = claim(CMD_COLUMN, &i);
+
+	if (c == NULL)
+		return DISPLAY_FULL;
+	if (h > DISPLAY_COLUMN_MAX)
+		h = DISPLAY_COLUMN_MAX;
+	memcpy(c->pixels, pixels, h * sizeof(uint16_t));
+	c->flags = 0;
+	c->x = x;
+	c->y = y;
+	c->h = h;
+	publish(c, i);
+	return DISPLAY_OK;
+}
+
+/**
+ * Horizontal bar of w x h pixels: the first "value" pixels in "color", the rest in "backColor".
+ */
+uint8_t displayMeter(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t value, uint32_t color, uint32_t backColor) {
+
+	uint32_t i;
+	display_cmd_t *c = claim(CMD_METER, &i);
+
+	if (c == NULL)
+		return DISPLAY_FULL;
+	c->flags = 0;
+	c->x = x;
+	c->y = y;
+	c->w = w;
+	c->h = h;
+	c->value = value < w ? value : w;
+	c->color = color;
+	c->backColor = backColor;
+	publish(c, i);
+	return DISPLAY_OK;
+}
+
+/**
+ * Image, see LCD_DrawImage(). Flags: DISPLAY_BLEND.
+ * The descriptor is copied, but not the pixels: they must stay valid until the next frame is shown, which is the case
+ * of the images read in place from the QSPI flash (see assetsGetImage()).
+ */
+uint8_t displayImage(uint16_t x, uint16_t y, const LCD_ImageTypeDef *image, uint8_t flags) {
+
+	uint32_t i;
+	display_cmd_t *c = claim(CMD_IMAGE, &i);
+
+	if (c == NULL)
+		return DISPLAY_FULL;
+	c->image = *image;
+	c->flags = flags;
+	c->x = x;
+	c->y = y;
+	c->w = image->width;
+	c->h = image->height;
+	publish(c, i);
+	return DISPLAY_OK;
+}
+
+/**
+ * Blocks until all the commands posted so far are drawn, and hence no longer read their pixels (see displayImage()).
+ * Tasks only, returns at once if the display task doesn't run.
+ */
+void displayFlush(void) {
+
+	uint32_t end = cmdWr;
+
+	if (displayTaskHandle == NULL || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+		return;
+	while ((int32_t) (cmdRd - end) < 0)
+		osDelay(2);
+}
+
+void displayGetStats(display_stats_t *s) {
+
+	*s = stats;
+	s->depth = cmdWr - cmdRd;
+}
+
+static void displayTask(void const *argument) {
+
+	for (;;) {
+
+		uint32_t end = cmdRd;
+		uint32_t depth = cmdWr - cmdRd;
+
+		// published commands, oldest first:
+		while (end != cmdWr && cmds[end & (DISPLAY_QUEUE_LEN - 1)].seq == end + 1)
+			end++;
+
+		if (end == cmdRd) {
+			osSignalWait(DISPLAY_SIG_CMD, osWaitForever);
+			continue;
+		}
+
+		if (depth > stats.maxDepth)
+			stats.maxDepth = depth;
+
+		uint32_t start = DWT_CYCLES();
+
+		// images read in place from the QSPI flash: keep it mapped until the DMA2D is done (see assetsLock())
+		uint8_t flash = readsFlash(cmdRd, end);
+		if (flash)
+			assetsLock();
+
+		for (uint32_t i = cmdRd; i != end; i++) {
+			const display_cmd_t *c = &cmds[i & (DISPLAY_QUEUE_LEN - 1)];
+			if (isCovered(c, i + 1, end))
+				stats.coalesced++;
+			else
+				render(c);
+		}
+		DISCO_DMA2D_WaitIdle(); // the columns are read from the slots
+
+		if (flash)
+			assetsUnlock();
+
+		stats.commands += end - cmdRd;
+		__DMB();
+		cmdRd = end; // frees the slots
+
+		stats.renderUs = DWT_CyclesToUs(DWT_CYCLES() - start);
+		if (stats.renderUs > stats.maxRenderUs)
+			stats.maxRenderUs = stats.renderUs;
+		stats.frames++;
+
+		LCD_SwapBuffers(); // waits for the vertical blanking
+	}
+}
+
+/**
+ * Claims a slot, or returns NULL (and counts a drop) if the ring is full. May be called from any task or interrupt.
+ */
+static display_cmd_t* claim(uint8_t type, uint32_t *index) {
+
+	uint32_t i;
+
+	do {
+		i = __LDREXW(&cmdWr);
+		if (i - cmdRd >= DISPLAY_QUEUE_LEN) {
+			__CLREX();
+			stats.dropped++;
+			return NULL;
+		}
+	} while (__STREXW(i + 1, &cmdWr));
+
+	display_cmd_t *c = &cmds[i & (DISPLAY_QUEUE_LEN - 1)];
+	c->type = type;
+	*index = i;
+	return c;
+}
+
+static void publish(display_cmd_t *c, uint32_t index) {
+
+	__DMB();
+	c->seq = index + 1;
+	if (displayTaskHandle != NULL)
+		osSignalSet(displayTaskHandle, DISPLAY_SIG_CMD);
+}
+
+/**
+ * Returns 1 if one of the commands [from, end) draws over all the pixels of "c".
+ */
+static uint8_t isCovered(const display_cmd_t *c, uint32_t from, uint32_t end) {
+
+	for (uint32_t i = from; i != end; i++) {
+
+		const display_cmd_t *d = &cmds[i & (DISPLAY_QUEUE_LEN - 1)];
+
+		if (d->type != c->type || d->x != c->x || d->y != c->y || d->flags != c->flags)
+			continue;
+
+		switch (c->type) {
+		case CMD_RECT:
+		case CMD_METER:
+		case CMD_IMAGE:
+			// a blended image doesn't hide what is below
+			if (d->w == c->w && d->h == c->h && !(d->flags & DISPLAY_BLEND))
+				return 1;
+			break;
+		case CMD_COLUMN:
+			if (d->h >= c->h)
+				return 1;
+			break;
+		case CMD_TEXT:
+			// a transparent text doesn't hide what is below, and a centered one moves with its length
+			if ((c->flags & DISPLAY_OPAQUE) && d->font == c->font
+					&& ((c->flags & DISPLAY_CENTER) ? d->w == c->w : d->w >= c->w))
+				return 1;
+			break;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Returns 1 if one of the commands [from, end) draws an image (or its palette) from the memory-mapped QSPI flash.
+ */
+static uint8_t readsFlash(uint32_t from, uint32_t end) {
+
+	for (uint32_t i = from; i != end; i++) {
+
+		const display_cmd_t *c = &cmds[i & (DISPLAY_QUEUE_LEN - 1)];
+
+		if (c->type == CMD_IMAGE && ((uint32_t) c->image.pixels - QSPI_DEVICE_ADDR < QSPI_DEVICE_SIZE
+				|| (c->image.clut != NULL && (uint32_t) c->image.clut - QSPI_DEVICE_ADDR < QSPI_DEVICE_SIZE)))
+			return 1;
+	}
+	return 0;
+}
+
+static void render(const display_cmd_t *c) {
+
+	switch (c->type) {
+
+	case CMD_RECT:
+		if (c->flags & DISPLAY_OUTLINE) {
+			LCD_SetStrokeColor(c->color);
+			LCD_DrawRect(c->x, c->y, c->w, c->h);
+		}
+		else {
+			LCD_SetFillColor(c->color);
+			LCD_FillRect(c->x, c->y, c->w, c->h);
+		}
+		break;
+
+	case CMD_TEXT:
+		LCD_SetFont(c->font);
+		LCD_SetStrokeColor(c->color);
+		LCD_SetBackColor(c->backColor);
+		LCD_DrawString(c->x, c->y, (uint8_t*) c->text, (c->flags & DISPLAY_CENTER) ? CENTER_MODE : LEFT_MODE,
+				(c->flags & DISPLAY_OPAQUE) ? true : false);
+		break;
+
+	case CMD_COLUMN:
+		LCD_DrawColumn(c->x, c->y, c->pixels, c->h, false); // the slot is only freed after DISCO_DMA2D_WaitIdle()
+		break;
+
+	case CMD_METER:
+		if (c->value > 0) {
+			LCD_SetFillColor(c->color);
+			LCD_FillRect(c->x, c->y, c->value, c->h);
+		}
+		if (c->value < c->w) {
+			LCD_SetFillColor(c->backColor);
+			LCD_FillRect(c->x + c->value, c->y, c->w - c->value, c->h);
+		}
+		break;
+
+	case CMD_IMAGE:
+		LCD_DrawImage(c->x, c->y, &c->image, (c->flags & DISPLAY_BLEND) ? true : false);
+		break;
+	}
+}
@@ -0,0 +1,249 @@
+/*
+ * images.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Image loader and decoded image cache ===
+ *
+ * UI backgrounds and skins are JPEG images, identified by their asset name, and looked up:
+ * - first in the QSPI asset store, as ASSET_JPEG entries (see tools/assetpack.c, jpeg:NAME=file.jpg), decoded in place,
+ * - then on the SD card, as skins/NAME.jpg.
+ *
+ * Decoding (see jpegdec.c) takes tens of milliseconds, hence it is done once, by a low-priority task (imagesTask), into
+ * a cache of IMAGES_SLOTS decoded RGB565 images in SDRAM (see IMAGE_CACHE_ADDR in disco_base.h), one full screen each:
+ *
+ * 		if (imagesGet("background", &image) == IMAGES_OK)
+ * 			displayImage(0, 0, &image, 0);		// a single DMA2D copy, see LCD_DrawImage()
+ *
+ * imagesGet() never blocks: if the image isn't decoded yet, it is queued (IMAGES_PENDING), and the caller tries again
+ * later, e.g. at the next frame. imagesRequest() queues images ahead of time, so that switching screens is instant.
+ * When all the slots are taken, the least recently used decoded image is evicted. Since display commands only carry
+ * a pointer to the pixels, the loader waits for the commands posted so far to be drawn (displayFlush()) before
+ * decoding over an evicted image.
+ *
+ * Images that can't be found or decoded stay in the cache as failed (IMAGES_ERROR), so that they aren't tried again
+ * at each frame, until they are evicted.
+ */
+
+#include <images.h>
+#include <assets.h>
+#include <display.h>
+#include <jpegdec.h>
+#include <stdio.h>
+#include "string.h"
+#include "cmsis_os.h"
+#include "fatfs.h"
+#include "bsp/disco_base.h"
+
+#define IMAGES_SLOT_BYTES	(IMAGES_MAX_WIDTH * IMAGES_MAX_HEIGHT * sizeof(uint16_t))
+#define IMAGES_SLOTS		(IMAGE_CACHE_SIZE_BYTES / IMAGES_SLOT_BYTES)
+#define IMAGES_PATH			"skins/%s.jpg"
+
+typedef enum {
+	SLOT_EMPTY = 0, SLOT_QUEUED, SLOT_READY, SLOT_FAILED
+} slot_state_t;
+
+typedef struct {
+	char name[ASSETS_NAME_LEN];
+	volatile uint8_t state;		// slot_state_t
+	uint32_t lastUse;
+	LCD_ImageTypeDef image;		// SLOT_READY only
+} image_slot_t;
+
+// ----------- Local vars ------------
+
+static image_slot_t slots[IMAGES_SLOTS];
+static uint32_t useCount = 0;
+static images_stats_t stats;
+static FIL imageFile; // too large for the task stack
+
+static osThreadId imagesTaskHandle = NULL;
+static osMessageQId imagesQueueHandle = NULL; // indexes of the slots to load
+
+// ------------ Private Function Prototypes ------------
+
+static void imagesTask(void const *argument);
+static image_slot_t* find(const char *name);
+static image_slot_t* victim(void);
+static uint8_t load(const char *name, uint16_t *pixels, jpegdec_info_t *info);
+
+// ----------- Functions ------------
+
+/**
+ * Empties the cache and creates the loader task. Must be called before the scheduler is started.
+ */
+void imagesInit(void) {
+
+	memset(slots, 0, sizeof(slots));
+	memset(&stats, 0, sizeof(stats));
+	jpegdecInit((void*) JPEG_HEAP_ADDR, JPEG_HEAP_SIZE_BYTES);
+
+	osMessageQDef(images, IMAGES_SLOTS, uint32_t);
+	imagesQueueHandle = osMessageCreate(osMessageQ(images), NULL);
+
+	osThreadDef(images, imagesTask, osPriorityIdle, 0, 768);
+	imagesTaskHandle = osThreadCreate(osThread(images), NULL);
+}
+
+/**
+ * Looks the image up in the cache. If it is decoded, fills "image" (if not NULL) and returns IMAGES_OK.
+ * Else queues it, if not done yet, and returns IMAGES_PENDING. Never blocks. Tasks only.
+ * The pixels stay valid until the image is evicted, i.e. until IMAGES_SLOTS other images have been used since.
+ */
+uint8_t imagesGet(const char *name, LCD_ImageTypeDef *image) {
+
+	uint8_t ret;
+	uint32_t queue = IMAGES_SLOTS; // slot to queue, none by default
+
+	taskENTER_CRITICAL();
+
+	image_slot_t *s = find(name);
+
+	if (s != NULL) {
+		s->lastUse = ++useCount;
+		if (s->state == SLOT_READY) {
+			if (image != NULL)
+				*image = s->image;
+			stats.hits++;
+			ret = IMAGES_OK;
+		}
+		else
+			ret = s->state == SLOT_FAILED ? IMAGES_ERROR : IMAGES_PENDING;
+	}
+	else if ((s = victim()) != NULL) {
+		if (s->state == SLOT_READY)
+			stats.evictions++;
+		strncpy(s->name, name, ASSETS_NAME_LEN - 1);
+		s->name[ASSETS_NAME_LEN - 1] = 0;
+		s->state = SLOT_QUEUED;
+		s->lastUse = ++useCount;
+		stats.misses++;
+		queue = s - slots;
+		ret = IMAGES_PENDING;
+	}
+	else
+		ret = IMAGES_FULL;
+
+	taskEXIT_CRITICAL();
+
+	// can't fail: there are as many queue entries as slots, and a slot is queued once
+	if (queue < IMAGES_SLOTS)
+		osMessagePut(imagesQueueHandle, queue, 0);
+
+	return ret;
+}
+
+/**
+ * Queues the image if it isn't in the cache, e.g. the screens the user may switch to next.
+ */
+uint8_t imagesRequest(const char *name) {
+
+	return imagesGet(name, NULL);
+}
+
+void imagesGetStats(images_stats_t *s) {
+
+	*s = stats;
+}
+
+static void imagesTask(void const *argument) {
+
+	for (;;) {
+
+		osEvent event = osMessageGet(imagesQueueHandle, osWaitForever);
+		if (event.status != osEventMessage || event.value.v >= IMAGES_SLOTS)
+			continue;
+
+		uint32_t i = event.value.v;
+		image_slot_t *s = &slots[i];
+		uint16_t *pixels = (uint16_t*) (IMAGE_CACHE_ADDR + i * IMAGES_SLOT_BYTES);
+		jpegdec_info_t info;
+
+		displayFlush(); // the evicted image may still be drawn from
+
+		uint32_t start = HAL_GetTick();
+		uint8_t ret = load(s->name, pixels, &info);
+		stats.lastDecodeMs = HAL_GetTick() - start;
+
+		if (ret == JPEGDEC_OK) {
+			s->image.pixels = pixels;
+			s->image.clut = NULL;
+			s->image.width = info.outWidth;
+			s->image.height = info.outHeight;
+			s->image.colorMode = CM_RGB565;
+			s->image.clutSize = 0;
+			stats.decodes++;
+			if (stats.lastDecodeMs > stats.maxDecodeMs)
+				stats.maxDecodeMs = stats.lastDecodeMs;
+			if (info.heapPeak > stats.heapPeak)
+				stats.heapPeak = info.heapPeak;
+			printf("images: %s, %lux%lu decoded to %lux%lu in %lu ms, %lu bytes of decoder heap\n", s->name, info.width,
+					info.height, info.outWidth, info.outHeight, stats.lastDecodeMs, info.heapPeak);
+		}
+		else {
+			stats.failures++;
+			printf("images: cannot load %s\n", s->name);
+		}
+
+		__DMB(); // the descriptor is complete before it is handed out
+		s->state = ret == JPEGDEC_OK ? SLOT_READY : SLOT_FAILED;
+	}
+}
+
+/**
+ * Decodes the image from the QSPI asset store, or else from the SD card.
+ */
+static uint8_t load(const char *name, uint16_t *pixels, jpegdec_info_t *info) {
+
+	char path[ASSETS_NAME_LEN + 16];
+	uint8_t ret;
+
+	memset(info, 0, sizeof(*info));
+
+	// the QSPI flash stays mapped while it is decoded from, see assetsLock()
+	assetsLock();
+	const asset_entry_t *e = assetsFind(name, ASSET_JPEG);
+	if (e != NULL) {
+		ret = jpegdecDecodeMem((const uint8_t*) assetsData(e), e->size, pixels, IMAGES_MAX_WIDTH, IMAGES_MAX_HEIGHT, info);
+		assetsUnlock();
+		return ret;
+	}
+	assetsUnlock();
+
+	snprintf(path, sizeof(path), IMAGES_PATH, name);
+	if (FATFS_MountSD() != FR_OK || f_open(&imageFile, path, FA_READ) != FR_OK)
+		return JPEGDEC_ERROR;
+	ret = jpegdecDecodeFile(&imageFile, pixels, IMAGES_MAX_WIDTH, IMAGES_MAX_HEIGHT, info);
+	f_close(&imageFile);
+	return ret;
+}
+
+/**
+ * Slot of the image "name", or NULL. Called in a critical section.
+ */
+static image_slot_t* find(const char *name) {
+
+	for (uint32_t i = 0; i < IMAGES_SLOTS; i++)
+		if (slots[i].state != SLOT_EMPTY && strncmp(slots[i].name, name, ASSETS_NAME_LEN - 1) == 0)
+			return &slots[i];
+	return NULL;
+}
+
+/**
+ * Least recently used slot that isn't being loaded (empty slots first), or NULL. Called in a critical section.
+ */
+static image_slot_t* victim(void) {
+
+	image_slot_t *v = NULL;
+
+	for (uint32_t i = 0; i < IMAGES_SLOTS; i++) {
+		if (slots[i].state == SLOT_QUEUED)
+			continue;
+		if (slots[i].state == SLOT_EMPTY)
+			return &slots[i];
+		if (v == NULL || (int32_t) (slots[i].lastUse - v->lastUse) < 0)
+			v = &slots[i];
+	}
+	return v;
+}
@@ -0,0 +1,207 @@
+/*
+ * jpegdec.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === JPEG decoder ===
+ *
+ * Decodes a JPEG image, from memory (e.g. the memory-mapped QSPI flash) or from a file, into RGB565 pixels for the LCD,
+ * through the LIBJPEG middleware:
+ *
+ * - the image is scaled down by n/8 (n = 8..1, the IDCT does the scaling at no extra cost) to fit into
+ *   maxWidth x maxHeight, and if it is still too large at 1/8, the center of it is kept (cropped).
+ * - the integer fast IDCT is used, and the chroma is upsampled without interpolation (no "fancy upsampling"):
+ *   both are faster and need less memory, at a quality loss invisible on the LCD.
+ *
+ * libjpeg allocates its working memory through JMALLOC (see jdata_conf.h), which jpegdecAlloc() serves from the
+ * heap given to jpegdecInit(): a bump allocator, emptied at each decode, since libjpeg frees everything at the end of
+ * the image anyway. Hence decoding never touches the FreeRTOS heap, and the peak is known exactly (heapPeak).
+ * A baseline image of the size of the screen needs a few tens of kbytes; a progressive one keeps all of its DCT
+ * coefficients, i.e. 2 bytes per pixel and component, and usually doesn't fit: it then fails cleanly (JPEGDEC_ERROR).
+ *
+ * Not reentrant: one decode at a time (the image loader task, see images.c).
+ */
+
+#include <jpegdec.h>
+#include <setjmp.h>
+#include "string.h"
+
+#define HEAP_ALIGN		8
+
+typedef struct {
+	struct jpeg_error_mgr pub;
+	jmp_buf jump;
+} error_mgr_t;
+
+// ----------- Local vars ------------
+
+static uint8_t *heapBase = NULL;
+static uint32_t heapSize = 0;
+static uint32_t heapUsed = 0;
+static uint32_t heapPeak = 0;
+static uint32_t heapFailures = 0;
+
+// ------------ Private Function Prototypes ------------
+
+static void errorExit(j_common_ptr cinfo);
+static void outputMessage(j_common_ptr cinfo);
+static uint8_t decode(struct jpeg_decompress_struct *cinfo, uint16_t *pixels, uint32_t maxWidth, uint32_t maxHeight, jpegdec_info_t *info);
+
+// ----------- Functions ------------
+
+/**
+ * Hands the memory [heap, heap + size) over to the decoder.
+ */
+void jpegdecInit(void *heap, uint32_t size) {
+
+	heapBase = (uint8_t*) heap;
+	heapSize = heap ? size : 0;
+	heapUsed = 0;
+}
+
+/**
+ * JMALLOC of libjpeg, see jdata_conf.h.
+ */
+void* jpegdecAlloc(size_t size) {
+
+	uint32_t start = (heapUsed + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+
+	if (start + size > heapSize || start + size < start) {
+		heapFailures++;
+		return NULL;
+	}
+	heapUsed = start + size;
+	if (heapUsed > heapPeak)
+		heapPeak = heapUsed;
+	return heapBase + start;
+}
+
+/**
+ * JFREE of libjpeg: nothing to do, the heap is emptied at the next decode.
+ */
+void jpegdecFree(void *ptr) {
+
+	(void) ptr;
+}
+
+/**
+ * Decodes the JPEG image data[0..size) into "pixels" (maxWidth x maxHeight RGB565 pixels at most, see above).
+ * The decoded image is info->outWidth x info->outHeight pixels, first line first, without padding.
+ */
+uint8_t jpegdecDecodeMem(const uint8_t *data, uint32_t size, uint16_t *pixels, uint32_t maxWidth, uint32_t maxHeight, jpegdec_info_t *info) {
+
+	struct jpeg_decompress_struct cinfo;
+	error_mgr_t err;
+
+	cinfo.err = jpeg_std_error(&err.pub);
+	err.pub.error_exit = errorExit;
+	err.pub.output_message = outputMessage;
+	if (setjmp(err.jump)) {
+		jpeg_destroy_decompress(&cinfo);
+		info->heapPeak = heapPeak;
+		info->heapFailures = heapFailures;
+		return JPEGDEC_ERROR;
+	}
+	heapUsed = heapPeak = heapFailures = 0;
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, (unsigned char*) data, size);
+	return decode(&cinfo, pixels, maxWidth, maxHeight, info);
+}
+
+/**
+ * Same as jpegdecDecodeMem(), from an open file (a FatFS FIL on the target, see JFILE in jdata_conf.h).
+ */
+uint8_t jpegdecDecodeFile(JFILE *file, uint16_t *pixels, uint32_t maxWidth, uint32_t maxHeight, jpegdec_info_t *info) {
+
+	struct jpeg_decompress_struct cinfo;
+	error_mgr_t err;
+
+	cinfo.err = jpeg_std_error(&err.pub);
+	err.pub.error_exit = errorExit;
+	err.pub.output_message = outputMessage;
+	if (setjmp(err.jump)) {
+		jpeg_destroy_decompress(&cinfo);
+		info->heapPeak = heapPeak;
+		info->heapFailures = heapFailures;
+		return JPEGDEC_ERROR;
+	}
+	heapUsed = heapPeak = heapFailures = 0;
+	jpeg_create_decompress(&cinfo);
+	jpeg_stdio_src(&cinfo, file);
+	return decode(&cinfo, pixels, maxWidth, maxHeight, info);
+}
+
+/**
+ * Common part, once the source is set. Errors longjmp() back to the caller.
+ */
+static uint8_t decode(struct jpeg_decompress_struct *cinfo, uint16_t *pixels, uint32_t maxWidth, uint32_t maxHeight, jpegdec_info_t *info) {
+
+	uint32_t n, cropX, cropY;
+	JSAMPARRAY row;
+
+	jpeg_read_header(cinfo, TRUE);
+
+	// largest n/8 that fits, 1/8 at least
+	for (n = 8; n > 1; n--)
+		if ((cinfo->image_width * n + 7) / 8 <= maxWidth && (cinfo->image_height * n + 7) / 8 <= maxHeight)
+			break;
+	cinfo->scale_num = n;
+	cinfo->scale_denom = 8;
+	cinfo->out_color_space = JCS_RGB;
+	cinfo->dct_method = JDCT_IFAST;
+	cinfo->do_fancy_upsampling = FALSE;
+	cinfo->dither_mode = JDITHER_NONE;
+
+	jpeg_start_decompress(cinfo);
+
+	// center of the image if it is still too large
+	info->width = cinfo->image_width;
+	info->height = cinfo->image_height;
+	info->scaleNum = n;
+	info->outWidth = cinfo->output_width < maxWidth ? cinfo->output_width : maxWidth;
+	info->outHeight = cinfo->output_height < maxHeight ? cinfo->output_height : maxHeight;
+	cropX = (cinfo->output_width - info->outWidth) / 2;
+	cropY = (cinfo->output_height - info->outHeight) / 2;
+
+	row = (*cinfo->mem->alloc_sarray)((j_common_ptr) cinfo, JPOOL_IMAGE, cinfo->output_width * cinfo->output_components, 1);
+
+	while (cinfo->output_scanline < cinfo->output_height) {
+
+		uint32_t y = cinfo->output_scanline;
+		jpeg_read_scanlines(cinfo, row, 1);
+		if (y < cropY || y >= cropY + info->outHeight)
+			continue;
+
+		const JSAMPLE *s = row[0] + cropX * 3;
+		uint16_t *d = pixels + (y - cropY) * info->outWidth;
+		for (uint32_t x = 0; x < info->outWidth; x++, s += 3)
+			*d++ = ((s[0] & 0xF8) << 8) | ((s[1] & 0xFC) << 3) | (s[2] >> 3);
+	}
+
+	jpeg_finish_decompress(cinfo);
+	jpeg_destroy_decompress(cinfo);
+
+	info->heapPeak = heapPeak;
+	info->heapFailures = heapFailures;
+	return JPEGDEC_OK;
+}
+
+/**
+ * Replaces libjpeg's default, which exits the program.
+ */
+static void errorExit(j_common_ptr cinfo) {
+
+	error_mgr_t *err = (error_mgr_t*) cinfo->err;
+
+	(*cinfo->err->output_message)(cinfo);
+	longjmp(err->jump, 1);
+}
+
+static void outputMessage(j_common_ptr cinfo) {
+
+	char buf[JMSG_LENGTH_MAX];
+
+	(*cinfo->err->format_message)(cinfo, buf);
+	printf("jpeg: %s\n", buf);
+}
@@ -0,0 +1,221 @@
+/*
+ * latency.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Round-trip latency measurement ===
+ *
+ * Requires a loopback cable from the headphone output to the line input (left channel at least).
+ *
+ * The audio task replaces its output with a maximum length sequence (MLS, 1023 samples of +/-LATENCY_LEVEL, same on
+ * both channels) followed by silence, and captures the left input channel from the very same frame on
+ * (see latencyProcessFrame()). Once LATENCY_CAPTURE_LEN frames have been captured, the control task cross-correlates
+ * the capture with the MLS: the lag of the correlation peak is the number of frames between the time the first
+ * MLS sample was written into the output stream and the time it came back through the input stream, i.e.
+ *
+ * 		ADC -> input DMA buffer -> processing -> output DMA buffer -> DAC (-> cable)
+ *
+ * The buffering alone accounts for two blocks (one half-buffer in, one half-buffer out, i.e. AUDIO_BUF_SIZE frames), the remainder
+ * is the group delay of the CODEC filters. The autocorrelation of an MLS is a single peak, hence the detection is
+ * robust to noise and to the level of the loopback, and a parabolic fit around the peak gives sub-sample accuracy.
+ *
+ * The block size is a build-time constant (AUDIO_BUF_SIZE), so latencyMeasureAll() measures it at every supported
+ * sampling rate and reports the block size along with the results. Results are printed on the VCP and shown on the LCD.
+ */
+
+#include <latency.h>
+#include <audio.h>
+#include <ui.h>
+#include <stdio.h>
+#include "string.h"
+#include <math.h>
+#include "bsp/disco_base.h"
+#include "cmsis_os.h"
+#include "arm_math.h"
+
+#define LATENCY_MLS_LEN		1023	// 2^10 - 1
+#define LATENCY_CAPTURE_LEN	(LATENCY_BUF_SIZE_BYTES / sizeof(float) - (LATENCY_MLS_LEN + 1)) // frames
+#define LATENCY_LEVEL		0.25f	// MLS amplitude, relative to full scale
+#define LATENCY_MIN_RATIO	8.0f	// minimum peak/RMS ratio of the correlation for a valid detection
+#define LATENCY_TIMEOUT_MS	2000
+#define LATENCY_SETTLE_MS	300		// after a rate or input change, lets the fade-in complete and the CODEC settle
+
+typedef enum {
+	LATENCY_IDLE = 0, LATENCY_RUNNING, LATENCY_DONE
+} latency_state_t;
+
+// ----------- Local vars ------------
+
+// both in SDRAM, see LATENCY_BUF_ADDR in disco_base.h:
+static float *const mls = (float*) LATENCY_BUF_ADDR;
+static float *const capture = (float*) LATENCY_BUF_ADDR + (LATENCY_MLS_LEN + 1);
+
+static volatile latency_state_t state = LATENCY_IDLE;
+static uint32_t capturePos;	// only used by the audio task while RUNNING
+static uint32_t blockSamples;	// interleaved samples per frame processed by the audio task
+
+// ------------ Private Function Prototypes ------------
+
+static void generateMLS(void);
+static float correlate(uint32_t lag);
+
+// ----------- Functions ------------
+
+/**
+ * Audio task side: while a measurement is running, captures the left channel of the CODEC input frame "in" and fills
+ * the output frame "out" with the MLS (then silence), and returns 1: the effect chain must then be skipped.
+ * Returns 0 otherwise. "sampleCount" is the number of interleaved L/R samples in both frames, which may be the same one.
+ */
+uint8_t latencyProcessFrame(const audio_sample_t *in, audio_sample_t *out, uint32_t sampleCount) {
+
+	if (state != LATENCY_RUNNING)
+		return 0;
+
+	blockSamples = sampleCount;
+
+	for (uint32_t i = 0; i < sampleCount; i += 2) {
+
+		float s = capturePos < LATENCY_MLS_LEN ? mls[capturePos] * LATENCY_LEVEL : 0.0f;
+
+		if (capturePos < LATENCY_CAPTURE_LEN)
+			capture[capturePos++] = (float) in[i] / (float) AUDIO_SAMPLE_FULL_SCALE;
+
+		out[i] = out[i + 1] = (audio_sample_t) (s * (float) AUDIO_SAMPLE_FULL_SCALE);
+	}
+
+	if (capturePos >= LATENCY_CAPTURE_LEN)
+		state = LATENCY_DONE;
+	return 1;
+}
+
+/**
+ * Control task side: runs one measurement at the current sampling rate, and fills "result" in.
+ * Blocks for about LATENCY_CAPTURE_LEN frames plus the correlation (a few tens of ms).
+ */
+uint8_t latencyMeasure(latency_result_t *result) {
+
+	uint32_t start = HAL_GetTick();
+	uint32_t maxLag = LATENCY_CAPTURE_LEN - LATENCY_MLS_LEN;
+	uint32_t peakLag = 0;
+	float peak = 0.0f;
+	float energy = 0.0f;
+
+	if (state == LATENCY_RUNNING)
+		return LATENCY_BUSY;
+
+	generateMLS();
+	capturePos = 0;
+	state = LATENCY_RUNNING; // picked up by the audio task at the next frame
+
+	while (state != LATENCY_DONE) {
+		if (HAL_GetTick() - start > LATENCY_TIMEOUT_MS) {
+			state = LATENCY_IDLE;
+			return LATENCY_TIMEOUT;
+		}
+		osDelay(10);
+	}
+	state = LATENCY_IDLE;
+
+	for (uint32_t lag = 0; lag <= maxLag; lag++) {
+		float c = correlate(lag);
+		energy += c * c;
+		if (fabsf(c) > fabsf(peak)) {
+			peak = c;
+			peakLag = lag;
+		}
+	}
+
+	result->rate = audioGetSampleRate();
+	result->blockFrames = blockSamples / 2;
+	result->peakRatio = energy > 0.0f ? fabsf(peak) / sqrtf(energy / (maxLag + 1)) : 0.0f;
+
+	// parabolic interpolation of the peak:
+	float lagFrac = 0.0f;
+	if (peakLag > 0 && peakLag < maxLag) {
+		float cm = correlate(peakLag - 1);
+		float cp = correlate(peakLag + 1);
+		float d = cm - 2.0f * peak + cp;
+		if (d != 0.0f)
+			lagFrac = 0.5f * (cm - cp) / d;
+	}
+	result->samples = peakLag + lagFrac;
+	result->us = result->samples * 1e6f / result->rate;
+
+	return result->peakRatio >= LATENCY_MIN_RATIO ? LATENCY_OK : LATENCY_NO_PEAK;
+}
+
+/**
+ * Control task side: measures the round-trip latency from the line input at 16kHz and 48kHz, prints the results
+ * on the VCP and shows them on the LCD, then restores the previous input and sampling rate.
+ * Blocks for about a second: must be called from the UI task (the CODEC shares its I2C bus with the touchscreen).
+ */
+void latencyMeasureAll(void) {
+
+	static const uint32_t rates[] = { SAI_AUDIO_FREQUENCY_16K, SAI_AUDIO_FREQUENCY_48K };
+	uint32_t prevRate = audioGetSampleRate();
+	uint16_t prevInput = audioGetInput();
+	char buf[60];
+
+	if (audioSetInput(INPUT_DEVICE_INPUT_LINE_1) != AUDIO_OK) {
+		printf("latency: cannot switch to the line input\n");
+		return;
+	}
+
+	for (int i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+
+		latency_result_t r;
+		uint8_t ret;
+
+		if (audioSetSampleRate(rates[i]) != AUDIO_OK) {
+			snprintf(buf, sizeof(buf), "%2lu kHz: rate unavailable      ", rates[i] / 1000);
+		}
+		else {
+			osDelay(LATENCY_SETTLE_MS);
+			ret = latencyMeasure(&r);
+			if (ret == LATENCY_OK)
+				snprintf(buf, sizeof(buf), "%2lu kHz: %d smp, %d us         ", rates[i] / 1000, (int) roundf(r.samples), (int) r.us);
+			else if (ret == LATENCY_NO_PEAK)
+				snprintf(buf, sizeof(buf), "%2lu kHz: no loopback (%d)      ", rates[i] / 1000, (int) r.peakRatio);
+			else
+				snprintf(buf, sizeof(buf), "%2lu kHz: timeout               ", rates[i] / 1000);
+
+			// no float support in printf (newlib-nano), hence in hundredths of a sample:
+			if (ret == LATENCY_OK || ret == LATENCY_NO_PEAK) {
+				int centi = (int) roundf(r.samples * 100.0f);
+				printf("latency: %lu Hz, block %lu frames: %d.%02d samples = %d us (buffering %lu + CODEC %d, peak ratio %d)%s\n",
+						r.rate, r.blockFrames, centi / 100, centi % 100, (int) r.us, 2 * r.blockFrames,
+						(int) roundf(r.samples) - (int) (2 * r.blockFrames), (int) r.peakRatio, ret == LATENCY_OK ? "" : ", NOT DETECTED");
+			}
+			else
+				printf("latency: %lu Hz: timeout\n", rates[i]);
+		}
+
+		uiDisplayLatency(i, buf);
+	}
+
+	audioSetSampleRate(prevRate);
+	audioSetInput(prevInput);
+}
+
+/**
+ * Fills mls[] with a maximum length sequence of +/-1 values, from a 10 bit Fibonacci LFSR (x^10 + x^7 + 1).
+ */
+static void generateMLS(void) {
+
+	uint16_t lfsr = 0x3FF;
+
+	for (int i = 0; i < LATENCY_MLS_LEN; i++) {
+		mls[i] = (lfsr & 1) ? 1.0f : -1.0f;
+		uint16_t bit = (lfsr ^ (lfsr >> 3)) & 1;
+		lfsr = (lfsr >> 1) | (bit << 9);
+	}
+}
+
+static float correlate(uint32_t lag) {
+
+	float c;
+
+	arm_dot_prod_f32(capture + lag, mls, LATENCY_MLS_LEN, &c);
+	return c;
+}
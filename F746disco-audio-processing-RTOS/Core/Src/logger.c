@@ -0,0 +1,252 @@
+/*
+ * logger.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Deferred logging and non-blocking VCP output ===
+ *
+ * printf() used to send each character with a blocking HAL_UART_Transmit() (86us per character at 115200 bauds),
+ * which stalled the caller for the whole line, and from an interrupt or the audio task, everything below it.
+ *
+ * 1) LOG(fmt, args...) doesn't format anything: it stores the format string pointer (i.e. its identifier), a timestamp
+ *    and up to LOG_MAX_ARGS 32-bit arguments into a ring of LOG_RECORDS records. Any task or interrupt may call it:
+ *    a slot is claimed by incrementing the write index with LDREX/STREX, filled in, then published by writing its
+ *    sequence number last. This costs about a hundred cycles. When the ring is full, the message is dropped and counted.
+ *
+ * 2) The logger task (low priority) formats the published records, oldest first, as "[tick ms] message".
+ *
+ * 3) Its output and that of printf() (see _write() below, which overrides the one in syscalls.c) go into a byte ring,
+ *    which the USART1 TX interrupt drains in the background. A task calling printf() only waits when the byte ring is full.
+ *    An interrupt calling printf() never waits: what doesn't fit is dropped, and so is everything printed from the
+ *    interrupts above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY and the fault handlers. It still formats the text
+ *    in the interrupt: use LOG() there. Only before the scheduler is started does printf() fall back to the blocking
+ *    __io_putchar().
+ *
+ * The USART1 TX interrupt is used rather than a DMA stream, since the only stream USART1_TX is mapped to
+ * (DMA2 stream 7, channel 4) is already used by SAI2 block B, i.e. the audio input.
+ * Both rings are in SDRAM, see LOG_BUF_ADDR in disco_base.h.
+ */
+
+#include <logger.h>
+#include <telemetry.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "string.h"
+#include "main.h"
+#include "cmsis_os.h"
+#include "bsp/disco_base.h"
+
+extern UART_HandleTypeDef huart1; // VCP, see main.c
+extern int __io_putchar(int ch); // blocking, see disco_base.c
+
+#define LOG_RECORDS		128		// must be a power of two
+#define LOG_TX_SIZE		(LOG_BUF_SIZE_BYTES - LOG_RECORDS * sizeof(log_record_t))	// bytes, a power of two as well
+#define LOG_LINE_LEN	128
+#define LOG_POLL_MS		10
+
+typedef struct {
+	volatile uint32_t seq;	// index + 1 once the record is complete
+	const char *fmt;
+	uint32_t tick;
+	uint32_t args[LOG_MAX_ARGS];
+	uint32_t reserved;		// 32 bytes
+} log_record_t;
+
+// ----------- Local vars ------------
+
+static log_record_t *const records = (log_record_t*) LOG_BUF_ADDR;
+static volatile uint32_t recordWr = 0;	// records claimed so far
+static volatile uint32_t recordRd = 0;	// records formatted so far (logger task only)
+static volatile uint32_t dropped = 0;
+
+static uint8_t *const txRing = (uint8_t*) LOG_BUF_ADDR + LOG_RECORDS * sizeof(log_record_t);
+static volatile uint32_t txWr = 0;		// bytes queued so far
+static volatile uint32_t txRd = 0;		// bytes sent so far
+static volatile uint32_t txLen = 0;		// length of the transfer in progress, 0 if none
+
+static osThreadId loggerTaskHandle;
+
+// ------------ Private Function Prototypes ------------
+
+static void loggerTask(void const *argument);
+static void txWrite(const char *ptr, int len);
+static void txWriteFromISR(const char *ptr, int len);
+static void txStart(void);
+
+// ----------- Functions ------------
+
+/**
+ * Clears the rings and creates the logger task. Must be called before the scheduler is started, and before any LOG().
+ */
+void loggerInit(void) {
+
+	memset(records, 0, LOG_RECORDS * sizeof(log_record_t));
+
+	osThreadDef(logger, loggerTask, osPriorityLow, 0, 512);
+	loggerTaskHandle = osThreadCreate(osThread(logger), NULL);
+}
+
+/**
+ * Posts a message, see LOG(). Never blocks, may be called from any task or interrupt.
+ */
+void loggerWrite(int nargs, const char *fmt, ...) {
+
+	uint32_t i;
+	va_list ap;
+
+	do {
+		i = __LDREXW(&recordWr);
+		if (i - recordRd >= LOG_RECORDS) {
+			__CLREX();
+			dropped++;
+			return;
+		}
+	} while (__STREXW(i + 1, &recordWr));
+
+	log_record_t *r = &records[i & (LOG_RECORDS - 1)];
+	r->fmt = fmt;
+	r->tick = HAL_GetTick();
+	va_start(ap, fmt);
+	for (int k = 0; k < nargs; k++)
+		r->args[k] = va_arg(ap, uint32_t);
+	va_end(ap);
+
+	__DMB();
+	r->seq = i + 1;
+}
+
+uint32_t loggerGetDropped(void) {
+
+	return dropped;
+}
+
+static void loggerTask(void const *argument) {
+
+	char line[LOG_LINE_LEN];
+	uint32_t lastDropped = 0;
+
+	for (;;) {
+
+		log_record_t *r = &records[recordRd & (LOG_RECORDS - 1)];
+
+		if (recordRd == recordWr || r->seq != recordRd + 1) {
+			// empty, or the oldest record is still being written
+			if (dropped != lastDropped) {
+				lastDropped = dropped;
+				printf("log: %lu messages dropped so far\n", lastDropped);
+			}
+			osDelay(LOG_POLL_MS);
+			continue;
+		}
+
+		int len = snprintf(line, sizeof(line), "[%lu] ", r->tick);
+		len += snprintf(line + len, sizeof(line) - len, r->fmt, r->args[0], r->args[1], r->args[2], r->args[3]);
+		if (len >= sizeof(line))
+			len = sizeof(line) - 1;
+
+		__DMB();
+		recordRd++; // frees the slot
+
+		txWrite(line, len);
+	}
+}
+
+/**
+ * Overrides the weak _write() of syscalls.c, which printf() and co. end up calling: queues the characters for the
+ * USART1 TX interrupt, only waiting when the byte ring is full, and never from an interrupt.
+ */
+int _write(int file, char *ptr, int len) {
+
+	if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+		for (int i = 0; i < len; i++)
+			__io_putchar(ptr[i]);
+		return len;
+	}
+
+	if (__get_IPSR() != 0)
+		txWriteFromISR(ptr, len);
+	else
+		txWrite(ptr, len);
+	return len;
+}
+
+/**
+ * Copies "len" bytes into the byte ring and starts the transmission if none is in progress. Task context only.
+ */
+static void txWrite(const char *ptr, int len) {
+
+	while (len > 0) {
+
+		taskENTER_CRITICAL();
+		uint32_t room = LOG_TX_SIZE - (txWr - txRd);
+		uint32_t n = len < room ? len : room;
+		for (uint32_t i = 0; i < n; i++)
+			txRing[(txWr + i) & (LOG_TX_SIZE - 1)] = ptr[i];
+		txWr += n;
+		txStart();
+		taskEXIT_CRITICAL();
+
+		ptr += n;
+		len -= n;
+		if (len > 0)
+			osDelay(1); // full: 1ms is about 11 characters
+	}
+}
+
+/**
+ * Interrupt version of txWrite(): copies what fits into the byte ring and drops the rest, counted in "dropped".
+ * Interrupts that may not call FreeRTOS (above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY) can't enter the critical
+ * section that protects the ring, hence their output, and that of the NMI and HardFault handlers, is dropped entirely.
+ */
+static void txWriteFromISR(const char *ptr, int len) {
+
+	int32_t irq = (int32_t) __get_IPSR() - 16;
+
+	if (irq < MemoryManagement_IRQn || NVIC_GetPriority((IRQn_Type) irq) < configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY) {
+		dropped++;
+		return;
+	}
+
+	UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+	uint32_t room = LOG_TX_SIZE - (txWr - txRd);
+	uint32_t n = len < room ? len : room;
+	for (uint32_t i = 0; i < n; i++)
+		txRing[(txWr + i) & (LOG_TX_SIZE - 1)] = ptr[i];
+	txWr += n;
+	txStart();
+	taskEXIT_CRITICAL_FROM_ISR(mask);
+
+	if (n < len)
+		dropped++;
+}
+
+/**
+ * Starts sending the contiguous part of what is queued, unless a transfer is in progress.
+ * Called with the USART1 interrupt masked (critical section, or from the interrupt itself).
+ */
+static void txStart(void) {
+
+	if (txLen || txWr == txRd)
+		return;
+
+	uint32_t offset = txRd & (LOG_TX_SIZE - 1);
+	uint32_t n = txWr - txRd;
+	if (n > LOG_TX_SIZE - offset)
+		n = LOG_TX_SIZE - offset;
+
+	txLen = n;
+	if (HAL_UART_Transmit_IT(&huart1, txRing + offset, n) != HAL_OK)
+		txLen = 0; // retried at the next write
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+
+	if (huart == &huart1) {
+		txRd += txLen;
+		txLen = 0;
+		txStart();
+	}
+	else if (huart->Instance == USART6)
+		telemetryTxDone();
+}
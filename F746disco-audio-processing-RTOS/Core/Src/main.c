@@ -34,6 +34,7 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "bsp/mpu.h"
+#include "bsp/dwt.h"
 #include "test.h"
 #include "bsp/disco_lcd.h"
 #include "bsp/disco_base.h"
@@ -44,6 +45,18 @@
 #include "stdio.h"
 #include <audio.h>
 #include <ui.h>
+#include <recorder.h>
+#include <player.h>
+#include <assets.h>
+#include <crc.h>
+#include <presets.h>
+#include <cpuload.h>
+#include <trace.h>
+#include <logger.h>
+#include <telemetry.h>
+#include <monitor.h>
+#include <display.h>
+#include <images.h>
 
 /* USER CODE END Includes */
 
@@ -86,6 +99,8 @@ DMA_HandleTypeDef hdma_sai2_a;
 DMA_HandleTypeDef hdma_sai2_b;
 
 SD_HandleTypeDef hsd1;
+DMA_HandleTypeDef hdma_sdmmc1;
+DMA_HandleTypeDef hdma_usart6_tx;
 
 SPDIFRX_HandleTypeDef hspdif;
 
@@ -225,6 +240,7 @@ int main(void)
 	/* USER CODE BEGIN 2 */
 
 	MPU_Init();
+	DWT_Init(); // cycle counter, see dwt.h
 
 	/* post-init SDRAM */
 	// Deactivate speculative/cache access to first FMC Bank to save FMC bandwidth
@@ -234,9 +250,17 @@ int main(void)
 	TS_Init();
 	printf("Touchscreen Init: OK\n");
 
+	crcInit(); // the CRC unit is shared by assets.c, presets.c and telemetry.c, see crc.c
+
+	/* QSPI is memory-mapped at this point: check the asset store (see assets.c) */
+	assetsInit();
+
 	SCB_EnableICache(); // comment out if in step debugging to avoid weird behaviours
 	SCB_EnableDCache();
 
+	/* restore the last saved effect chain and parameters (see presets.c) */
+	presetsInit();
+
 //	test();
 //	audioLoop(); // comment to use RTOS (see below)
 
@@ -269,6 +293,17 @@ int main(void)
 
 	/* USER CODE BEGIN RTOS_THREADS */
 
+	loggerInit(); // deferred logging and non-blocking printf, see logger.c
+	audioInit(); // realtime audio task, see audio.c
+	recorderInit(); // SD-card writer task, see recorder.c
+	playerInit(); // SD-card reader task, see player.c
+	cpuLoadInit(); // per-task CPU load monitor, see cpuload.c
+	telemetryInit(); // binary telemetry on USART6, see telemetry.c
+	monitorInit(); // ADPCM audio monitor on the telemetry link, see monitor.c
+	displayInit(); // display task, the only one drawing on the LCD, see display.c
+	imagesInit(); // JPEG skins decoded once into an LRU cache in SDRAM, see images.c
+	imagesRequest("background"); // decoded while the UI task starts up
+
 	/* USER CODE END RTOS_THREADS */
 
 	/* Start scheduler */
@@ -857,7 +892,7 @@ static void MX_SAI2_Init(void)
 	hsai_BlockA2.Instance = SAI2_Block_A;
 	hsai_BlockA2.Init.Protocol = SAI_FREE_PROTOCOL;
 	hsai_BlockA2.Init.AudioMode = SAI_MODEMASTER_TX;
-	hsai_BlockA2.Init.DataSize = SAI_DATASIZE_16;
+	hsai_BlockA2.Init.DataSize = AUDIO_SAI_DATASIZE; // see AUDIO_SAMPLE_24IN32 in disco_sai.h
 	hsai_BlockA2.Init.FirstBit = SAI_FIRSTBIT_MSB;
 	hsai_BlockA2.Init.ClockStrobing = SAI_CLOCKSTROBING_RISINGEDGE;
 	hsai_BlockA2.Init.Synchro = SAI_ASYNCHRONOUS;
@@ -869,8 +904,8 @@ static void MX_SAI2_Init(void)
 	hsai_BlockA2.Init.MonoStereoMode = SAI_STEREOMODE;
 	hsai_BlockA2.Init.CompandingMode = SAI_NOCOMPANDING;
 	hsai_BlockA2.Init.TriState = SAI_OUTPUT_NOTRELEASED;
-	hsai_BlockA2.FrameInit.FrameLength = 64;
-	hsai_BlockA2.FrameInit.ActiveFrameLength = 32;
+	hsai_BlockA2.FrameInit.FrameLength = AUDIO_SAI_FRAME_LENGTH;
+	hsai_BlockA2.FrameInit.ActiveFrameLength = AUDIO_SAI_FRAME_LENGTH / 2;
 	hsai_BlockA2.FrameInit.FSDefinition = SAI_FS_CHANNEL_IDENTIFICATION;
 	hsai_BlockA2.FrameInit.FSPolarity = SAI_FS_ACTIVE_LOW;
 	hsai_BlockA2.FrameInit.FSOffset = SAI_FS_BEFOREFIRSTBIT;
@@ -885,7 +920,7 @@ static void MX_SAI2_Init(void)
 	hsai_BlockB2.Instance = SAI2_Block_B;
 	hsai_BlockB2.Init.Protocol = SAI_FREE_PROTOCOL;
 	hsai_BlockB2.Init.AudioMode = SAI_MODESLAVE_RX;
-	hsai_BlockB2.Init.DataSize = SAI_DATASIZE_16;
+	hsai_BlockB2.Init.DataSize = AUDIO_SAI_DATASIZE; // see AUDIO_SAMPLE_24IN32 in disco_sai.h
 	hsai_BlockB2.Init.FirstBit = SAI_FIRSTBIT_MSB;
 	hsai_BlockB2.Init.ClockStrobing = SAI_CLOCKSTROBING_RISINGEDGE;
 	hsai_BlockB2.Init.Synchro = SAI_SYNCHRONOUS;
@@ -895,8 +930,8 @@ static void MX_SAI2_Init(void)
 	hsai_BlockB2.Init.MonoStereoMode = SAI_STEREOMODE;
 	hsai_BlockB2.Init.CompandingMode = SAI_NOCOMPANDING;
 	hsai_BlockB2.Init.TriState = SAI_OUTPUT_NOTRELEASED;
-	hsai_BlockB2.FrameInit.FrameLength = 64;
-	hsai_BlockB2.FrameInit.ActiveFrameLength = 32;
+	hsai_BlockB2.FrameInit.FrameLength = AUDIO_SAI_FRAME_LENGTH;
+	hsai_BlockB2.FrameInit.ActiveFrameLength = AUDIO_SAI_FRAME_LENGTH / 2;
 	hsai_BlockB2.FrameInit.FSDefinition = SAI_FS_CHANNEL_IDENTIFICATION;
 	hsai_BlockB2.FrameInit.FSPolarity = SAI_FS_ACTIVE_LOW;
 	hsai_BlockB2.FrameInit.FSOffset = SAI_FS_BEFOREFIRSTBIT;
@@ -1719,13 +1754,13 @@ void StartDefaultTask(void const * argument)
 	/* USER CODE BEGIN 5 */
 
 	printf("StartDefaultTask\n");
-	audioLoop();
 
+	// the audio loop runs in its own task (see audioInit()), this one only initializes the USB host
 	//uint32_t PreviousWakeTime = osKernelSysTick();
 	/* Infinite loop */
 	for(;;)
 	{
-		//osDelay(1000);
+		osDelay(1000);
 		//osDelayUntil (&PreviousWakeTime, 500);
 //		printf("thread alive : %d\n", i++);
 //		printf("waiting for signal...\n");
@@ -1764,11 +1799,18 @@ void startUITask(void const * argument)
 		/* Permet d'attendre le signal 0x0003 pour l'affichage des niveau sonore des channels sur l'écran LCD */
 		osSignalWait(0x0003, osWaitForever);
 		uiDisplayInputLevel(inputLevelL_cp, inputLevelR_cp);
-
-		/* Permet d'afficher le spectrogramme en temps réel du son ambiant */
-		for(int y = FFT_Length/2 + y1; y > y1; y--){
-			LCD_DrawPixel_Color(x + time, y, aFFT_Input_f32[(FFT_Length/2 + y1) - y]);
+		uiHandleTouch(); // input and sampling rate buttons
+		presetsService(); // saves the settings a while after they have changed, see presets.c
+		audioReportMonitor(); // RX/TX phase, see audio.c
+		uiDisplayCpuLoad(); // see cpuload.c
+		traceService(); // dumps the event trace after an xrun or on the user button, see trace.c
+
+		/* Permet d'afficher le spectrogramme en temps réel du son ambiant (basses fréquences en bas) */
+		uint16_t column[FFT_Length/2];
+		for(int i = 0; i < FFT_Length/2; i++){
+			column[i] = (uint16_t) aFFT_Input_f32[FFT_Length/2 - 1 - i];
 		}
+		displayColumn(x + time, y1 + 1, column, FFT_Length/2);
 		if(time < 400){
 			time += 1;
 		}
@@ -0,0 +1,161 @@
+/*
+ * monitor.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Remote audio monitor over the telemetry link ===
+ *
+ * 48kHz 16-bit stereo is 192kbytes/s, which doesn't fit through USART6 along with the telemetry (see telemetry.c).
+ * IMA-ADPCM (see adpcm.c) brings it down to 4 bits per sample, i.e. 48kbytes/s, about a quarter of the link.
+ *
+ * As for the recorder (see recorder.c), the audio task never waits:
+ * - monitorPushBlock() is called by the audio task after each processed frame: it copies the frame, as 16-bit samples,
+ *   into a slot of a ring in SDRAM (see MONITOR_BUF_ADDR in disco_base.h) and returns immediately. If the ring is full
+ *   the frame is dropped and counted as an overrun.
+ * - a low-priority task (monitorTask) codes each slot into a TLM_AUDIO frame (see monitor.h) and sends it with
+ *   telemetrySend(). Each frame carries the coder state, so the receiver can decode it even after a lost frame, and
+ *   its position, so that the receiver can fill the gap with silence.
+ *
+ * The slot counters are free-running: slotWr is only written by the audio task, slotRd only by the monitor task.
+ * Coding costs about 30 cycles per sample, i.e. well under 2% of the CPU at 48kHz.
+ * Decode with tools/tlmrecv.c (-w file.wav).
+ */
+
+#include <monitor.h>
+#include "string.h"
+#include "cmsis_os.h"
+#include "bsp/disco_base.h"
+
+#define MON_SIG_DATA		0x0001	// at least one slot is waiting
+
+typedef struct {
+	uint32_t position;
+	uint32_t sampleRate;
+	uint32_t frames;
+	int16_t samples[2 * MONITOR_BLOCK_FRAMES];
+} monitor_slot_t;
+
+#define MONITOR_SLOTS		(MONITOR_BUF_SIZE_BYTES / sizeof(monitor_slot_t))
+
+// ----------- Local vars ------------
+
+static monitor_slot_t *const slots = (monitor_slot_t*) MONITOR_BUF_ADDR;
+static volatile uint8_t running = 0;
+static volatile uint32_t slotWr = 0;	// audio task only
+static volatile uint32_t slotRd = 0;	// monitor task only
+static volatile uint32_t overruns = 0;
+static uint32_t position = 0;			// audio task only
+
+static osThreadId monitorTaskHandle;
+
+// ------------ Private Function Prototypes ------------
+
+static void monitorTask(void const *argument);
+
+// ----------- Functions ------------
+
+/**
+ * Creates the monitor task, and starts monitoring. Must be called before the scheduler is started, after telemetryInit().
+ */
+void monitorInit(void) {
+
+	osThreadDef(monitor, monitorTask, osPriorityLow, 0, 256);
+	monitorTaskHandle = osThreadCreate(osThread(monitor), NULL);
+	monitorStart();
+}
+
+/**
+ * Starts sending the output of the audio task; positions start over from 0.
+ */
+void monitorStart(void) {
+
+	if (running)
+		return;
+	overruns = 0;
+	position = 0;
+	__DMB();
+	running = 1;
+}
+
+void monitorStop(void) {
+
+	running = 0;
+}
+
+/**
+ * Number of frames dropped because the ring was full since the last monitorStart()
+ */
+uint32_t monitorGetOverruns(void) {
+
+	return overruns;
+}
+
+/**
+ * Called by the audio task after each processed frame: copies "sampleCount" interleaved stereo samples into the ring.
+ * Never blocks: if the monitor task or the link lag behind so much that the ring is full, the frame is dropped.
+ */
+void monitorPushBlock(const audio_sample_t *buf, uint32_t sampleCount, uint32_t sampleRate) {
+
+	if (!running || monitorTaskHandle == NULL)
+		return;
+
+	while (sampleCount) {
+
+		uint32_t frames = sampleCount / 2 > MONITOR_BLOCK_FRAMES ? MONITOR_BLOCK_FRAMES : sampleCount / 2;
+		uint32_t wr = slotWr;
+
+		if (wr - slotRd >= MONITOR_SLOTS)
+			overruns++;
+		else {
+			monitor_slot_t *slot = &slots[wr % MONITOR_SLOTS];
+			slot->position = position;
+			slot->sampleRate = sampleRate;
+			slot->frames = frames;
+			for (uint32_t i = 0; i < 2 * frames; i++)
+				slot->samples[i] = (int16_t) (buf[i] >> (8 * (sizeof(audio_sample_t) - 2))); // 16 MSBs
+			__DMB(); // the slot must have reached SDRAM before the monitor task sees it
+			slotWr = wr + 1;
+			osSignalSet(monitorTaskHandle, MON_SIG_DATA);
+		}
+
+		position += frames;
+		buf += 2 * frames;
+		sampleCount -= 2 * frames;
+	}
+}
+
+/**
+ * Monitor task: codes the waiting slots and sends them. Blocks in telemetrySend() while the link is busy.
+ */
+static void monitorTask(void const *argument) {
+
+	static tlm_audio_t frame;
+	adpcm_state_t state[2] = { { 0, 0, 0 }, { 0, 0, 0 } };
+
+	for (;;) {
+
+		osSignalWait(MON_SIG_DATA, osWaitForever);
+
+		while (slotRd != slotWr) {
+
+			const monitor_slot_t *slot = &slots[slotRd % MONITOR_SLOTS];
+
+			frame.sampleRate = slot->sampleRate;
+			frame.position = slot->position;
+			frame.frames = (uint16_t) slot->frames;
+			frame.channels = 2;
+			frame.reserved = 0;
+			frame.state[0] = state[0];
+			frame.state[1] = state[1];
+			for (uint32_t i = 0; i < slot->frames; i++)
+				frame.data[i] = adpcmEncode(&state[0], slot->samples[2 * i])
+						| (adpcmEncode(&state[1], slot->samples[2 * i + 1]) << 4);
+
+			__DMB(); // done reading the slot
+			slotRd++;
+
+			telemetrySend(&frame, MONITOR_FRAME_LEN(frame.frames), TLM_AUDIO);
+		}
+	}
+}
@@ -0,0 +1,387 @@
+/*
+ * player.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === SD-card WAV player ===
+ *
+ * Injects recorded test material (e.g. files made by recorder.c) instead of the live CODEC input.
+ *
+ * Same split as the recorder, the other way round:
+ * - a low-priority reader task (playerTask) streams the WAV data from the SD-card into a read-ahead ring
+ *   in SDRAM (see PLAYER_RING_ADDR in disco_base.h), in chunks of PLAYER_CHUNK_BYTES that end on a chunk
+ *   boundary in the file, so that FatFs DMAs whole sector runs straight into SDRAM.
+ * - the audio task calls playerSource() once per frame: it copies one frame out of the ring and never touches
+ *   the SD-card. If the ring ran dry, the live input is used for this frame and an underrun is counted.
+ *
+ * The reader task wakes up whenever a whole chunk of the ring is free again.
+ *
+ * Seeking and looping rely on the FatFs fast seek feature (_USE_FASTSEEK in ffconf.h): the cluster link map of
+ * the file is built once when it is opened, after which f_lseek() no longer follows the FAT chain on the card.
+ *
+ * Only 16 bit stereo PCM files are supported, and no sample rate conversion is carried out
+ * (with AUDIO_SAMPLE_24IN32, samples are expanded to 32 bits by playerSource()).
+ */
+
+#include <player.h>
+#include <stdio.h>
+#include "string.h"
+#include "fatfs.h"
+#include "cmsis_os.h"
+#include "bsp/disco_base.h"
+
+// ---------- reader task signals -------------
+
+#define PLAYER_SIG_DATA		0x0001	// at least one chunk of the ring is free
+#define PLAYER_SIG_START	0x0002	// a new file must be opened
+#define PLAYER_SIG_STOP		0x0004	// close the file
+#define PLAYER_SIG_SEEK		0x0008	// restart reading from seekTarget
+#define PLAYER_SIG_ALL		(PLAYER_SIG_DATA | PLAYER_SIG_START | PLAYER_SIG_STOP | PLAYER_SIG_SEEK)
+
+#define PLAYER_CHUNK_BYTES	((uint32_t)(32 * 1024))
+#define PLAYER_RING_MASK	(PLAYER_RING_SIZE_BYTES - 1)
+#define PLAYER_CLMT_SIZE	64		// cluster link map entries: (number of fragments + 1) * 2 are needed
+
+typedef enum {
+	PLAYER_IDLE = 0, PLAYER_OPENING, PLAYER_PLAYING, PLAYER_STOPPING
+} player_state_t;
+
+// ----------- Local vars ------------
+
+static volatile player_state_t state = PLAYER_IDLE;
+static volatile uint32_t ringWr = 0; // bytes read from the file into the ring (reader task only)
+static volatile uint32_t ringRd = 0; // bytes consumed by the audio task
+static volatile uint8_t eof;
+static volatile uint32_t underruns = 0;
+static volatile uint32_t seekTarget;
+
+static char playPath[16];
+static uint8_t playLoop;
+static FIL playFile;
+static DWORD clmt[PLAYER_CLMT_SIZE];
+static FSIZE_t dataStart, dataEnd, filePos;
+static uint32_t sampleRate;
+
+static audio_sample_t playBuf[512]; // one audio frame, see AUDIO_BUF_SIZE in audio.c
+
+static osThreadId playerTaskHandle;
+
+// ------------ Private Function Prototypes ------------
+
+static void playerTask(void const *argument);
+static void openFile(void);
+static void closeFile(void);
+static void seekFile(FSIZE_t dataOffset);
+static void fillRing(void);
+static uint8_t parseWavHeader(void);
+
+// ----------- Functions ------------
+
+/**
+ * Creates the reader task. Must be called before the scheduler is started.
+ * Like the recorder writer task, it runs above the UI task so that spectrogram redraws can't starve the ring.
+ */
+void playerInit(void) {
+
+	osThreadDef(playerTask, playerTask, osPriorityBelowNormal, 0, 512);
+	playerTaskHandle = osThreadCreate(osThread(playerTask), NULL);
+}
+
+/**
+ * Asks the reader task to open the WAV file at "path" (8.3 file name) and to start playing it
+ * once the ring has been filled. If "loop" is set, playback restarts at the beginning of the data
+ * when the end of the file is reached.
+ */
+uint8_t playerStart(const char *path, uint8_t loop) {
+
+	if (state != PLAYER_IDLE)
+		return PLAYER_BUSY;
+
+	strncpy(playPath, path, sizeof(playPath) - 1);
+	playPath[sizeof(playPath) - 1] = 0;
+	playLoop = loop;
+
+	state = PLAYER_OPENING;
+	osSignalSet(playerTaskHandle, PLAYER_SIG_START);
+	return PLAYER_OK;
+}
+
+void playerStop(void) {
+
+	if (state == PLAYER_IDLE)
+		return;
+	osSignalSet(playerTaskHandle, PLAYER_SIG_STOP);
+}
+
+/**
+ * Asks the reader task to jump to the given position (in milliseconds from the beginning of the file).
+ */
+void playerSeek(uint32_t ms) {
+
+	if (state != PLAYER_PLAYING)
+		return;
+	seekTarget = ms;
+	osSignalSet(playerTaskHandle, PLAYER_SIG_SEEK);
+}
+
+uint8_t playerIsPlaying(void) {
+
+	return state == PLAYER_PLAYING;
+}
+
+/**
+ * Playing, or about to: the file is being opened, or the ring filled.
+ */
+uint8_t playerIsActive(void) {
+
+	return state != PLAYER_IDLE;
+}
+
+uint32_t playerGetSampleRate(void) {
+
+	return sampleRate;
+}
+
+/**
+ * Number of frames for which the ring was empty since the last playerStart()
+ */
+uint32_t playerGetUnderruns(void) {
+
+	return underruns;
+}
+
+/**
+ * Called by the audio task once per frame: returns the next "sampleCount" interleaved stereo samples from the file,
+ * or "live" (i.e. the CODEC input) if no file is playing or if the ring ran dry. Never blocks.
+ */
+const audio_sample_t* playerSource(const audio_sample_t *live, uint32_t sampleCount) {
+
+	if (state != PLAYER_PLAYING)
+		return live;
+
+	uint32_t len = sampleCount * sizeof(int16_t); // samples in the ring are always 16 bit
+	uint32_t rd = ringRd;
+	uint32_t fill = ringWr - rd;
+
+	if (len > sizeof(playBuf))
+		return live;
+
+	if (fill < len) {
+		if (eof) { // end of file (not looping) and ring drained
+			state = PLAYER_STOPPING;
+			osSignalSet(playerTaskHandle, PLAYER_SIG_STOP);
+		}
+		else
+			underruns++;
+		return live;
+	}
+
+	uint32_t offset = rd & PLAYER_RING_MASK;
+	uint32_t first = PLAYER_RING_SIZE_BYTES - offset;
+	if (first > len)
+		first = len;
+	memcpy(playBuf, (uint8_t*) PLAYER_RING_ADDR + offset, first);
+	memcpy((uint8_t*) playBuf + first, (uint8_t*) PLAYER_RING_ADDR, len - first);
+
+	ringRd = rd + len;
+
+#ifdef AUDIO_SAMPLE_24IN32
+	// expand in place, from the end so that no 16-bit sample is overwritten before it is read:
+	for (int i = sampleCount - 1; i >= 0; i--)
+		playBuf[i] = AUDIO_SAMPLE_FROM_16(((int16_t*) playBuf)[i]);
+#endif
+
+	// wake the reader up once a whole chunk is free again (signals are latched, so a wakeup can't get lost):
+	uint32_t freeBefore = PLAYER_RING_SIZE_BYTES - fill;
+	if (freeBefore < PLAYER_CHUNK_BYTES && freeBefore + len >= PLAYER_CHUNK_BYTES)
+		osSignalSet(playerTaskHandle, PLAYER_SIG_DATA);
+
+	return playBuf;
+}
+
+/**
+ * Reader task.
+ * Note that the audio task has a higher priority, hence it is never preempted in the middle of playerSource() by this task:
+ * this is what allows the reader to reset both ring indexes when seeking.
+ */
+static void playerTask(void const *argument) {
+
+	for (;;) {
+
+		osEvent evt = osSignalWait(PLAYER_SIG_ALL, osWaitForever);
+		if (evt.status != osEventSignal)
+			continue;
+
+		if (evt.value.signals & PLAYER_SIG_START)
+			openFile();
+
+		if (evt.value.signals & PLAYER_SIG_STOP) {
+			closeFile();
+			continue;
+		}
+
+		if ((evt.value.signals & PLAYER_SIG_SEEK) && state == PLAYER_PLAYING)
+			seekFile((FSIZE_t) ((uint64_t) seekTarget * sampleRate / 1000) * 4); // 4 bytes per stereo frame
+
+		if (state == PLAYER_PLAYING)
+			fillRing();
+	}
+}
+
+/**
+ * Opens the file, builds its cluster link map and pre-fills the ring before letting the audio task in.
+ */
+static void openFile(void) {
+
+	if (state != PLAYER_OPENING)
+		return;
+
+	if (FATFS_MountSD() != FR_OK || f_open(&playFile, playPath, FA_READ) != FR_OK) {
+		printf("player: cannot open %s\n", playPath);
+		state = PLAYER_IDLE;
+		return;
+	}
+
+	if (!parseWavHeader()) {
+		printf("player: %s is not a 16 bit stereo PCM file\n", playPath);
+		f_close(&playFile);
+		state = PLAYER_IDLE;
+		return;
+	}
+
+	// fast seek: f_lseek() will use the cluster link map instead of following the FAT chain
+	playFile.cltbl = clmt;
+	clmt[0] = PLAYER_CLMT_SIZE;
+	if (f_lseek(&playFile, CREATE_LINKMAP) != FR_OK) {
+		printf("player: %s is too fragmented for fast seek\n", playPath);
+		playFile.cltbl = NULL;
+	}
+
+	underruns = 0;
+	seekFile(0);
+	printf("player: playing %s, %lu Hz\n", playPath, sampleRate);
+}
+
+static void closeFile(void) {
+
+	if (state == PLAYER_IDLE)
+		return;
+	f_close(&playFile);
+	state = PLAYER_IDLE;
+}
+
+/**
+ * (Re)starts reading at "dataOffset" bytes from the beginning of the audio data and pre-fills the ring.
+ * The audio task keeps using its live input until the ring is full.
+ */
+static void seekFile(FSIZE_t dataOffset) {
+
+	if (dataStart + dataOffset >= dataEnd)
+		dataOffset = 0;
+	dataOffset &= ~(FSIZE_t) 3; // keep L/R samples in order
+
+	state = PLAYER_OPENING;
+	filePos = dataStart + dataOffset;
+	eof = 0;
+	ringRd = 0;
+	ringWr = 0;
+
+	if (f_lseek(&playFile, filePos) != FR_OK) {
+		printf("player: seek error on %s\n", playPath);
+		f_close(&playFile);
+		state = PLAYER_IDLE;
+		return;
+	}
+
+	fillRing();
+	state = PLAYER_PLAYING;
+}
+
+/**
+ * Reads chunks from the file into the ring as long as one whole chunk is free.
+ * Each read ends on a chunk boundary in the file (hence on a sector boundary) and never wraps around the ring.
+ */
+static void fillRing(void) {
+
+	while (!eof) {
+
+		uint32_t wr = ringWr;
+		if (PLAYER_RING_SIZE_BYTES - (wr - ringRd) < PLAYER_CHUNK_BYTES)
+			return;
+
+		if (filePos >= dataEnd) {
+			if (!playLoop) {
+				eof = 1;
+				return;
+			}
+			filePos = dataStart; // instant with the cluster link map
+			if (f_lseek(&playFile, filePos) != FR_OK) {
+				eof = 1;
+				return;
+			}
+		}
+
+		uint32_t len = PLAYER_CHUNK_BYTES - (uint32_t) (filePos % PLAYER_CHUNK_BYTES);
+		uint32_t offset = wr & PLAYER_RING_MASK;
+		if (len > PLAYER_RING_SIZE_BYTES - offset)
+			len = PLAYER_RING_SIZE_BYTES - offset;
+		if (len > dataEnd - filePos)
+			len = (uint32_t) (dataEnd - filePos);
+
+		UINT br;
+		if (f_read(&playFile, (uint8_t*) PLAYER_RING_ADDR + offset, len, &br) != FR_OK || br == 0) {
+			printf("player: read error on %s\n", playPath);
+			eof = 1;
+			return;
+		}
+		filePos += br;
+		ringWr = wr + br;
+	}
+}
+
+static uint32_t getLE32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t getLE16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+/**
+ * Walks the RIFF chunks up to the "data" one. Sets sampleRate, dataStart and dataEnd.
+ * Returns 1 if the file is a 16 bit stereo PCM WAV file.
+ */
+static uint8_t parseWavHeader(void) {
+
+	uint8_t h[24];
+	UINT br;
+	uint8_t fmtOk = 0;
+	FSIZE_t pos = 12;
+
+	if (f_read(&playFile, h, 12, &br) != FR_OK || br != 12 || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVE", 4))
+		return 0;
+
+	while (pos + 8 <= f_size(&playFile)) {
+
+		if (f_lseek(&playFile, pos) != FR_OK || f_read(&playFile, h, 8, &br) != FR_OK || br != 8)
+			return 0;
+		uint32_t size = getLE32(h + 4);
+
+		if (!memcmp(h, "fmt ", 4)) {
+			if (size < 16 || f_read(&playFile, h + 8, 16, &br) != FR_OK || br != 16)
+				return 0;
+			fmtOk = getLE16(h + 8) == 1 && getLE16(h + 10) == 2 && getLE16(h + 22) == 16;
+			sampleRate = getLE32(h + 12);
+		}
+		else if (!memcmp(h, "data", 4)) {
+			dataStart = pos + 8;
+			dataEnd = dataStart + size;
+			if (dataEnd > f_size(&playFile)) // e.g. recording that was not closed properly
+				dataEnd = f_size(&playFile);
+			return fmtOk;
+		}
+		pos += 8 + size + (size & 1); // chunks are word aligned
+	}
+	return 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * presets.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Persistent settings log in QSPI flash ===
+ *
+ * The effect chain and parameters (audio_settings_t) are saved as records appended to a log that occupies
+ * the top QSPI_SETTINGS_SIZE bytes of the QSPI flash, i.e. 64 subsectors of 4kbytes:
+ *
+ * 		subsector:	| sector_header_t | record | record | ... | erased (0xFF) |
+ * 		record:		| record_header_t | payload (padded to 4 bytes) |
+ *
+ * - Records are never overwritten: a new one is appended after the last one, and when the current subsector is full
+ *   the next one (modulo 64) is erased and stamped with an incremented sequence number. Erases hence rotate over the
+ *   whole region, which spreads the wear evenly (wear levelling).
+ * - Each record holds a sequence number and a CRC computed by the on-chip CRC unit (see crc.c).
+ *   A record torn by a power failure fails its CRC and is ignored, and the previous record is used instead.
+ *   Likewise, a power failure while rotating leaves the newest subsector empty, and the previous one still holds
+ *   the last record.
+ *
+ * At boot, presetsInit() reads the 64 subsector headers through the memory-mapped QSPI flash, walks the newest
+ * subsector (and, if it is empty, the previous one), and applies the last valid record: this takes well under a millisecond.
+ * The sampling rate and the input of the record follow once the UI task runs (see audioApplyStreamSettings()).
+ *
+ * Writing requires leaving the memory-mapped mode for the duration of the erase/program (up to 800ms for an erase):
+ * presetsSave() owns the QSPI flash meanwhile (see assetsLock()), and the code reading it in place (assets, images
+ * drawn by the DMA2D or decoded by images.c) waits.
+ *
+ * Settings are saved by presetsService(), called periodically by the UI task, once they have changed (e.g. the input or
+ * the sampling rate from the touchscreen) and then stayed the same for PRESETS_SAVE_DELAY ms: sweeping a parameter
+ * hence writes a single record.
+ */
+
+#include <presets.h>
+#include <assets.h>
+#include <crc.h>
+#include <stdio.h>
+#include "string.h"
+#include "main.h"
+#include "bsp/disco_base.h"
+#include "bsp/disco_qspi.h"
+#include "cmsis_os.h"
+
+extern QSPI_HandleTypeDef hqspi;
+
+#define PRESETS_OFFSET		(QSPI_DEVICE_SIZE - QSPI_SETTINGS_SIZE)	// flash address of the log
+#define PRESETS_ADDR		(QSPI_DEVICE_ADDR + PRESETS_OFFSET)		// memory-mapped address of the log
+#define SECTOR_SIZE			N25Q128A_SUBSECTOR_SIZE
+#define SECTOR_COUNT		(QSPI_SETTINGS_SIZE / SECTOR_SIZE)
+
+#define SECTOR_MAGIC		0x43455350	// "PSEC"
+#define RECORD_MAGIC		0x5250		// "PR"
+#define ERASED_16			0xFFFF
+
+#define ALIGN4(x)			(((x) + 3) & ~3)
+
+#define PRESETS_SAVE_DELAY	3000	// ms
+
+typedef struct {
+	uint32_t magic;
+	uint32_t seq;		// incremented at each rotation
+	uint32_t seqInv;	// ~seq, guards against a torn header
+	uint32_t reserved;
+} sector_header_t;
+
+typedef struct {
+	uint16_t magic;
+	uint16_t len;		// payload length in bytes
+	uint32_t seq;		// incremented at each record
+	uint32_t crc;		// CRC of magic, len, seq and payload
+} record_header_t;
+
+// ----------- Local vars ------------
+
+static int curSector = -1;			// subsector records are appended to, -1 as long as the log is empty
+static uint32_t curSectorSeq;
+static uint32_t writeOffset;		// offset of the next record in curSector
+static uint32_t lastRecordSeq;
+
+// presetsService():
+static audio_settings_t saved;		// last saved or restored settings
+static audio_settings_t changed;	// settings that differ from "saved", since changedAt
+static uint32_t changedAt;
+static uint8_t savedValid = 0;
+
+// record being written (must not live in the QSPI flash itself)
+static uint32_t recordBuf[(sizeof(record_header_t) + ALIGN4(sizeof(audio_settings_t))) / 4];
+
+// ------------ Private Function Prototypes ------------
+
+static const sector_header_t* sectorHeader(int s);
+static uint32_t recordCrc(const record_header_t *h, const void *payload);
+static const record_header_t* walkSector(int s, uint32_t *endOffset);
+static uint8_t rotate(void);
+
+// ----------- Functions ------------
+
+/**
+ * Mounts the log and applies the last valid settings record, if any.
+ * Must be called after MX_QUADSPI_Init() and crcInit().
+ */
+uint8_t presetsInit(void) {
+
+	const record_header_t *last = NULL;
+	uint32_t end;
+
+	curSector = -1;
+	lastRecordSeq = 0;
+
+	// newest subsector:
+	for (int s = 0; s < SECTOR_COUNT; s++) {
+		const sector_header_t *h = sectorHeader(s);
+		if (h->magic != SECTOR_MAGIC || h->seq != ~h->seqInv)
+			continue;
+		if (curSector < 0 || (int32_t) (h->seq - curSectorSeq) > 0) {
+			curSector = s;
+			curSectorSeq = h->seq;
+		}
+	}
+
+	if (curSector < 0) {
+		printf("presets: empty log\n");
+		return PRESETS_EMPTY;
+	}
+
+	last = walkSector(curSector, &writeOffset);
+
+	// power failure right after a rotation: the last record is in the previous subsector
+	if (last == NULL) {
+		int prev = (curSector + SECTOR_COUNT - 1) % SECTOR_COUNT;
+		const sector_header_t *h = sectorHeader(prev);
+		if (h->magic == SECTOR_MAGIC && h->seq == ~h->seqInv && h->seq == curSectorSeq - 1)
+			last = walkSector(prev, &end);
+	}
+
+	if (last == NULL) {
+		printf("presets: no valid record\n");
+		return PRESETS_EMPTY;
+	}
+
+	lastRecordSeq = last->seq;
+
+	audio_settings_t s;
+	if (last->len != sizeof(s) || ((const audio_settings_t*) (last + 1))->version != AUDIO_SETTINGS_VERSION) {
+		printf("presets: record #%lu has an older settings layout, ignored\n", last->seq);
+		return PRESETS_EMPTY;
+	}
+	memcpy(&s, last + 1, sizeof(s));
+	if (audioApplySettings(&s) != AUDIO_OK) {
+		printf("presets: record #%lu doesn't fit the current build, ignored\n", last->seq);
+		return PRESETS_EMPTY;
+	}
+
+	printf("presets: restored record #%lu\n", last->seq);
+	return PRESETS_OK;
+}
+
+/**
+ * Appends a settings record to the log. Blocking (up to one subsector erase), so call it from a low priority task.
+ */
+uint8_t presetsSave(const audio_settings_t *s) {
+
+	record_header_t *h = (record_header_t*) recordBuf;
+	uint32_t size = sizeof(record_header_t) + ALIGN4(sizeof(audio_settings_t));
+	uint8_t ret = PRESETS_OK;
+
+	memset(recordBuf, 0xFF, sizeof(recordBuf));
+	h->magic = RECORD_MAGIC;
+	h->len = sizeof(audio_settings_t);
+	h->seq = lastRecordSeq + 1;
+	memcpy(h + 1, s, sizeof(audio_settings_t));
+	h->crc = recordCrc(h, h + 1);
+
+	// leave the memory-mapped mode to be able to send erase/program commands, once no one reads the flash
+	assetsLock();
+	HAL_QSPI_Abort(&hqspi);
+
+	if (curSector < 0 || writeOffset + size > SECTOR_SIZE)
+		ret = rotate();
+
+	if (ret == PRESETS_OK && DISCO_QSPI_Write((uint8_t*) recordBuf, PRESETS_OFFSET + curSector * SECTOR_SIZE + writeOffset, size) != HAL_OK)
+		ret = PRESETS_ERROR;
+
+	DISCO_QSPI_EnableMemoryMappedMode();
+	SCB_InvalidateDCache_by_Addr((uint32_t*) sectorHeader(curSector < 0 ? 0 : curSector), SECTOR_SIZE);
+	assetsUnlock();
+
+	if (ret != PRESETS_OK || memcmp((const uint8_t*) sectorHeader(curSector) + writeOffset, recordBuf, size)) {
+		printf("presets: write error\n");
+		writeOffset = SECTOR_SIZE; // don't append after a bad record, rotate at the next save
+		return PRESETS_ERROR;
+	}
+
+	writeOffset += size;
+	lastRecordSeq = h->seq;
+	return PRESETS_OK;
+}
+
+/**
+ * Saves the settings the audio task is currently using.
+ */
+uint8_t presetsSaveCurrent(void) {
+
+	audio_settings_t s;
+
+	audioGetSettings(&s);
+	return presetsSave(&s);
+}
+
+/**
+ * Saves the current settings once they have changed and then stayed the same for PRESETS_SAVE_DELAY ms.
+ * Called periodically by the UI task, after audioApplyStreamSettings() so that the settings restored at boot
+ * are in use and not saved again. Blocks while saving (see presetsSave()).
+ */
+void presetsService(void) {
+
+	audio_settings_t s;
+
+	audioGetSettings(&s);
+
+	if (!savedValid) {
+		saved = changed = s;
+		savedValid = 1;
+		return;
+	}
+
+	if (memcmp(&s, &changed, sizeof(s))) {
+		changed = s;
+		changedAt = HAL_GetTick();
+	}
+
+	if (memcmp(&changed, &saved, sizeof(s)) && HAL_GetTick() - changedAt >= PRESETS_SAVE_DELAY) {
+		if (presetsSave(&changed) == PRESETS_OK)
+			printf("presets: saved record #%lu\n", lastRecordSeq);
+		saved = changed; // don't retry at each call after an error
+	}
+}
+
+/**
+ * Erases the next subsector and stamps it with the next sequence number. Memory-mapped mode must be off.
+ */
+static uint8_t rotate(void) {
+
+	int next = curSector < 0 ? 0 : (curSector + 1) % SECTOR_COUNT;
+	sector_header_t h = { SECTOR_MAGIC, curSector < 0 ? 1 : curSectorSeq + 1, 0, 0xFFFFFFFF };
+	h.seqInv = ~h.seq;
+
+	if (DISCO_QSPI_Erase_Block(PRESETS_OFFSET + next * SECTOR_SIZE) != HAL_OK
+			|| DISCO_QSPI_Write((uint8_t*) &h, PRESETS_OFFSET + next * SECTOR_SIZE, sizeof(h)) != HAL_OK)
+		return PRESETS_ERROR;
+
+	curSector = next;
+	curSectorSeq = h.seq;
+	writeOffset = sizeof(sector_header_t);
+	return PRESETS_OK;
+}
+
+static const sector_header_t* sectorHeader(int s) {
+
+	return (const sector_header_t*) (PRESETS_ADDR + s * SECTOR_SIZE);
+}
+
+static uint32_t recordCrc(const record_header_t *h, const void *payload) {
+
+	// the CRC unit is shared with assets.c and telemetry.c
+	return crcCompute2(h, 8, payload, h->len); // magic, len, seq, then the payload
+}
+
+/**
+ * Walks the records of subsector "s". Returns the last valid record (NULL if none) and, in endOffset, where the next
+ * record can be appended: right after the last valid record if what follows is erased, or SECTOR_SIZE (i.e. rotate
+ * at the next save) if what follows is a torn or corrupted record.
+ */
+static const record_header_t* walkSector(int s, uint32_t *endOffset) {
+
+	const uint8_t *base = (const uint8_t*) sectorHeader(s);
+	const record_header_t *last = NULL;
+	uint32_t offset = sizeof(sector_header_t);
+
+	while (offset + sizeof(record_header_t) <= SECTOR_SIZE) {
+
+		const record_header_t *r = (const record_header_t*) (base + offset);
+
+		if (r->magic == ERASED_16 && r->len == ERASED_16)
+			break;
+
+		if (r->magic != RECORD_MAGIC || offset + sizeof(record_header_t) + ALIGN4(r->len) > SECTOR_SIZE
+				|| recordCrc(r, r + 1) != r->crc) {
+			offset = SECTOR_SIZE;
+			break;
+		}
+
+		last = r;
+		offset += sizeof(record_header_t) + ALIGN4(r->len);
+	}
+
+	*endOffset = offset;
+	return last;
+}
@@ -0,0 +1,354 @@
+/*
+ * recorder.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === SD-card WAV recorder ===
+ *
+ * The audio task must never wait for the SD-card: a single sector write may stall for hundreds of milliseconds
+ * while the card is busy erasing or doing wear-levelling, which is way longer than an audio frame (5.3ms at 48kHz).
+ *
+ * Hence recording is split in two:
+ * - recorderPushBlock() is called by the audio task after each processed frame: it copies the frame into a large
+ *   ring buffer in SDRAM (see RECORDER_RING_ADDR in disco_base.h) and returns immediately. If the ring is full the
+ *   frame is dropped and counted as an overrun, but the audio task is never blocked.
+ * - a low-priority writer task (recorderTask) wakes up whenever a whole chunk is waiting in the ring and flushes it
+ *   with large multi-sector f_write() calls. A chunk is a whole number of clusters (at least REC_MIN_CHUNK_BYTES), and
+ *   writes always end on a chunk boundary in the file, so that FatFs transfers whole clusters straight from SDRAM
+ *   to the card through DMA (see sd_diskio.c) without going through its sector buffer.
+ *
+ * Files are pre-allocated with f_expand() (_USE_EXPAND in ffconf.h) for the requested maximum duration, so the writer
+ * never has to walk the FAT looking for free clusters while recording. The unused tail is given back with f_truncate()
+ * when the recording stops.
+ *
+ * The ring uses free-running byte counters: ringWr is only written by the audio task, ringRd only by the writer task,
+ * and the fill level is always (ringWr - ringRd), which keeps the ring lock-free.
+ *
+ * Usage (from any task but the audio one, e.g. the UI, see the record button in ui.c):
+ * 		recorderStart("rec0.wav", 48000, 600);	// at most 10 minutes
+ * 		...
+ * 		recorderStop();
+ *
+ * The write pattern is benchmarked on the host, with the same FatFs configuration on top of a disk image file,
+ * against pre-allocation-less and per-frame writes: see tools/recbench.c.
+ */
+
+#include <recorder.h>
+#include <stdio.h>
+#include "string.h"
+#include "fatfs.h"
+#include "cmsis_os.h"
+#include "bsp/disco_base.h"
+
+// ---------- writer task signals -------------
+
+#define REC_SIG_DATA		0x0001	// at least one chunk is waiting in the ring
+#define REC_SIG_START		0x0002	// a new file must be created
+#define REC_SIG_STOP		0x0004	// flush what's left in the ring and close the file
+#define REC_SIG_ALL			(REC_SIG_DATA | REC_SIG_START | REC_SIG_STOP)
+
+// smallest f_write() size: SD-cards reach their sequential write speed only with large multi-block writes
+#define REC_MIN_CHUNK_BYTES	((uint32_t)(32 * 1024))
+
+// canonical 44 bytes header padded with a JUNK chunk, so that audio data starts on a sector boundary
+#define WAV_HEADER_SIZE		512
+
+#define REC_RING_MASK		(RECORDER_RING_SIZE_BYTES - 1)
+#define REC_BYTES_PER_FRAME	(2 * sizeof(audio_sample_t))	// stereo, 16 bit (or 32 bit with AUDIO_SAMPLE_24IN32)
+
+typedef enum {
+	REC_IDLE = 0, REC_STARTING, REC_RUNNING, REC_STOPPING
+} recorder_state_t;
+
+// ----------- Local vars ------------
+
+static volatile recorder_state_t state = REC_IDLE;
+static volatile uint32_t ringWr = 0; // bytes pushed since the recording started (audio task only)
+static volatile uint32_t ringRd = 0; // bytes flushed to the file since the recording started (writer task only)
+static volatile uint32_t overruns = 0;
+static uint32_t chunkBytes = REC_MIN_CHUNK_BYTES;
+static uint32_t maxDataBytes;
+
+static char recPath[16];
+static uint32_t recSampleRate;
+static FIL recFile;
+static uint8_t writeError;
+static __ALIGN_BEGIN uint8_t wavHeader[WAV_HEADER_SIZE] __ALIGN_END;
+
+static osThreadId recorderTaskHandle;
+
+// ------------ Private Function Prototypes ------------
+
+static void recorderTask(void const *argument);
+static void openFile(void);
+static void flushRing(uint8_t all);
+static void closeFile(void);
+static void makeWavHeader(uint32_t sampleRate, uint32_t dataBytes);
+static uint32_t chunkSizeForVolume(void);
+
+// ----------- Functions ------------
+
+/**
+ * Creates the writer task. Must be called before the scheduler is started.
+ * The writer runs above the UI task (a spectrogram redraw must not delay a flush) but below the audio task.
+ */
+void recorderInit(void) {
+
+	osThreadDef(recorderTask, recorderTask, osPriorityBelowNormal, 0, 512);
+	recorderTaskHandle = osThreadCreate(osThread(recorderTask), NULL);
+}
+
+/**
+ * Asks the writer task to create a new WAV file at "path" (8.3 file name) and to start recording.
+ * The file is pre-allocated for "maxSeconds" of stereo audio at "sampleRate"; the recording
+ * stops by itself once this duration is reached. maxSeconds = 0 means no pre-allocation and no time limit.
+ */
+uint8_t recorderStart(const char *path, uint32_t sampleRate, uint32_t maxSeconds) {
+
+	if (state != REC_IDLE)
+		return RECORDER_BUSY;
+
+	strncpy(recPath, path, sizeof(recPath) - 1);
+	recPath[sizeof(recPath) - 1] = 0;
+	recSampleRate = sampleRate;
+
+	// FAT files are limited to 4GB:
+	if (maxSeconds == 0 || maxSeconds > (0xFFFFFFFFUL - WAV_HEADER_SIZE) / (sampleRate * REC_BYTES_PER_FRAME))
+		maxDataBytes = 0;
+	else
+		maxDataBytes = maxSeconds * sampleRate * REC_BYTES_PER_FRAME;
+
+	state = REC_STARTING;
+	osSignalSet(recorderTaskHandle, REC_SIG_START);
+	return RECORDER_OK;
+}
+
+/**
+ * Asks the writer task to flush the ring and close the file. Returns immediately.
+ */
+void recorderStop(void) {
+
+	if (state == REC_IDLE)
+		return;
+	osSignalSet(recorderTaskHandle, REC_SIG_STOP);
+}
+
+uint8_t recorderIsRecording(void) {
+
+	return state != REC_IDLE;
+}
+
+/**
+ * Number of audio blocks dropped because the ring was full since the last recorderStart()
+ */
+uint32_t recorderGetOverruns(void) {
+
+	return overruns;
+}
+
+/**
+ * Called by the audio task after each processed frame: copies "sampleCount" interleaved stereo samples into the SDRAM ring.
+ * Never blocks: if the writer task lags behind so much that the ring is full, the block is dropped.
+ */
+void recorderPushBlock(const audio_sample_t *buf, uint32_t sampleCount) {
+
+	if (state != REC_RUNNING)
+		return;
+
+	uint32_t len = sampleCount * sizeof(audio_sample_t);
+	uint32_t wr = ringWr;
+	uint32_t fill = wr - ringRd;
+
+	if (maxDataBytes && wr + len > maxDataBytes) { // pre-allocated file is full
+		state = REC_STOPPING;
+		osSignalSet(recorderTaskHandle, REC_SIG_STOP);
+		return;
+	}
+
+	if (fill + len > RECORDER_RING_SIZE_BYTES) {
+		overruns++;
+		return;
+	}
+
+	uint32_t offset = wr & REC_RING_MASK;
+	uint32_t first = RECORDER_RING_SIZE_BYTES - offset;
+	if (first > len)
+		first = len;
+	memcpy((uint8_t*) RECORDER_RING_ADDR + offset, buf, first);
+	memcpy((uint8_t*) RECORDER_RING_ADDR, (const uint8_t*) buf + first, len - first);
+
+	__DMB(); // samples must have reached SDRAM before the writer task sees the new index
+	ringWr = wr + len;
+
+	// wake the writer up only once per chunk (signals are latched, so a wakeup can't get lost):
+	if (fill < chunkBytes && fill + len >= chunkBytes)
+		osSignalSet(recorderTaskHandle, REC_SIG_DATA);
+}
+
+/**
+ * Writer task: creates the file, flushes whole chunks as they get ready, and finalizes the WAV header on stop.
+ * Note that the audio task has a higher priority, hence it is never preempted in the middle of recorderPushBlock() by this task.
+ */
+static void recorderTask(void const *argument) {
+
+	for (;;) {
+
+		osEvent evt = osSignalWait(REC_SIG_ALL, osWaitForever);
+		if (evt.status != osEventSignal)
+			continue;
+
+		if (evt.value.signals & REC_SIG_START)
+			openFile();
+
+		if ((evt.value.signals & REC_SIG_STOP) && state == REC_RUNNING)
+			state = REC_STOPPING;
+
+		if (state == REC_RUNNING)
+			flushRing(0);
+		else if (state == REC_STOPPING) {
+			flushRing(1);
+			closeFile();
+		}
+	}
+}
+
+/**
+ * Creates and pre-allocates the WAV file, then lets the audio task push blocks.
+ */
+static void openFile(void) {
+
+	if (state != REC_STARTING)
+		return;
+
+	if (FATFS_MountSD() != FR_OK || f_open(&recFile, recPath, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		printf("recorder: cannot create %s\n", recPath);
+		state = REC_IDLE;
+		return;
+	}
+
+	chunkBytes = chunkSizeForVolume();
+
+	// contiguous allocation: no FAT lookup while recording, and the card sees purely sequential writes
+	if (maxDataBytes && f_expand(&recFile, WAV_HEADER_SIZE + maxDataBytes, 1) != FR_OK)
+		printf("recorder: no contiguous room for %s, file will not be pre-allocated\n", recPath);
+
+	UINT bw;
+	makeWavHeader(recSampleRate, 0);
+	if (f_write(&recFile, wavHeader, WAV_HEADER_SIZE, &bw) != FR_OK || bw != WAV_HEADER_SIZE) {
+		printf("recorder: cannot write to %s\n", recPath);
+		f_close(&recFile);
+		state = REC_IDLE;
+		return;
+	}
+
+	writeError = 0;
+	overruns = 0;
+	ringRd = 0;
+	ringWr = 0;
+	__DMB();
+	state = REC_RUNNING;
+}
+
+/**
+ * Writes the ring content to the file, in chunks that end on a chunk boundary in the file.
+ * If "all" is 0, a trailing partial chunk stays in the ring until more data gets in.
+ */
+static void flushRing(uint8_t all) {
+
+	while (!writeError) {
+
+		uint32_t avail = ringWr - ringRd;
+		uint32_t filePos = WAV_HEADER_SIZE + ringRd;
+		uint32_t len = chunkBytes - (filePos % chunkBytes);
+
+		if (avail < len) {
+			if (!all || avail == 0)
+				return;
+			len = avail;
+		}
+
+		uint32_t offset = ringRd & REC_RING_MASK;
+		if (len > RECORDER_RING_SIZE_BYTES - offset)
+			len = RECORDER_RING_SIZE_BYTES - offset;
+
+		UINT bw;
+		if (f_write(&recFile, (uint8_t*) RECORDER_RING_ADDR + offset, len, &bw) != FR_OK || bw != len) {
+			printf("recorder: write error on %s\n", recPath);
+			writeError = 1;
+			state = REC_STOPPING;
+			return;
+		}
+		ringRd += len;
+	}
+}
+
+/**
+ * Gives back the unused pre-allocated clusters, patches the WAV header with the final sizes and closes the file.
+ */
+static void closeFile(void) {
+
+	UINT bw;
+	uint32_t dataBytes = ringRd;
+
+	f_truncate(&recFile);
+	makeWavHeader(recSampleRate, dataBytes);
+	if (f_lseek(&recFile, 0) != FR_OK || f_write(&recFile, wavHeader, WAV_HEADER_SIZE, &bw) != FR_OK)
+		printf("recorder: cannot update header of %s\n", recPath);
+	f_close(&recFile);
+
+	printf("recorder: %lu bytes written to %s, %lu overruns\n", dataBytes, recPath, overruns);
+	state = REC_IDLE;
+}
+
+/**
+ * Largest of REC_MIN_CHUNK_BYTES and the cluster size (both are powers of two, hence the chunk divides the ring size).
+ */
+static uint32_t chunkSizeForVolume(void) {
+
+	uint32_t chunk = (uint32_t) SDFatFS.csize * _MIN_SS;
+	while (chunk < REC_MIN_CHUNK_BYTES)
+		chunk <<= 1;
+	return chunk;
+}
+
+static void setLE16(uint8_t *p, uint16_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void setLE32(uint8_t *p, uint32_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/**
+ * RIFF header for stereo PCM, 16 bit (or 32 bit with AUDIO_SAMPLE_24IN32):
+ * "RIFF" chunk (12 bytes) + "fmt " chunk (24 bytes) + "JUNK" padding chunk + "data" chunk header ending at WAV_HEADER_SIZE
+ */
+static void makeWavHeader(uint32_t sampleRate, uint32_t dataBytes) {
+
+	uint8_t *h = wavHeader;
+
+	memset(h, 0, WAV_HEADER_SIZE);
+	memcpy(h, "RIFF", 4);
+	setLE32(h + 4, WAV_HEADER_SIZE - 8 + dataBytes);
+	memcpy(h + 8, "WAVE", 4);
+
+	memcpy(h + 12, "fmt ", 4);
+	setLE32(h + 16, 16);
+	setLE16(h + 20, 1); // PCM
+	setLE16(h + 22, 2); // stereo
+	setLE32(h + 24, sampleRate);
+	setLE32(h + 28, sampleRate * REC_BYTES_PER_FRAME);
+	setLE16(h + 32, REC_BYTES_PER_FRAME);
+	setLE16(h + 34, 8 * sizeof(audio_sample_t));
+
+	memcpy(h + 36, "JUNK", 4);
+	setLE32(h + 40, WAV_HEADER_SIZE - 8 - 44);
+
+	memcpy(h + WAV_HEADER_SIZE - 8, "data", 4);
+	setLE32(h + WAV_HEADER_SIZE - 4, dataBytes);
+}
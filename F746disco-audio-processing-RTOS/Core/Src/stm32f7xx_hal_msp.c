@@ -32,6 +32,8 @@ extern DMA_HandleTypeDef hdma_dcmi;
 /* USER CODE BEGIN TD */
 extern DMA_HandleTypeDef hdma_memtomem_dma2_stream0;
 extern SDRAM_HandleTypeDef hsdram1;
+extern DMA_HandleTypeDef hdma_sdmmc1;
+extern DMA_HandleTypeDef hdma_usart6_tx;
 
 /* USER CODE END TD */
 
@@ -621,6 +623,10 @@ void HAL_LTDC_MspInit(LTDC_HandleTypeDef* hltdc)
 
   /* USER CODE BEGIN LTDC_MspInit 1 */
 
+    /* LTDC interrupt Init: reload at vertical blanking, see LCD_SwapBuffers() */
+    HAL_NVIC_SetPriority(LTDC_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(LTDC_IRQn);
+
   /* USER CODE END LTDC_MspInit 1 */
   }
 
@@ -688,6 +694,8 @@ void HAL_LTDC_MspDeInit(LTDC_HandleTypeDef* hltdc)
 
   /* USER CODE BEGIN LTDC_MspDeInit 1 */
 
+    HAL_NVIC_DisableIRQ(LTDC_IRQn);
+
   /* USER CODE END LTDC_MspDeInit 1 */
   }
 
@@ -886,6 +894,36 @@ void HAL_SD_MspInit(SD_HandleTypeDef* hsd)
 
   /* USER CODE BEGIN SDMMC1_MspInit 1 */
 
+    // DMA stream used by sd_diskio.c (BSP_SD_ReadBlocks_DMA / BSP_SD_WriteBlocks_DMA): DMA2 Stream3, channel 4, for both
+    // directions (HAL_SD_ReadBlocks_DMA() and HAL_SD_WriteBlocks_DMA() set the direction before each transfer, and FatFs
+    // never runs two transfers at once, see _FS_REENTRANT), so that DMA2 Stream6 is free for USART6 TX (see telemetry.c)
+    hdma_sdmmc1.Instance = DMA2_Stream3;
+    hdma_sdmmc1.Init.Channel = DMA_CHANNEL_4;
+    hdma_sdmmc1.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_sdmmc1.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_sdmmc1.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_sdmmc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma_sdmmc1.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma_sdmmc1.Init.Mode = DMA_PFCTRL;
+    hdma_sdmmc1.Init.Priority = DMA_PRIORITY_MEDIUM; // below SAI audio streams
+    hdma_sdmmc1.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+    hdma_sdmmc1.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    hdma_sdmmc1.Init.MemBurst = DMA_MBURST_INC4;
+    hdma_sdmmc1.Init.PeriphBurst = DMA_PBURST_INC4;
+    if (HAL_DMA_Init(&hdma_sdmmc1) != HAL_OK)
+    {
+      Error_Handler();
+    }
+    __HAL_LINKDMA(hsd,hdmarx,hdma_sdmmc1);
+    __HAL_LINKDMA(hsd,hdmatx,hdma_sdmmc1);
+
+    // SD interrupts have a lower priority (=higher number) than the SAI DMA ones,
+    // but must stay >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY as sd_diskio.c posts to SDQueueID from them.
+    HAL_NVIC_SetPriority(SDMMC1_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(SDMMC1_IRQn);
+    HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+
   /* USER CODE END SDMMC1_MspInit 1 */
   }
 
@@ -922,6 +960,10 @@ void HAL_SD_MspDeInit(SD_HandleTypeDef* hsd)
 
   /* USER CODE BEGIN SDMMC1_MspDeInit 1 */
 
+    HAL_DMA_DeInit(hsd->hdmarx);
+    HAL_DMA_DeInit(hsd->hdmatx);
+    HAL_NVIC_DisableIRQ(SDMMC1_IRQn);
+
   /* USER CODE END SDMMC1_MspDeInit 1 */
   }
 
@@ -1314,6 +1356,10 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
 
   /* USER CODE BEGIN USART1_MspInit 1 */
 
+    // TX interrupt, see logger.c (must not be above configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY)
+    HAL_NVIC_SetPriority(USART1_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(USART1_IRQn);
+
   /* USER CODE END USART1_MspInit 1 */
   }
   else if(huart->Instance==USART6)
@@ -1338,6 +1384,28 @@ void HAL_UART_MspInit(UART_HandleTypeDef* huart)
 
   /* USER CODE BEGIN USART6_MspInit 1 */
 
+    // telemetry (see telemetry.c): USART6_TX => DMA2 Stream6, channel 5
+    hdma_usart6_tx.Instance = DMA2_Stream6;
+    hdma_usart6_tx.Init.Channel = DMA_CHANNEL_5;
+    hdma_usart6_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart6_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart6_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart6_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart6_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart6_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart6_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart6_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_usart6_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+    __HAL_LINKDMA(huart,hdmatx,hdma_usart6_tx);
+
+    HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+    HAL_NVIC_SetPriority(USART6_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(USART6_IRQn);
+
   /* USER CODE END USART6_MspInit 1 */
   }
 
@@ -1387,6 +1455,9 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* huart)
 
   /* USER CODE BEGIN USART6_MspDeInit 1 */
 
+    HAL_DMA_DeInit(huart->hdmatx);
+    HAL_NVIC_DisableIRQ(USART6_IRQn);
+
   /* USER CODE END USART6_MspDeInit 1 */
   }
 
@@ -1650,8 +1721,8 @@ void HAL_SAI_MspInit(SAI_HandleTypeDef* hsai)
     hdma_sai2_a.Init.Direction = DMA_MEMORY_TO_PERIPH;
     hdma_sai2_a.Init.PeriphInc = DMA_PINC_DISABLE;
     hdma_sai2_a.Init.MemInc = DMA_MINC_ENABLE;
-    hdma_sai2_a.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
-    hdma_sai2_a.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma_sai2_a.Init.PeriphDataAlignment = AUDIO_DMA_PDATAALIGN; // see AUDIO_SAMPLE_24IN32 in disco_sai.h
+    hdma_sai2_a.Init.MemDataAlignment = AUDIO_DMA_MDATAALIGN;
     hdma_sai2_a.Init.Mode = DMA_CIRCULAR;
     hdma_sai2_a.Init.Priority = DMA_PRIORITY_HIGH;
     hdma_sai2_a.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
@@ -1696,8 +1767,8 @@ void HAL_SAI_MspInit(SAI_HandleTypeDef* hsai)
     hdma_sai2_b.Init.Direction = DMA_PERIPH_TO_MEMORY;
     hdma_sai2_b.Init.PeriphInc = DMA_PINC_DISABLE;
     hdma_sai2_b.Init.MemInc = DMA_MINC_ENABLE;
-    hdma_sai2_b.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
-    hdma_sai2_b.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma_sai2_b.Init.PeriphDataAlignment = AUDIO_DMA_PDATAALIGN; // see AUDIO_SAMPLE_24IN32 in disco_sai.h
+    hdma_sai2_b.Init.MemDataAlignment = AUDIO_DMA_MDATAALIGN;
     hdma_sai2_b.Init.Mode = DMA_CIRCULAR;
     hdma_sai2_b.Init.Priority = DMA_PRIORITY_HIGH;
     hdma_sai2_b.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
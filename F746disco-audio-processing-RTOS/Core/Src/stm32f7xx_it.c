@@ -61,12 +61,18 @@ extern DMA_HandleTypeDef hdma_dcmi;
 extern DCMI_HandleTypeDef hdcmi;
 extern DMA_HandleTypeDef hdma_memtomem_dma2_stream0;
 extern DMA2D_HandleTypeDef hdma2d;
+extern LTDC_HandleTypeDef hltdc;
 extern QSPI_HandleTypeDef hqspi;
 extern DMA_HandleTypeDef hdma_sai2_a;
 extern DMA_HandleTypeDef hdma_sai2_b;
 extern TIM_HandleTypeDef htim6;
+extern SD_HandleTypeDef hsd1;
+extern DMA_HandleTypeDef hdma_sdmmc1;
+extern DMA_HandleTypeDef hdma_usart6_tx;
 
 /* USER CODE BEGIN EV */
+extern UART_HandleTypeDef huart1;
+extern UART_HandleTypeDef huart6;
 
 /* USER CODE END EV */
 
@@ -322,5 +328,53 @@ void QUADSPI_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles LTDC global interrupt (reload at vertical blanking, see LCD_SwapBuffers()).
+  */
+void LTDC_IRQHandler(void)
+{
+  HAL_LTDC_IRQHandler(&hltdc);
+}
+
+/**
+  * @brief This function handles SDMMC1 global interrupt.
+  */
+void SDMMC1_IRQHandler(void)
+{
+  HAL_SD_IRQHandler(&hsd1);
+}
+
+/**
+  * @brief This function handles DMA2 stream3 global interrupt (SDMMC1 RX and TX).
+  */
+void DMA2_Stream3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_sdmmc1);
+}
+
+/**
+  * @brief This function handles DMA2 stream6 global interrupt (USART6 TX, see telemetry.c).
+  */
+void DMA2_Stream6_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart6_tx);
+}
+
+/**
+  * @brief This function handles USART1 global interrupt (VCP TX, see logger.c).
+  */
+void USART1_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(&huart1);
+}
+
+/**
+  * @brief This function handles USART6 global interrupt (telemetry TX, see telemetry.c).
+  */
+void USART6_IRQHandler(void)
+{
+  HAL_UART_IRQHandler(&huart6);
+}
+
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
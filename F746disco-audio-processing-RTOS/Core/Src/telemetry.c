@@ -0,0 +1,222 @@
+/*
+ * telemetry.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Binary telemetry on USART6 ===
+ *
+ * At a configurable rate (see telemetrySetRate(), TELEMETRY_DEFAULT_HZ by default), the telemetry task sends
+ * three frames on USART6 (TX on Arduino D1, 8N1 at TELEMETRY_BAUD): the input level meters, the spectrum of the
+ * last output frame reduced to TELEMETRY_SPECTRUM_BINS bins, and the frame timing and xrun counters of the audio task.
+ * See telemetry.h for the layouts. Each frame is
+ *
+ * 		COBS(payload | CRC) 0x00
+ *
+ * - the CRC is computed over the payload by the CRC unit through crcCompute() (see crc.c; CRC-32/MPEG-2: polynomial
+ *   0x04C11DB7, initial value 0xFFFFFFFF, no reflection, no final XOR), and appended little-endian,
+ * - COBS (Consistent Overhead Byte Stuffing) removes every 0x00 from the frame at the cost of one byte per 254,
+ *   so that 0x00 delimits frames: a receiver resynchronizes at the next 0x00 after a lost or corrupted byte.
+ *
+ * Each frame is sent with a single DMA transfer (DMA2 stream 6), while the next one is being prepared: sending costs
+ * the CPU nothing but the encoding. At the default rate, the three frames above take about 12kbytes/s, i.e. 6% of the link.
+ * Other modules send their own frames on the same link with telemetrySend() (e.g. the audio monitor, see monitor.c).
+ * Decode with tools/tlmrecv.c.
+ */
+
+#include <telemetry.h>
+#include <audio.h>
+#include <crc.h>
+#include "string.h"
+#include "main.h"
+#include "cmsis_os.h"
+
+extern UART_HandleTypeDef huart6; // see main.c
+
+extern double inputLevelL_cp; // see audio.c
+extern double inputLevelR_cp;
+extern float aFFT_Input_f32[];
+
+#define TELEMETRY_DEFAULT_HZ	50
+#define FFT_BINS				128		// FFT_Length / 2, magnitudes in aFFT_Input_f32 (see calculateFFT() in audio.c)
+#define COBS_MAX(n)				((n) + (n) / 254 + 1)	// encoded length of n bytes, delimiter excluded
+#define TX_BUF_SIZE				(COBS_MAX(TELEMETRY_MAX_FRAME + 4) + 1)
+#define TX_TIMEOUT_MS			50		// a whole TX_BUF_SIZE takes under 2ms at TELEMETRY_BAUD
+
+// ----------- Local vars ------------
+
+// the DMA only reads it, and the SRAM is write-through: no need for the non-cacheable region (see mpu.h)
+static uint8_t txBuf[TX_BUF_SIZE] __attribute__((aligned(4)));
+static uint8_t frameBuf[TELEMETRY_MAX_FRAME + 4]; // payload + CRC, before encoding
+static uint16_t seq = 0;
+static volatile uint32_t periodMs = 1000 / TELEMETRY_DEFAULT_HZ;
+static volatile uint32_t dropped = 0;
+
+static osThreadId telemetryTaskHandle;
+static osMutexId txMutex;			// serializes the senders
+static osSemaphoreId txIdle;		// given back by the TX complete callback
+
+// ------------ Private Function Prototypes ------------
+
+static void telemetryTask(void const *argument);
+static uint32_t cobsEncode(const uint8_t *in, uint32_t len, uint8_t *out);
+
+// ----------- Functions ------------
+
+/**
+ * Switches USART6 to TELEMETRY_BAUD and creates the telemetry task. Must be called before the scheduler is started.
+ */
+void telemetryInit(void) {
+
+	huart6.Init.BaudRate = TELEMETRY_BAUD;
+	if (HAL_UART_Init(&huart6) != HAL_OK)
+		return;
+
+	osMutexDef(telemetryTx);
+	txMutex = osMutexCreate(osMutex(telemetryTx));
+	osSemaphoreDef(telemetryIdle);
+	txIdle = osSemaphoreCreate(osSemaphore(telemetryIdle), 1);
+
+	osThreadDef(telemetry, telemetryTask, osPriorityLow, 0, 256);
+	telemetryTaskHandle = osThreadCreate(osThread(telemetry), NULL);
+}
+
+/**
+ * Sets the number of frame triplets sent per second (1 to 1000).
+ */
+void telemetrySetRate(uint32_t hz) {
+
+	if (hz < 1)
+		hz = 1;
+	if (hz > 1000)
+		hz = 1000;
+	periodMs = 1000 / hz;
+}
+
+/**
+ * Number of frames dropped since boot because the link was not initialized or stayed busy for more than TX_TIMEOUT_MS.
+ */
+uint32_t telemetryGetDropped(void) {
+
+	return dropped;
+}
+
+/**
+ * Fills the header of "frame" in ("len" bytes, starting with a tlm_header_t), appends the CRC, encodes it and starts
+ * sending it. Blocks while the previous frame is being sent (at most TX_TIMEOUT_MS), then returns as soon as the
+ * transfer has started: "frame" can be reused right away. Task context only.
+ */
+uint8_t telemetrySend(void *frame, uint32_t len, uint8_t type) {
+
+	tlm_header_t *h = (tlm_header_t*) frame;
+	uint32_t crc, n;
+
+	if (txMutex == NULL || len < sizeof(tlm_header_t) || len > TELEMETRY_MAX_FRAME) {
+		dropped++;
+		return TELEMETRY_ERROR;
+	}
+
+	osMutexWait(txMutex, osWaitForever);
+	if (osSemaphoreWait(txIdle, TX_TIMEOUT_MS) != osOK) {
+		osMutexRelease(txMutex);
+		dropped++;
+		return TELEMETRY_BUSY;
+	}
+
+	h->type = type;
+	h->version = TELEMETRY_VERSION;
+	h->seq = seq++;
+	h->tick = HAL_GetTick();
+
+	// the CRC unit is shared with assets.c and presets.c
+	crc = crcCompute(frame, len);
+
+	memcpy(frameBuf, frame, len);
+	memcpy(frameBuf + len, &crc, 4);
+	n = cobsEncode(frameBuf, len + 4, txBuf);
+	txBuf[n++] = 0x00;
+
+	if (HAL_UART_Transmit_DMA(&huart6, txBuf, n) != HAL_OK) {
+		osSemaphoreRelease(txIdle);
+		dropped++;
+		osMutexRelease(txMutex);
+		return TELEMETRY_ERROR;
+	}
+
+	osMutexRelease(txMutex);
+	return TELEMETRY_OK;
+}
+
+static void telemetryTask(void const *argument) {
+
+	static tlm_meters_t meters;
+	static tlm_spectrum_t spectrum;
+	static tlm_timing_t timing;
+	audio_stats_t stats;
+
+	for (;;) {
+
+		osDelay(periodMs); // the encoding takes well under a tick, no need for a fixed-rate wake-up
+
+		meters.levelL = (float) inputLevelL_cp;
+		meters.levelR = (float) inputLevelR_cp;
+		telemetrySend(&meters, sizeof(meters), TLM_METERS);
+
+		spectrum.sampleRate = audioGetSampleRate();
+		for (int b = 0; b < TELEMETRY_SPECTRUM_BINS; b++) {
+			float m = 0.0f;
+			for (int k = b * (FFT_BINS / TELEMETRY_SPECTRUM_BINS); k < (b + 1) * (FFT_BINS / TELEMETRY_SPECTRUM_BINS); k++)
+				if (aFFT_Input_f32[k] > m)
+					m = aFFT_Input_f32[k];
+			spectrum.bins[b] = m;
+		}
+		telemetrySend(&spectrum, sizeof(spectrum), TLM_SPECTRUM);
+
+		audioGetStats(&stats);
+		timing.cpuHz = SystemCoreClock;
+		timing.frameCycles = stats.frameCycles;
+		timing.frameCyclesMax = stats.frameCyclesMax;
+		timing.periodCycles = stats.periodCycles;
+		timing.wakeCyclesMax = stats.wakeCyclesMax;
+		timing.lateFrames = stats.lateFrames;
+		timing.marginWarnings = stats.marginWarnings;
+		timing.slips = stats.slips;
+		timing.missedWakeups = stats.missedWakeups;
+		telemetrySend(&timing, sizeof(timing), TLM_TIMING);
+	}
+}
+
+/**
+ * COBS-encodes "len" bytes into "out" (at most COBS_MAX(len) bytes, no delimiter). Returns the encoded length.
+ */
+static uint32_t cobsEncode(const uint8_t *in, uint32_t len, uint8_t *out) {
+
+	uint32_t code = 0, o = 1;
+
+	out[0] = 1;
+	for (uint32_t i = 0; i < len; i++) {
+		if (in[i] == 0x00) {
+			out[code] = (uint8_t) (o - code);
+			code = o++;
+			out[code] = 1;
+		}
+		else {
+			out[o++] = in[i];
+			if (o - code == 0xFF) {
+				out[code] = 0xFF;
+				code = o++;
+				out[code] = 1;
+			}
+		}
+	}
+	out[code] = (uint8_t) (o - code);
+	return o;
+}
+
+/**
+ * USART6 TX complete (called from HAL_UART_TxCpltCallback() in logger.c): txBuf can be reused.
+ */
+void telemetryTxDone(void) {
+
+	osSemaphoreRelease(txIdle);
+}
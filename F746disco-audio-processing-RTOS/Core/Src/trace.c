@@ -0,0 +1,126 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ *
+ * === Event trace ===
+ *
+ * To find out what ran when around an xrun, trace points write 8-byte records (trace_record_t: DWT timestamp, type, id,
+ * argument) into a ring of TRACE_LEN records in SDRAM (see TRACE_BUF_ADDR in disco_base.h):
+ * - context switches, from the FreeRTOS traceTASK_SWITCHED_IN/OUT hooks (see FreeRTOSConfig.h),
+ * - the SAI RX DMA callbacks,
+ * - the beginning and end of each processing stage of the audio task (frame, effects, FFT),
+ * - marks, e.g. a late frame.
+ *
+ * traceRecord() may be called from any task or interrupt, and never blocks: a slot is claimed by incrementing the write
+ * index with LDREX/STREX, and the timestamp is read inside the same exclusive section. Since an exception clears the
+ * exclusive monitor, a successful claim cannot have been preempted after the timestamp was read, hence the records are
+ * in chronological order in the ring. The cost is a few tens of cycles per record.
+ *
+ * Recording stops TRACE_POST_TRIGGER records after traceTrigger() (called by the audio task at the first late frame),
+ * so that the ring holds what happened before and after. traceService(), called periodically by the UI task, then dumps
+ * the ring on the VCP and restarts recording; pressing the blue user button dumps it at any time. The dump is text:
+ *
+ * 		TRACE BEGIN <cpu clock in Hz> <record count>
+ * 		TASK <task number> <task name>		(one per task)
+ * 		R <cycles> <type> <id> <arg>		(one per record, oldest first, in hex)
+ * 		TRACE END
+ *
+ * so that it can be captured along with the rest of the VCP output and converted with tools/trace2json.c.
+ * At 115200 bauds a full ring takes about 8s, during which the UI task does nothing else.
+ */
+
+#include <trace.h>
+#include <cpuload.h>
+#include <stdio.h>
+#include "bsp/disco_base.h"
+#include "bsp/dwt.h"
+
+#define TRACE_LEN			(TRACE_BUF_SIZE_BYTES / sizeof(trace_record_t))
+#define TRACE_POST_TRIGGER	(TRACE_LEN / 4)	// records kept after the trigger
+
+// ----------- Local vars ------------
+
+static trace_record_t *const ring = (trace_record_t*) TRACE_BUF_ADDR;
+
+static volatile uint32_t head = 0;		// records written since recording (re)started
+static volatile uint32_t stopAt = 0;	// head at which recording stops, 0 if not triggered
+static volatile uint8_t recording = 1;
+
+// ----------- Functions ------------
+
+/**
+ * Appends a record to the ring, unless recording is stopped. May be called from any task or interrupt.
+ */
+void traceRecord(uint8_t type, uint8_t id, uint16_t arg) {
+
+	uint32_t i, t;
+
+	if (!recording)
+		return;
+
+	do {
+		i = __LDREXW(&head);
+		t = DWT_CYCLES();
+	} while (__STREXW(i + 1, &head));
+
+	trace_record_t *r = &ring[i & (TRACE_LEN - 1)];
+	r->cycles = t;
+	r->type = type;
+	r->id = id;
+	r->arg = arg;
+
+	if (i + 1 == stopAt)
+		recording = 0;
+}
+
+/**
+ * Stops recording TRACE_POST_TRIGGER records from now on (the first trigger wins, until the ring has been dumped).
+ */
+void traceTrigger(void) {
+
+	if (recording && stopAt == 0)
+		stopAt = (head + TRACE_POST_TRIGGER) | 1; // never 0
+}
+
+/**
+ * Dumps the ring once recording has stopped after a trigger, or when the user button is pressed, then restarts recording.
+ * Called periodically by the UI task.
+ */
+void traceService(void) {
+
+	static uint32_t lastButton = 0;
+	uint32_t button = PB_GetState();
+
+	if ((!recording && stopAt) || (button && !lastButton)) {
+		traceDump();
+		stopAt = 0;
+		head = 0;
+		recording = 1;
+	}
+	lastButton = button;
+}
+
+/**
+ * Stops recording and prints the ring on the VCP, oldest record first (see the format above). Blocks for seconds.
+ */
+void traceDump(void) {
+
+	static cpuload_snapshot_t s; // too large for the caller's stack
+
+	recording = 0;
+
+	uint32_t n = head < TRACE_LEN ? head : TRACE_LEN;
+	uint32_t first = head - n;
+
+	cpuLoadGet(&s);
+	printf("TRACE BEGIN %lu %lu\n", SystemCoreClock, n);
+	for (uint32_t i = 0; i < s.count; i++)
+		printf("TASK %u %s\n", s.tasks[i].number, s.tasks[i].name);
+	for (uint32_t i = first; i < first + n; i++) {
+		trace_record_t *r = &ring[i & (TRACE_LEN - 1)];
+		printf("R %08lx %02x %02x %04x\n", r->cycles, r->type, r->id, r->arg);
+	}
+	printf("TRACE END\n");
+}
@@ -6,30 +6,96 @@
  *
  *
  *      LCD and touchscreen management for project User Interface.
+ *      Drawing goes through draw commands rendered by the display task, see display.c.
  */
 
 #include <ui.h>
+#include <display.h>
+#include <audio.h>
+#include <latency.h>
+#include <recorder.h>
+#include <player.h>
+#include <cpuload.h>
+#include <assets.h>
+#include <images.h>
 #include <math.h>
 #include <stdio.h>
+#include "cmsis_os.h"
+#include "bsp/disco_ts.h"
+
+// buttons, touch to cycle through the inputs (line in / microphones / WAV file) or toggle the sampling rate (16kHz / 48kHz),
+// or to measure the round-trip latency (loopback cable required, see latency.c):
+#define INPUT_BUTTON_X		260
+#define RATE_BUTTON_X		370
+#define BUTTON_Y			28
+#define LATENCY_BUTTON_X	370
+#define LATENCY_BUTTON_Y	226
+#define REC_BUTTON_X		260 // below the input button, on the right of the latency results
+#define REC_BUTTON_Y		226
+#define BUTTON_W			100
+#define BUTTON_H			36
+
+#define LATENCY_TEXT_Y		226 // below the spectrogram
+#define CPU_TEXT_Y			211 // between the spectrogram and the latency results
+
+#define METER_X				150 // input level bars, between the dB values and the buttons
+#define METER_W				100
+#define METER_H				10
+#define METER_FLOOR_DB		60  // bottom of the bars, i.e. -60dB
+
+#define TOUCH_POLL_PERIOD	50 // ms
+#define REC_MAX_SECONDS		600 // size of the pre-allocated recording files, see recorder.c
+#define PLAYER_FILE			"play.wav" // played in a loop instead of the CODEC input, see player.c
+#define SKIN_WAIT_MS		1000 // longest wait for the JPEG skin to be decoded, see images.c
+
+static uint8_t inButton(uint16_t x, uint16_t y, uint16_t buttonX, uint16_t buttonY);
+static void displayRecorder(uint8_t recording);
+
+static uint8_t fileInput = 0; // PLAYER_FILE selected with the input button
+static void displayLevel(uint16_t y, double level);
+static uint8_t getImage(const char *name, LCD_ImageTypeDef *image);
 
 /**
  * Display basic UI information.
  */
 void uiDisplayBasic(void) {
 
-	LCD_Clear(LCD_COLOR_WHITE);
+	static LCD_ImageTypeDef background;
+	uint8_t skin = getImage("background", &background);
+
+	// else a JPEG skin (QSPI asset or skins/background.jpg on the SD card), decoded once into SDRAM, see images.c
+	for (uint32_t t = 0; !skin && t < SKIN_WAIT_MS; t += 10) {
+		uint8_t ret = imagesGet("background", &background);
+		if (ret == IMAGES_OK)
+			skin = 1;
+		else if (ret == IMAGES_ERROR)
+			break;
+		else
+			osDelay(10);
+	}
+
+	// optional full-screen skin, drawn by a single DMA2D transfer (see LCD_DrawImage())
+	if (skin)
+		displayImage(0, 0, &background, 0);
+	else
+		displayRect(0, 0, LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT, LCD_COLOR_WHITE, 0);
 
 	//LCD_SetTextColor(LCD_COLOR_BLUE);
 	//LCD_FillRect(0, 0, LCD_GetXSize(), 90);
 
-	LCD_SetStrokeColor(LCD_COLOR_BLACK);
-	LCD_SetBackColor(LCD_COLOR_WHITE);
-	LCD_SetFont(&Font24);
-	LCD_DrawString(0, 0, (uint8_t*) "SIA 2021 - RT AUDIO FX", CENTER_MODE, true);
+	displayText(0, 0, "SIA 2021 - RT AUDIO FX", &Font24, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE | DISPLAY_CENTER);
+
+	displayText(10, 30, "Input L =", &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+	displayText(10, 50, "Input R =", &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
 
-	LCD_SetFont(&Font12);
-	LCD_DrawString(10, 30, (uint8_t*) "Input L =", LEFT_MODE, true);
-	LCD_DrawString(10, 50, (uint8_t*) "Input R =", LEFT_MODE, true);
+	displayRect(INPUT_BUTTON_X, BUTTON_Y, BUTTON_W, BUTTON_H, LCD_COLOR_BLACK, DISPLAY_OUTLINE);
+	uiDisplayInput(audioGetInput());
+	displayRect(RATE_BUTTON_X, BUTTON_Y, BUTTON_W, BUTTON_H, LCD_COLOR_BLACK, DISPLAY_OUTLINE);
+	uiDisplayRate(audioGetSampleRate());
+	displayRect(LATENCY_BUTTON_X, LATENCY_BUTTON_Y, BUTTON_W, BUTTON_H, LCD_COLOR_BLACK, DISPLAY_OUTLINE);
+	displayText(LATENCY_BUTTON_X + 22, LATENCY_BUTTON_Y + 12, "Latency", &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+	displayRect(REC_BUTTON_X, REC_BUTTON_Y, BUTTON_W, BUTTON_H, LCD_COLOR_BLACK, DISPLAY_OUTLINE);
+	displayRecorder(recorderIsRecording());
 
 	/* Set the LCD Text Color */
 	//LCD_SetTextColor(LCD_COLOR_BLUE);
@@ -39,34 +105,225 @@ void uiDisplayBasic(void) {
 
 
 /**
- * Displays line or microphones input level on the LCD.
+ * Displays line or microphones input level on the LCD, as a value in dB and a bar.
  */
 void uiDisplayInputLevel(double inputLevelL, double inputLevelR) {
 
-	uint8_t buf[50];
-
-	LCD_SetStrokeColor(LCD_COLOR_BLACK);
-	LCD_SetBackColor(LCD_COLOR_WHITE);
-	LCD_SetFont(&Font12);
-
 	/*sprintf((char *)buf, "%d     ", (int)(inputLevelL));
 	 LCD_DisplayStringAt(90, 30, (uint8_t *)buf, LEFT_MODE);
 
 	 sprintf((char *)buf, "%d     ", (int)(inputLevelR));
 	 LCD_DisplayStringAt(90, 50, (uint8_t *)buf, LEFT_MODE);*/
 
-	if (inputLevelL > 0) {
-		int lvl_db = (int) (20. * log10(inputLevelL));
-		sprintf((char*) buf, "%d dB   ", lvl_db);
-		LCD_DrawString(90, 30, (uint8_t*) buf, LEFT_MODE, true);
-	} else
-		LCD_DrawString(90, 30, (uint8_t*) "-inf dB", LEFT_MODE, true);
+	displayLevel(30, inputLevelL);
+	displayLevel(50, inputLevelR);
+}
+
+/**
+ * Displays the sampling rate inside the rate button.
+ */
+void uiDisplayRate(uint32_t rate) {
+
+	char buf[20];
+
+	sprintf(buf, "%2lu kHz", rate / 1000);
+	displayText(RATE_BUTTON_X + 25, BUTTON_Y + 12, buf, &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+}
+
+/**
+ * Displays the current input inside the input button: the CODEC input device, or the WAV file being played.
+ */
+void uiDisplayInput(uint16_t device) {
+
+	const char *label = fileInput ? "File   " : device == INPUT_DEVICE_INPUT_LINE_1 ? "Line in" : "Mics   ";
+
+	displayText(INPUT_BUTTON_X + 15, BUTTON_Y + 12, label, &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+}
+
+/**
+ * Displays one line of latency measurement results (row 0 or 1) next to the latency button.
+ */
+void uiDisplayLatency(int row, const char *text) {
+
+	displayText(10, LATENCY_TEXT_Y + 4 + row * 16, text, &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+}
+
+/**
+ * Displays the CPU load of each task on one line below the spectrogram, whenever the monitor task has taken a new sample.
+ * The idle task load is the headroom left.
+ */
+void uiDisplayCpuLoad(void) {
+
+	static uint32_t lastSeq = 0;
+	static cpuload_snapshot_t s; // too large for the UI task stack
+	char buf[68];
+	int len;
+
+	cpuLoadGet(&s);
+	if (s.seq == lastSeq)
+		return;
+	lastSeq = s.seq;
+
+	len = snprintf(buf, sizeof(buf), "CPU");
+	for (uint32_t i = 0; i < s.count && len < sizeof(buf) - 1; i++)
+		len += snprintf(buf + len, sizeof(buf) - len, " %.5s %u%%", s.tasks[i].name, (s.tasks[i].permil + 5) / 10);
+	while (len < sizeof(buf) - 1)
+		buf[len++] = ' '; // erase the end of the previous line
+	buf[sizeof(buf) - 1] = 0;
+
+	displayText(10, CPU_TEXT_Y, buf, &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+}
+
+/**
+ * Polls the touchscreen and handles the buttons drawn by uiDisplayBasic(). Called periodically by the UI task.
+ * Note that the touchscreen shares the I2C bus with the CODEC: CODEC reconfigurations are hence carried out from here too.
+ */
+void uiHandleTouch(void) {
+
+	static uint32_t lastPoll = 0;
+	static uint8_t wasTouched = 0;
+	static uint8_t wasRecording = 0;
+	static uint8_t rateChecked = 0;
+	static uint32_t recCount = 0;
+	TS_StateTypeDef ts;
+
+	if (HAL_GetTick() - lastPoll < TOUCH_POLL_PERIOD)
+		return;
+	lastPoll = HAL_GetTick();
+
+	// rate and input of the settings restored at boot (see presets.c): they reconfigure the CODEC, hence done from here
+	if (audioApplyStreamSettings()) {
+		uiDisplayInput(audioGetInput());
+		uiDisplayRate(audioGetSampleRate());
+	}
+
+	// the recorder also stops by itself, at REC_MAX_SECONDS or on a write error:
+	if (recorderIsRecording() != wasRecording) {
+		wasRecording = recorderIsRecording();
+		displayRecorder(wasRecording);
+	}
+
+	// the player stops by itself if the file is missing or unreadable:
+	if (fileInput && !playerIsActive()) {
+		fileInput = 0;
+		uiDisplayInput(audioGetInput());
+	}
+
+	// no sample rate conversion in the player: follow the file rate, once per file
+	if (fileInput && !rateChecked && playerIsPlaying()) {
+		uint32_t rate = playerGetSampleRate();
+		rateChecked = 1;
+		if (rate != audioGetSampleRate() && (rate == SAI_AUDIO_FREQUENCY_16K || rate == SAI_AUDIO_FREQUENCY_48K)) {
+			if (audioSetSampleRate(rate) != AUDIO_OK)
+				printf("ui: cannot switch to %lu Hz\n", rate);
+			uiDisplayRate(audioGetSampleRate());
+		}
+	}
+
+	TS_GetState(&ts);
+
+	// act on the press only, not as long as the finger stays on the screen:
+	if (ts.touchDetected && !wasTouched) {
+
+		uint16_t x = ts.touchX[0];
+		uint16_t y = ts.touchY[0];
+
+		if (inButton(x, y, INPUT_BUTTON_X, BUTTON_Y)) {
+			// line in -> microphones -> file (over the line in, which is used if the ring runs dry) -> line in
+			uint16_t device = INPUT_DEVICE_INPUT_LINE_1;
+			if (fileInput) {
+				playerStop();
+				fileInput = 0;
+			}
+			else if (audioGetInput() == INPUT_DEVICE_INPUT_LINE_1)
+				device = INPUT_DEVICE_DIGITAL_MICROPHONE_2;
+			else {
+				fileInput = playerStart(PLAYER_FILE, 1) == PLAYER_OK;
+				rateChecked = 0;
+			}
+			if (audioSetInput(device) != AUDIO_OK)
+				printf("ui: cannot switch input\n");
+			uiDisplayInput(audioGetInput());
+		}
+		else if (inButton(x, y, RATE_BUTTON_X, BUTTON_Y)) {
+			uint32_t rate = audioGetSampleRate() == SAI_AUDIO_FREQUENCY_48K ? SAI_AUDIO_FREQUENCY_16K : SAI_AUDIO_FREQUENCY_48K;
+			if (audioSetSampleRate(rate) != AUDIO_OK)
+				printf("ui: cannot switch to %lu Hz\n", rate);
+			uiDisplayRate(audioGetSampleRate());
+		}
+		else if (inButton(x, y, LATENCY_BUTTON_X, LATENCY_BUTTON_Y)) {
+			latencyMeasureAll(); // switches input and rate temporarily
+			uiDisplayInput(audioGetInput());
+			uiDisplayRate(audioGetSampleRate());
+		}
+		else if (inButton(x, y, REC_BUTTON_X, REC_BUTTON_Y)) {
+			if (recorderIsRecording())
+				recorderStop(); // the label changes once the writer task has closed the file
+			else {
+				char path[16]; // numbered from 0 at each boot, older recordings get overwritten
+				snprintf(path, sizeof(path), "rec%03lu.wav", recCount++ % 1000);
+				if (recorderStart(path, audioGetSampleRate(), REC_MAX_SECONDS) != RECORDER_OK)
+					printf("ui: cannot start recording\n");
+			}
+		}
+	}
+	wasTouched = ts.touchDetected;
+}
+
+/**
+ * Record button label: what a touch does.
+ */
+static void displayRecorder(uint8_t recording) {
+
+	displayText(REC_BUTTON_X + 15, REC_BUTTON_Y + 12, recording ? "Stop rec" : "Record  ", &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE,
+			DISPLAY_OPAQUE);
+}
+
+static uint8_t inButton(uint16_t x, uint16_t y, uint16_t buttonX, uint16_t buttonY) {
+
+	return x >= buttonX && x < buttonX + BUTTON_W && y >= buttonY && y < buttonY + BUTTON_H;
+}
+
+_Static_assert(ASSET_IMAGE_ARGB8888 == CM_ARGB8888 && ASSET_IMAGE_RGB565 == CM_RGB565 && ASSET_IMAGE_ARGB4444 == CM_ARGB4444
+		&& ASSET_IMAGE_L8 == CM_L8, "asset image formats must be the DMA2D input color modes");
+
+/**
+ * Fills "image" with an ASSET_IMAGE of the asset store, read in place from the QSPI flash. Returns 0 if not found.
+ */
+static uint8_t getImage(const char *name, LCD_ImageTypeDef *image) {
+
+	uint32_t width, height, format, clutSize;
+	const uint32_t *clut;
+	const void *pixels = assetsGetImage(name, &width, &height, &format, &clut, &clutSize);
+
+	if (pixels == NULL)
+		return 0;
+	image->pixels = pixels;
+	image->clut = clut;
+	image->width = width;
+	image->height = height;
+	image->colorMode = format; // asset_image_format_t values are the DMA2D input color modes
+	image->clutSize = clutSize;
+	return 1;
+}
+
+/**
+ * One input level line: value in dB at x = 90, and a bar from -METER_FLOOR_DB to 0dB.
+ */
+static void displayLevel(uint16_t y, double level) {
+
+	char buf[20];
+	int bar = 0;
 
-	if (inputLevelR > 0) {
-		int lvl_db = (int) (20. * log10(inputLevelR));
-		sprintf((char*) buf, "%d dB   ", lvl_db);
-		LCD_DrawString(90, 50, (uint8_t*) buf, LEFT_MODE, true);
+	if (level > 0) {
+		int lvl_db = (int) (20. * log10(level));
+		sprintf(buf, "%d dB   ", lvl_db);
+		bar = (lvl_db + METER_FLOOR_DB) * METER_W / METER_FLOOR_DB;
+		if (bar < 0)
+			bar = 0;
 	} else
-		LCD_DrawString(90, 50, (uint8_t*) "-inf dB", LEFT_MODE, true);
+		sprintf(buf, "-inf dB");
 
+	displayText(90, y, buf, &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, DISPLAY_OPAQUE);
+	displayMeter(METER_X, y + 1, METER_W, METER_H, bar, LCD_COLOR_DARKGREEN, LCD_COLOR_LIGHTGRAY);
 }
@@ -78,6 +78,57 @@ LoopCopyDataInit:
   cmp r4, r1
   bcc CopyDataInit
   
+/* Copy the ITCM code and the DTCM data from flash (see mem_sections.h) */
+  ldr r0, =_sitcm_text
+  ldr r1, =_eitcm_text
+  ldr r2, =_siitcm_text
+  movs r3, #0
+  b LoopCopyItcmInit
+
+CopyItcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyItcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyItcmInit
+
+  ldr r0, =_sdtcm_data
+  ldr r1, =_edtcm_data
+  ldr r2, =_sidtcm_data
+  movs r3, #0
+  b LoopCopyDtcmInit
+
+CopyDtcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyDtcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyDtcmInit
+
+/* the ITCM code must be visible to instruction fetches before it runs */
+  dsb
+  isb
+
+/* Zero fill the DTCM bss segment. */
+  ldr r2, =_sdtcm_bss
+  ldr r4, =_edtcm_bss
+  movs r3, #0
+  b LoopFillZeroDtcmBss
+
+FillZeroDtcmBss:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroDtcmBss:
+  cmp r2, r4
+  bcc FillZeroDtcmBss
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
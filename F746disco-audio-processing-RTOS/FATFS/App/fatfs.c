@@ -51,6 +51,27 @@ DWORD get_fattime(void)
 
 /* USER CODE BEGIN Application */
 
+static volatile uint8_t sdMounted = 0;
+
+/**
+  * @brief  Mounts the SD card volume the first time it is needed.
+  *         Must be called from a task, as sd_diskio.c relies on the RTOS.
+  * @param  None
+  * @retval FR_OK if the volume is (or already was) mounted
+  */
+FRESULT FATFS_MountSD(void)
+{
+  FRESULT res = FR_OK;
+
+  if (!sdMounted)
+  {
+    res = f_mount(&SDFatFS, (TCHAR const*)SDPath, 1);
+    if (res == FR_OK)
+      sdMounted = 1;
+  }
+  return res;
+}
+
 /* USER CODE END Application */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -39,6 +39,7 @@ extern FIL SDFile; /* File object for SD */
 void MX_FATFS_Init(void);
 
 /* USER CODE BEGIN Prototypes */
+FRESULT FATFS_MountSD(void);
 
 /* USER CODE END Prototypes */
 #ifdef __cplusplus
@@ -24,10 +24,12 @@
 / Additional user header to be used
 /-----------------------------------------------------------------------------*/
 
+#ifndef FATFS_HOST_BUILD
 #include "main.h"
 #include "stm32f7xx_hal.h"
 #include "bsp_driver_sd.h"
 #include "cmsis_os.h" /* _FS_REENTRANT set to 1 and CMSIS API chosen */
+#endif /* host tools (see tools/recbench.c) build FatFs with this very configuration, minus the RTOS */
 
 /*-----------------------------------------------------------------------------/
 / Function Configurations
@@ -66,7 +68,7 @@
 #define _USE_FASTSEEK        1
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
-#define	_USE_EXPAND		0
+#define	_USE_EXPAND		1
 /* This option switches f_expand function. (0:Disable or 1:Enable) */
 
 #define _USE_CHMOD		0
@@ -241,7 +243,11 @@
 /      can be opened simultaneously under file lock control. Note that the file
 /      lock control is independent of re-entrancy. */
 
+#ifndef FATFS_HOST_BUILD
 #define _FS_REENTRANT    1  /* 0:Disable or 1:Enable */
+#else
+#define _FS_REENTRANT    0
+#endif
 #define _FS_TIMEOUT      1000 /* Timeout period in unit of time ticks */
 #define _SYNC_t          osSemaphoreId
 /* The option _FS_REENTRANT switches the re-entrancy (thread safe) of the FatFs
@@ -18,12 +18,22 @@
 
 /* Includes ------------------------------------------------------------------*/
 
+#ifndef JPEG_HOST_BUILD
+
 /*FatFS is chosen for File storage*/
 #include "ff.h"
 
 /*FreeRtos Api*/
 #include "cmsis_os.h"
 
+#else
+
+/* host build of the decoder, see tools/jpegcheck.c */
+#include <stdio.h>
+#include <stdint.h>
+
+#endif
+
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
@@ -32,8 +42,14 @@
 /* Private functions ---------------------------------------------------------*/
 
 /*This defines the memory allocation methods.*/
-#define JMALLOC   pvPortMalloc
-#define JFREE     vPortFree
+/* The decoder's working memory comes from a dedicated heap in SDRAM, not from the FreeRTOS heap, see jpegdec.c */
+void *jpegdecAlloc(size_t size);
+void jpegdecFree(void *ptr);
+
+#define JMALLOC   jpegdecAlloc
+#define JFREE     jpegdecFree
+
+#ifndef JPEG_HOST_BUILD
 
 /*This defines the File data manager type.*/
 #define JFILE            FIL
@@ -47,4 +63,16 @@ read_file (file,buf,sizeofbuf)
 #define JFWRITE(file,buf,sizeofbuf)  \
 write_file (file,buf,sizeofbuf)
 
+#else
+
+#define JFILE            FILE
+
+#define JFREAD(file,buf,sizeofbuf)  \
+fread (buf,1,sizeofbuf,file)
+
+#define JFWRITE(file,buf,sizeofbuf)  \
+fwrite (buf,1,sizeofbuf,file)
+
+#endif
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,605 @@
+/*
+ * assetpack.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side packer for the QSPI asset store (see Core/Inc/assets.h and Core/Src/assets.c).
+ *
+ * Build (any little-endian host):
+ * 		cc -O2 -Wall -o assetpack assetpack.c -I../F746disco-audio-processing-RTOS/Core/Inc -lm
+ *
+ * Pack:
+ * 		assetpack -o assets.bin ENTRY [ENTRY...]
+ *
+ * 		ENTRY is one of:
+ * 		raw:NAME=file				opaque bytes
+ * 		preset:NAME=file			opaque effect settings
+ * 		wavetable:NAME=file.wav:LEN	wavetables of LEN samples each (float32)
+ * 		ir:NAME=file.wav			time-domain impulse response (float32)
+ * 		irpart:NAME=file.wav:LEN	spectra of the IR partitions of LEN samples, packed like arm_rfft_fast_f32() output
+ * 		image:NAME=file.bmp:FMT		image converted for LCD_DrawImage(), FMT = rgb565, argb4444, l8 or argb8888
+ * 		jpeg:NAME=file.jpg			JPEG file, stored as is, decoded on the target by the image loader (see images.c)
+ *
+ * 		WAV files may be 16 bit PCM or 32 bit float, only the first channel is used.
+ * 		BMP files may be uncompressed 24 or 32 bit (BGRA, the alpha is kept), or 16 bit RGB565 (as gui/logo.c).
+ * 		l8 keeps the exact colors if the image has at most 256 of them, else it reduces the precision of the
+ * 		channels until at most 256 colors remain, each palette entry being the average of the colors it replaces.
+ *
+ * List and check a container (header, table CRC, data CRCs and IR partition spectra against a direct computation):
+ * 		assetpack -l assets.bin [ir.wav...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "assets.h"
+
+_Static_assert(sizeof(asset_header_t) == 16, "asset_header_t layout");
+_Static_assert(sizeof(asset_entry_t) == 48, "asset_entry_t layout");
+
+#define MAX_ENTRIES	256
+
+typedef struct {
+	asset_entry_t e;
+	uint8_t *data;
+} pending_t;
+
+static pending_t pending[MAX_ENTRIES];
+static int npending = 0;
+
+// ---------- CRC-32/MPEG-2, same as the STM32 CRC unit set up by MX_CRC_Init() -------------
+
+static uint32_t crc32mpeg2(const uint8_t *p, size_t len) {
+
+	uint32_t crc = 0xFFFFFFFF;
+	while (len--) {
+		crc ^= (uint32_t) *p++ << 24;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+	}
+	return crc;
+}
+
+// ---------- file helpers -------------
+
+static uint8_t* readFile(const char *path, size_t *size) {
+
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	fseek(f, 0, SEEK_END);
+	long n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buf = malloc(n > 0 ? n : 1);
+	if (!buf || fread(buf, 1, n, f) != (size_t) n) {
+		fprintf(stderr, "%s: read error\n", path);
+		exit(1);
+	}
+	fclose(f);
+	*size = n;
+	return buf;
+}
+
+static uint32_t le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+/**
+ * Loads the first channel of a 16 bit PCM or 32 bit float WAV file.
+ */
+static float* readWav(const char *path, uint32_t *length, uint32_t *sampleRate) {
+
+	size_t size;
+	uint8_t *buf = readFile(path, &size);
+	uint16_t format = 0, channels = 0, bits = 0;
+	size_t pos = 12;
+
+	if (size < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4)) {
+		fprintf(stderr, "%s: not a WAV file\n", path);
+		exit(1);
+	}
+
+	while (pos + 8 <= size) {
+		uint32_t n = le32(buf + pos + 4);
+		if (!memcmp(buf + pos, "fmt ", 4) && n >= 16) {
+			format = le16(buf + pos + 8);
+			channels = le16(buf + pos + 10);
+			*sampleRate = le32(buf + pos + 12);
+			bits = le16(buf + pos + 22);
+		}
+		else if (!memcmp(buf + pos, "data", 4)) {
+			const uint8_t *d = buf + pos + 8;
+			if (pos + 8 + n > size)
+				n = size - pos - 8;
+			if (channels == 0 || !((format == 1 && bits == 16) || (format == 3 && bits == 32))) {
+				fprintf(stderr, "%s: only 16 bit PCM and 32 bit float are supported\n", path);
+				exit(1);
+			}
+			uint32_t frame = channels * bits / 8;
+			*length = n / frame;
+			float *out = malloc(*length * sizeof(float) + 1);
+			for (uint32_t i = 0; i < *length; i++) {
+				if (format == 1)
+					out[i] = (int16_t) le16(d + i * frame) / 32768.0f;
+				else
+					memcpy(&out[i], d + i * frame, sizeof(float));
+			}
+			free(buf);
+			return out;
+		}
+		pos += 8 + n + (n & 1);
+	}
+	fprintf(stderr, "%s: no data chunk\n", path);
+	exit(1);
+}
+
+/**
+ * Size of a JPEG image, from its SOF marker. Returns 0 if it isn't a JPEG file.
+ */
+static int jpegSize(const uint8_t *buf, size_t size, uint32_t *width, uint32_t *height) {
+
+	size_t i = 2;
+
+	if (size < 4 || buf[0] != 0xFF || buf[1] != 0xD8)
+		return 0;
+	while (i + 4 <= size) {
+		if (buf[i] != 0xFF)
+			return 0;
+		uint8_t marker = buf[i + 1];
+		if (marker == 0xFF) { // fill byte
+			i++;
+			continue;
+		}
+		uint32_t len = buf[i + 2] << 8 | buf[i + 3];
+		// SOF0..SOF15, except DHT (C4), JPG (C8) and DAC (CC)
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+			if (i + 9 > size)
+				return 0;
+			*height = buf[i + 5] << 8 | buf[i + 6];
+			*width = buf[i + 7] << 8 | buf[i + 8];
+			return 1;
+		}
+		i += 2 + len;
+	}
+	return 0;
+}
+
+/**
+ * Loads an uncompressed BMP file as ARGB8888 pixels, first line first. 24 and 16 bit images are opaque.
+ */
+static uint32_t* readBmp(const char *path, uint32_t *width, uint32_t *height) {
+
+	size_t size;
+	uint8_t *buf = readFile(path, &size);
+
+	if (size < 54 || buf[0] != 'B' || buf[1] != 'M') {
+		fprintf(stderr, "%s: not a BMP file\n", path);
+		exit(1);
+	}
+	uint32_t offset = le32(buf + 10);
+	int32_t w = (int32_t) le32(buf + 18), h = (int32_t) le32(buf + 22);
+	uint16_t bits = le16(buf + 28);
+	uint32_t compression = le32(buf + 30);
+	int topDown = h < 0;
+
+	if (h < 0)
+		h = -h;
+	if (w <= 0 || h == 0 || w > 0xFFFF || h > 0xFFFF || !(bits == 16 || bits == 24 || bits == 32) || compression > 3) {
+		fprintf(stderr, "%s: only uncompressed 16, 24 or 32 bit BMP files are supported\n", path);
+		exit(1);
+	}
+	uint32_t stride = ((uint32_t) w * bits / 8 + 3) & ~3;
+	if (offset + stride * h > size) {
+		fprintf(stderr, "%s: truncated\n", path);
+		exit(1);
+	}
+
+	uint32_t *out = malloc((size_t) w * h * sizeof(uint32_t));
+	for (int32_t y = 0; y < h; y++) {
+		const uint8_t *line = buf + offset + (size_t) stride * (topDown ? y : h - 1 - y);
+		for (int32_t x = 0; x < w; x++) {
+			const uint8_t *px = line + x * bits / 8;
+			uint32_t c;
+			if (bits == 16) {
+				uint16_t v = le16(px);
+				uint32_t r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+				c = 0xFF000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+			}
+			else
+				c = (bits == 32 ? (uint32_t) px[3] << 24 : 0xFF000000) | (px[2] << 16) | (px[1] << 8) | px[0];
+			out[(size_t) y * w + x] = c;
+		}
+	}
+	free(buf);
+	*width = w;
+	*height = h;
+	return out;
+}
+
+// ---------- image conversion -------------
+
+static int cmpU32(const void *a, const void *b) {
+
+	uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * Sorted distinct values of "keys", returns their count.
+ */
+static uint32_t distinct(uint32_t *keys, uint32_t n) {
+
+	uint32_t count = 0;
+
+	qsort(keys, n, sizeof(uint32_t), cmpU32);
+	for (uint32_t i = 0; i < n; i++)
+		if (i == 0 || keys[i] != keys[i - 1])
+			keys[count++] = keys[i];
+	return count;
+}
+
+/**
+ * ARGB8888 -> palette of at most 256 colors (padded to ASSETS_ALIGN bytes) followed by the L8 indices.
+ * Drops the low bits of every channel until at most 256 colors remain (none if there are 256 colors or less).
+ */
+static uint8_t* toL8(const uint32_t *argb, uint32_t n, uint32_t *clutSize, uint32_t *size) {
+
+	uint32_t *keys = malloc(n * sizeof(uint32_t));
+	uint32_t mask, count = 0;
+
+	for (int drop = 0; drop <= 8; drop++) {
+		uint8_t m = 0xFF << drop;
+		mask = m * 0x01010101u;
+		for (uint32_t i = 0; i < n; i++)
+			keys[i] = argb[i] & mask;
+		count = distinct(keys, n);
+		if (count <= 256)
+			break;
+	}
+
+	uint32_t clutBytes = (count * 4 + ASSETS_ALIGN - 1) & ~(ASSETS_ALIGN - 1);
+	uint8_t *out = calloc(clutBytes + n, 1);
+	uint32_t *clut = (uint32_t*) out;
+	uint8_t *index = out + clutBytes;
+	double (*sum)[4] = calloc(count, sizeof(*sum));
+	uint32_t *hits = calloc(count, sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t key = argb[i] & mask;
+		uint32_t *k = bsearch(&key, keys, count, sizeof(uint32_t), cmpU32);
+		uint32_t j = k - keys;
+		index[i] = j;
+		for (int c = 0; c < 4; c++)
+			sum[j][c] += (argb[i] >> (8 * c)) & 0xFF;
+		hits[j]++;
+	}
+	for (uint32_t j = 0; j < count; j++) {
+		uint32_t c = 0;
+		for (int k = 0; k < 4; k++)
+			c |= (uint32_t) (sum[j][k] / hits[j] + 0.5) << (8 * k);
+		clut[j] = c;
+	}
+
+	free(keys);
+	free(sum);
+	free(hits);
+	*clutSize = count;
+	*size = clutBytes + n;
+	return out;
+}
+
+/**
+ * Converts ARGB8888 pixels to the asset image format, returns the data and its size.
+ */
+static uint8_t* convertImage(const uint32_t *argb, uint32_t n, asset_image_format_t format, uint32_t *clutSize, uint32_t *size) {
+
+	*clutSize = 0;
+
+	if (format == ASSET_IMAGE_L8)
+		return toL8(argb, n, clutSize, size);
+
+	if (format == ASSET_IMAGE_ARGB8888) {
+		*size = n * 4;
+		uint8_t *out = malloc(*size);
+		memcpy(out, argb, *size);
+		return out;
+	}
+
+	uint16_t *out = malloc(n * 2);
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t a = argb[i] >> 24, r = (argb[i] >> 16) & 0xFF, g = (argb[i] >> 8) & 0xFF, b = argb[i] & 0xFF;
+		if (format == ASSET_IMAGE_RGB565)
+			out[i] = ((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | (b * 31 + 127) / 255;
+		else
+			out[i] = ((a * 15 + 127) / 255) << 12 | ((r * 15 + 127) / 255) << 8 | ((g * 15 + 127) / 255) << 4 | (b * 15 + 127) / 255;
+	}
+	*size = n * 2;
+	return (uint8_t*) out;
+}
+
+// ---------- IR partition spectra -------------
+
+/**
+ * Partition spectra in the packed arm_rfft_fast_f32() layout: for each partition of "len" samples zero-padded to 2*len,
+ * out[0] = Re X[0], out[1] = Re X[len], out[2k] = Re X[k], out[2k+1] = Im X[k] for k = 1..len-1,
+ * with X[k] = sum x[n] exp(-2i.pi.k.n / 2len). A direct DFT in double precision is plenty fast for an offline tool.
+ */
+static float* partitionSpectra(const float *ir, uint32_t irLength, uint32_t len, uint32_t *count) {
+
+	uint32_t n2 = 2 * len;
+	*count = (irLength + len - 1) / len;
+	float *out = calloc((size_t) *count * n2, sizeof(float));
+	double *c = malloc(n2 * sizeof(double));
+	double *s = malloc(n2 * sizeof(double));
+
+	for (uint32_t i = 0; i < n2; i++) {
+		c[i] = cos(2 * M_PI * i / n2);
+		s[i] = sin(2 * M_PI * i / n2);
+	}
+
+	for (uint32_t p = 0; p < *count; p++) {
+		const float *x = ir + p * len;
+		uint32_t valid = irLength - p * len < len ? irLength - p * len : len;
+		float *X = out + (size_t) p * n2;
+
+		for (uint32_t k = 0; k <= len; k++) {
+			double re = 0, im = 0;
+			for (uint32_t n = 0; n < valid; n++) {
+				uint32_t idx = (uint32_t) (((uint64_t) k * n) % n2);
+				re += x[n] * c[idx];
+				im -= x[n] * s[idx];
+			}
+			if (k == 0)
+				X[0] = re;
+			else if (k == len)
+				X[1] = re;
+			else {
+				X[2 * k] = re;
+				X[2 * k + 1] = im;
+			}
+		}
+	}
+	free(c);
+	free(s);
+	return out;
+}
+
+// ---------- packing -------------
+
+static void addEntry(const char *name, asset_type_t type, uint8_t *data, uint32_t size, uint32_t p0, uint32_t p1) {
+
+	if (npending == MAX_ENTRIES) {
+		fprintf(stderr, "too many entries\n");
+		exit(1);
+	}
+	if (strlen(name) >= ASSETS_NAME_LEN) {
+		fprintf(stderr, "%s: name longer than %d characters\n", name, ASSETS_NAME_LEN - 1);
+		exit(1);
+	}
+	pending_t *p = &pending[npending++];
+	memset(p, 0, sizeof(*p));
+	strcpy(p->e.name, name);
+	p->e.type = type;
+	p->e.size = size;
+	p->e.param0 = p0;
+	p->e.param1 = p1;
+	p->e.crc = crc32mpeg2(data, size);
+	p->data = data;
+}
+
+/**
+ * Parses "type:NAME=file[:LEN]"
+ */
+static void parseEntry(char *arg) {
+
+	char *colon = strchr(arg, ':');
+	char *eq = colon ? strchr(colon, '=') : NULL;
+	if (!colon || !eq) {
+		fprintf(stderr, "bad entry: %s\n", arg);
+		exit(1);
+	}
+	*colon = 0;
+	*eq = 0;
+	const char *type = arg, *name = colon + 1;
+	char *file = eq + 1;
+	char *lenStr = strchr(file, ':');
+	uint32_t len = 0;
+	if (lenStr) {
+		*lenStr++ = 0;
+		len = strtoul(lenStr, NULL, 0);
+	}
+
+	if (!strcmp(type, "raw") || !strcmp(type, "preset")) {
+		size_t size;
+		uint8_t *data = readFile(file, &size);
+		addEntry(name, !strcmp(type, "raw") ? ASSET_RAW : ASSET_PRESET, data, size, 0, 0);
+	}
+	else if (!strcmp(type, "wavetable")) {
+		uint32_t n, sr;
+		float *w = readWav(file, &n, &sr);
+		if (len == 0 || n < len) {
+			fprintf(stderr, "%s: wavetable length missing or longer than the file\n", file);
+			exit(1);
+		}
+		addEntry(name, ASSET_WAVETABLE, (uint8_t*) w, (n / len) * len * sizeof(float), len, n / len);
+	}
+	else if (!strcmp(type, "ir")) {
+		uint32_t n, sr;
+		float *ir = readWav(file, &n, &sr);
+		addEntry(name, ASSET_IR, (uint8_t*) ir, n * sizeof(float), n, sr);
+	}
+	else if (!strcmp(type, "irpart")) {
+		uint32_t n, sr, count;
+		if (len == 0 || (len & (len - 1))) {
+			fprintf(stderr, "%s: partition length must be a power of two\n", file);
+			exit(1);
+		}
+		float *ir = readWav(file, &n, &sr);
+		float *spectra = partitionSpectra(ir, n, len, &count);
+		free(ir);
+		addEntry(name, ASSET_IR_PARTITIONS, (uint8_t*) spectra, count * 2 * len * sizeof(float), len, count);
+	}
+	else if (!strcmp(type, "image")) {
+		static const char *formats[] = { "argb8888", NULL, "rgb565", NULL, "argb4444", "l8" };
+		int format = -1;
+		for (int i = 0; i < 6 && lenStr; i++)
+			if (formats[i] && !strcmp(lenStr, formats[i]))
+				format = i;
+		if (format < 0) {
+			fprintf(stderr, "%s: image format missing or unknown (rgb565, argb4444, l8 or argb8888)\n", file);
+			exit(1);
+		}
+		uint32_t w, h, clutSize, size;
+		uint32_t *argb = readBmp(file, &w, &h);
+		uint8_t *data = convertImage(argb, w * h, format, &clutSize, &size);
+		free(argb);
+		if (format == ASSET_IMAGE_L8)
+			printf("%s: %u colors\n", file, clutSize);
+		addEntry(name, ASSET_IMAGE, data, size, w | h << 16, format | clutSize << 16);
+	}
+	else if (!strcmp(type, "jpeg")) {
+		size_t size;
+		uint32_t w, h;
+		uint8_t *data = readFile(file, &size);
+		if (!jpegSize(data, size, &w, &h)) {
+			fprintf(stderr, "%s: not a JPEG file\n", file);
+			exit(1);
+		}
+		addEntry(name, ASSET_JPEG, data, size, w | h << 16, 0);
+	}
+	else {
+		fprintf(stderr, "unknown entry type: %s\n", type);
+		exit(1);
+	}
+}
+
+static int pack(const char *outPath) {
+
+	uint32_t offset = sizeof(asset_header_t) + npending * sizeof(asset_entry_t);
+	static asset_entry_t table[MAX_ENTRIES];
+
+	for (int i = 0; i < npending; i++) {
+		offset = (offset + ASSETS_ALIGN - 1) & ~(ASSETS_ALIGN - 1);
+		pending[i].e.offset = offset;
+		table[i] = pending[i].e;
+		offset += pending[i].e.size;
+	}
+
+	asset_header_t h = { ASSETS_MAGIC, ASSETS_VERSION, npending, offset, crc32mpeg2((uint8_t*) table, npending * sizeof(asset_entry_t)) };
+
+	uint8_t *image = calloc(offset, 1);
+	memcpy(image, &h, sizeof(h));
+	memcpy(image + sizeof(h), table, npending * sizeof(asset_entry_t));
+	for (int i = 0; i < npending; i++)
+		memcpy(image + table[i].offset, pending[i].data, table[i].size);
+
+	FILE *f = fopen(outPath, "wb");
+	if (!f || fwrite(image, 1, offset, f) != offset) {
+		perror(outPath);
+		return 1;
+	}
+	fclose(f);
+	printf("%s: %d assets, %u bytes\n", outPath, npending, offset);
+	return 0;
+}
+
+// ---------- listing / checking -------------
+
+static const char *typeNames[] = { "raw", "wavetable", "ir", "irpart", "preset", "image", "jpeg" };
+
+/**
+ * Checks an ASSET_IR_PARTITIONS entry against the given WAV file by summing the partition spectra back
+ * into the full-length spectrum at a few bins, which is independent from the way partitionSpectra() computes them.
+ */
+static int checkPartitions(const asset_entry_t *e, const float *spectra, const char *wavPath) {
+
+	uint32_t n, sr, len = e->param0;
+	float *ir = readWav(wavPath, &n, &sr);
+	int errors = 0;
+
+	for (uint32_t p = 0; p < e->param1; p++) {
+		const float *X = spectra + (size_t) p * 2 * len;
+		for (uint32_t k = 1; k < len; k += len / 8 ? len / 8 : 1) {
+			double re = 0, im = 0;
+			for (uint32_t i = 0; i < len && p * len + i < n; i++) {
+				double a = -M_PI * k * i / len;
+				re += ir[p * len + i] * cos(a);
+				im += ir[p * len + i] * sin(a);
+			}
+			double err = fabs(re - X[2 * k]) + fabs(im - X[2 * k + 1]);
+			if (err > 1e-3 * (1 + fabs(re) + fabs(im)))
+				errors++;
+		}
+	}
+	free(ir);
+	printf("    partitions vs %s: %s\n", wavPath, errors ? "MISMATCH" : "ok");
+	return errors != 0;
+}
+
+static int list(const char *path, int nwav, char **wavs) {
+
+	size_t size;
+	uint8_t *image = readFile(path, &size);
+	asset_header_t h;
+	int errors = 0;
+
+	if (size < sizeof(h)) {
+		fprintf(stderr, "%s: too short\n", path);
+		return 1;
+	}
+	memcpy(&h, image, sizeof(h));
+	if (h.magic != ASSETS_MAGIC || h.version != ASSETS_VERSION || h.totalSize != size
+			|| sizeof(h) + h.count * sizeof(asset_entry_t) > size) {
+		fprintf(stderr, "%s: bad header\n", path);
+		return 1;
+	}
+	const asset_entry_t *e = (const asset_entry_t*) (image + sizeof(h));
+	if (crc32mpeg2((const uint8_t*) e, h.count * sizeof(asset_entry_t)) != h.tableCrc) {
+		fprintf(stderr, "%s: bad table CRC\n", path);
+		return 1;
+	}
+
+	printf("%s: %d assets, %u bytes\n", path, h.count, h.totalSize);
+	for (int i = 0; i < h.count; i++) {
+		int ok = e[i].offset % ASSETS_ALIGN == 0 && e[i].offset + e[i].size <= size
+				&& crc32mpeg2(image + e[i].offset, e[i].size) == e[i].crc;
+		printf("  %-24s %-9s offset 0x%06x size %8u params %u,%u %s\n", e[i].name, e[i].type < 7 ? typeNames[e[i].type] : "?",
+				e[i].offset, e[i].size, e[i].param0, e[i].param1, ok ? "ok" : "BAD CRC");
+		errors += !ok;
+		if (e[i].type == ASSET_JPEG)
+			printf("    %ux%u JPEG\n", e[i].param0 & 0xFFFF, e[i].param0 >> 16);
+		if (e[i].type == ASSET_IMAGE)
+			printf("    %ux%u, format %u, %u colors in the palette\n", e[i].param0 & 0xFFFF, e[i].param0 >> 16, e[i].param1 & 0xFFFF, e[i].param1 >> 16);
+		if (ok && e[i].type == ASSET_IR_PARTITIONS && nwav > 0) {
+			errors += checkPartitions(&e[i], (const float*) (image + e[i].offset), wavs[0]);
+			wavs++;
+			nwav--;
+		}
+	}
+	free(image);
+	return errors != 0;
+}
+
+int main(int argc, char **argv) {
+
+	if (argc >= 3 && !strcmp(argv[1], "-l"))
+		return list(argv[2], argc - 3, argv + 3);
+
+	if (argc >= 4 && !strcmp(argv[1], "-o")) {
+		for (int i = 3; i < argc; i++)
+			parseEntry(argv[i]);
+		return pack(argv[2]);
+	}
+
+	fprintf(stderr, "usage: %s -o assets.bin type:NAME=file[:LEN|:FMT]...\n"
+			"       %s -l assets.bin [ir.wav...]\n", argv[0], argv[0]);
+	return 1;
+}
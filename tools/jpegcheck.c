@@ -0,0 +1,166 @@
+/*
+ * jpegcheck.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side check of the JPEG decoder of the image loader (Core/Src/jpegdec.c, see images.c): decodes images with
+ * the same code, the same libjpeg sources and configuration (LIBJPEG/Target) and the same heap as on the target,
+ * and reports the decoder heap peak, which must fit into JPEG_HEAP_SIZE_BYTES (see disco_base.h).
+ *
+ * Build (any host), from this directory:
+ * 		P=../F746disco-audio-processing-RTOS
+ * 		cc -O2 -Wall -DJPEG_HOST_BUILD -I$P/Core/Inc -I$P/LIBJPEG/Target -I$P/Middlewares/Third_Party/LibJPEG/include \
+ * 			-o jpegcheck jpegcheck.c $P/Core/Src/jpegdec.c $P/Middlewares/Third_Party/LibJPEG/source/j*.c
+ *
+ * Run:
+ * 		jpegcheck [-s WxH] [-m HEAP] [-o out.bmp] image.jpg...
+ *
+ * 		-s	largest decoded image, 480x272 (the screen) by default
+ * 		-m	decoder heap, in bytes, 131072 (JPEG_HEAP_SIZE_BYTES) by default
+ * 		-o	writes the decoded image (of the last file) as a 16 bit RGB565 BMP file, to check it visually
+ *
+ * Each image is decoded from memory (as from the QSPI flash) and from the file (as from the SD card), both must give
+ * the same pixels. Exits with 1 if an image fails to decode within the heap.
+ * E.g. jpegcheck ../Photo/20211214_095221.jpg
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "jpegdec.h"
+
+static uint8_t* readFile(const char *path, size_t *size) {
+
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	fseek(f, 0, SEEK_END);
+	long n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buf = malloc(n > 0 ? n : 1);
+	if (!buf || fread(buf, 1, n, f) != (size_t) n) {
+		fprintf(stderr, "%s: read error\n", path);
+		exit(1);
+	}
+	fclose(f);
+	*size = n;
+	return buf;
+}
+
+static void put16(FILE *f, uint16_t v) {
+	fputc(v & 0xFF, f);
+	fputc(v >> 8, f);
+}
+
+static void put32(FILE *f, uint32_t v) {
+	put16(f, v & 0xFFFF);
+	put16(f, v >> 16);
+}
+
+/**
+ * 16 bit BMP with RGB565 bit fields, top-down.
+ */
+static void writeBmp(const char *path, const uint16_t *pixels, uint32_t w, uint32_t h) {
+
+	FILE *f = fopen(path, "wb");
+	uint32_t stride = (w * 2 + 3) & ~3;
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	fputs("BM", f);
+	put32(f, 66 + stride * h);
+	put32(f, 0);
+	put32(f, 66);
+	put32(f, 40);
+	put32(f, w);
+	put32(f, -(int32_t) h);
+	put16(f, 1);
+	put16(f, 16);
+	put32(f, 3); // BI_BITFIELDS
+	put32(f, stride * h);
+	put32(f, 2835);
+	put32(f, 2835);
+	put32(f, 0);
+	put32(f, 0);
+	put32(f, 0xF800);
+	put32(f, 0x07E0);
+	put32(f, 0x001F);
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++)
+			put16(f, pixels[y * w + x]);
+		for (uint32_t x = w * 2; x < stride; x++)
+			fputc(0, f);
+	}
+	fclose(f);
+}
+
+int main(int argc, char **argv) {
+
+	uint32_t maxW = 480, maxH = 272, heapSize = 131072;
+	const char *outPath = NULL;
+	int i, errors = 0;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (!strcmp(argv[i], "-s") && i + 1 < argc && sscanf(argv[i + 1], "%ux%u", &maxW, &maxH) == 2)
+			i++;
+		else if (!strcmp(argv[i], "-m") && i + 1 < argc)
+			heapSize = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+			outPath = argv[++i];
+		else
+			break;
+	}
+	if (i == argc) {
+		fprintf(stderr, "usage: %s [-s WxH] [-m HEAP] [-o out.bmp] image.jpg...\n", argv[0]);
+		return 1;
+	}
+
+	void *heap = malloc(heapSize);
+	uint16_t *pixels = malloc(maxW * maxH * sizeof(uint16_t));
+	uint16_t *pixelsFile = malloc(maxW * maxH * sizeof(uint16_t));
+
+	for (; i < argc; i++) {
+
+		size_t size;
+		uint8_t *data = readFile(argv[i], &size);
+		jpegdec_info_t info, infoFile;
+
+		jpegdecInit(heap, heapSize);
+		clock_t start = clock();
+		uint8_t ret = jpegdecDecodeMem(data, size, pixels, maxW, maxH, &info);
+		double ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+		free(data);
+
+		if (ret != JPEGDEC_OK) {
+			printf("%s: FAILED, heap peak %u bytes of %u, %u allocations refused\n", argv[i], info.heapPeak, heapSize, info.heapFailures);
+			errors++;
+			continue;
+		}
+
+		FILE *f = fopen(argv[i], "rb");
+		memset(pixelsFile, 0, maxW * maxH * sizeof(uint16_t));
+		ret = f ? jpegdecDecodeFile(f, pixelsFile, maxW, maxH, &infoFile) : JPEGDEC_ERROR;
+		if (f)
+			fclose(f);
+		int same = ret == JPEGDEC_OK && infoFile.outWidth == info.outWidth && infoFile.outHeight == info.outHeight
+				&& !memcmp(pixels, pixelsFile, info.outWidth * info.outHeight * sizeof(uint16_t));
+
+		printf("%s: %ux%u, scaled by %u/8, decoded %ux%u, heap peak %u bytes of %u, %.1f ms on this host, file decode %s\n",
+				argv[i], info.width, info.height, info.scaleNum, info.outWidth, info.outHeight, info.heapPeak, heapSize, ms,
+				same ? "identical" : "DIFFERENT");
+		errors += !same;
+
+		if (outPath)
+			writeBmp(outPath, pixels, info.outWidth, info.outHeight);
+	}
+
+	free(heap);
+	free(pixels);
+	free(pixelsFile);
+	return errors != 0;
+}
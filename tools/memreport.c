@@ -0,0 +1,234 @@
+/*
+ * memreport.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side memory report: reads the GNU ld map file of the firmware and tells what landed in which memory,
+ * with a focus on the tightly-coupled memories (see Core/Inc/mem_sections.h) and the DMA buffers (see Core/Inc/bsp/mpu.h).
+ *
+ * Build (any host):
+ * 		cc -O2 -Wall -o memreport memreport.c
+ *
+ * Run after each firmware build:
+ * 		memreport Debug/F746disco-audio-processing-RTOS.map [-a]
+ *
+ * 		Prints the usage of each memory, then the functions and variables placed in ITCM, DTCM and RAM_DMA.
+ * 		Input sections of less than 256 bytes that merely fall into the DTCM (ordinary .data and .bss)
+ * 		are omitted unless -a is given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LINE_LEN	1024
+#define SMALL		256
+
+typedef struct {
+	const char *name;
+	uint32_t start;
+	uint32_t size;
+	int detailed;		// list the input sections
+	uint32_t used;
+} region_t;
+
+// must match STM32F746NGHX_FLASH.ld and mpu.h:
+static region_t regions[] = {
+	{ "ITCM",		0x00000000, 16 * 1024,		1, 0 },
+	{ "FLASH",		0x08000000, 1024 * 1024,	0, 0 },
+	{ "DTCM",		0x20000000, 64 * 1024,		1, 0 },
+	{ "SRAM",		0x20010000, 248 * 1024,		0, 0 },
+	{ "RAM_DMA",	0x2004E000, 8 * 1024,		1, 0 },
+};
+#define REGION_COUNT	(sizeof(regions) / sizeof(regions[0]))
+
+typedef struct {
+	char section[128];	// input section name
+	char file[256];		// object file
+	char output[64];	// output section name
+	uint32_t addr;
+	uint32_t size;
+	char symbols[512];	// symbols defined in the section, comma separated
+} entry_t;
+
+static entry_t *entries = NULL;
+static int entryCount = 0, entryMax = 0;
+
+/**
+ * Number of bytes of [addr, addr + size) inside the region (e.g. the LCD framebuffer spans DTCM and SRAM).
+ */
+static uint32_t overlap(const region_t *r, uint32_t addr, uint32_t size) {
+
+	uint64_t start = addr > r->start ? addr : r->start;
+	uint64_t end = (uint64_t) addr + size < (uint64_t) r->start + r->size ? (uint64_t) addr + size : (uint64_t) r->start + r->size;
+
+	return end > start ? (uint32_t) (end - start) : 0;
+}
+
+static int isAllocated(const char *output) {
+
+	return strncmp(output, ".debug", 6) && strcmp(output, ".comment") && strcmp(output, ".ARM.attributes")
+			&& strncmp(output, ".stab", 5) && strcmp(output, "/DISCARD/");
+}
+
+static int isHex(const char *s) {
+
+	return s[0] == '0' && s[1] == 'x';
+}
+
+static entry_t* addEntry(void) {
+
+	if (entryCount == entryMax) {
+		entryMax = entryMax ? 2 * entryMax : 1024;
+		entries = realloc(entries, entryMax * sizeof(entry_t));
+		if (entries == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	memset(&entries[entryCount], 0, sizeof(entry_t));
+	return &entries[entryCount++];
+}
+
+static int byAddress(const void *a, const void *b) {
+
+	const entry_t *x = a, *y = b;
+	return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+int main(int argc, char **argv) {
+
+	char line[LINE_LEN], pending[LINE_LEN] = "";
+	char output[64] = "";
+	int inMap = 0, all = 0;
+	entry_t *last = NULL;
+	FILE *f;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: memreport file.map [-a]\n");
+		return 1;
+	}
+	all = argc > 2 && strcmp(argv[2], "-a") == 0;
+
+	if ((f = fopen(argv[1], "r")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+
+		char a[LINE_LEN], b[LINE_LEN], c[LINE_LEN], d[LINE_LEN];
+		int n;
+
+		line[strcspn(line, "\r\n")] = 0;
+
+		if (!inMap) {
+			inMap = strstr(line, "Linker script and memory map") != NULL;
+			continue;
+		}
+
+		// long section names are alone on their line, the addresses follow on the next one:
+		if (pending[0]) {
+			char joined[2 * LINE_LEN];
+			snprintf(joined, sizeof(joined), "%s %s", pending, line);
+			snprintf(line, sizeof(line), "%.*s", (int) sizeof(line) - 1, joined);
+			pending[0] = 0;
+		}
+
+		n = sscanf(line, "%s %s %s %s", a, b, c, d);
+		if (n <= 0)
+			continue;
+
+		if (line[0] != ' ') {
+			// output section
+			if (a[0] == '.' || a[0] == '/') {
+				if (n == 1 && line[strlen(a)] == 0) {
+					snprintf(pending, sizeof(pending), "%s", line);
+					continue;
+				}
+				snprintf(output, sizeof(output), "%s", a);
+			}
+			last = NULL;
+			continue;
+		}
+
+		if (!isAllocated(output))
+			continue;
+
+		if (line[1] != ' ' && (a[0] == '.' || strcmp(a, "COMMON") == 0)) {
+			// input section: " .name 0xaddr 0xsize file"
+			if (n == 1) {
+				snprintf(pending, sizeof(pending), "%s", line);
+				continue;
+			}
+			if (n < 4 || !isHex(b) || !isHex(c)) {
+				last = NULL;
+				continue;
+			}
+			uint32_t size = strtoul(c, NULL, 16);
+			if (size == 0) {
+				last = NULL;
+				continue;
+			}
+			last = addEntry();
+			snprintf(last->section, sizeof(last->section), "%.*s", (int) sizeof(last->section) - 1, a);
+			snprintf(last->file, sizeof(last->file), "%.*s", (int) sizeof(last->file) - 1, d);
+			snprintf(last->output, sizeof(last->output), "%s", output);
+			last->addr = strtoul(b, NULL, 16);
+			last->size = size;
+		}
+		else if (last && n == 2 && isHex(a) && b[0] != '.' && strchr(b, '=') == NULL) {
+			// symbol defined in the last input section
+			size_t len = strlen(last->symbols);
+			if (len + strlen(b) + 3 < sizeof(last->symbols))
+				snprintf(last->symbols + len, sizeof(last->symbols) - len, "%s%s", len ? ", " : "", b);
+		}
+		else if (strstr(line, "*fill*") == NULL)
+			last = NULL;
+	}
+	fclose(f);
+
+	if (!inMap) {
+		fprintf(stderr, "%s: not a GNU ld map file\n", argv[1]);
+		return 1;
+	}
+
+	qsort(entries, entryCount, sizeof(entry_t), byAddress);
+
+	// at run-time addresses (the images of .data and co. in flash are not counted):
+	for (int i = 0; i < entryCount; i++)
+		for (size_t k = 0; k < REGION_COUNT; k++)
+			regions[k].used += overlap(&regions[k], entries[i].addr, entries[i].size);
+
+	printf("%-10s %10s %10s %10s %6s\n", "memory", "start", "size", "used", "%");
+	for (size_t i = 0; i < REGION_COUNT; i++) {
+		region_t *r = &regions[i];
+		printf("%-10s 0x%08x %10u %10u %5u%%\n", r->name, r->start, r->size, r->used,
+				(unsigned) ((uint64_t) 100 * r->used / r->size));
+	}
+
+	for (size_t i = 0; i < REGION_COUNT; i++) {
+
+		region_t *r = &regions[i];
+		if (!r->detailed)
+			continue;
+
+		printf("\n%s:\n", r->name);
+		for (int j = 0; j < entryCount; j++) {
+			entry_t *e = &entries[j];
+			if (overlap(r, e->addr, e->size) == 0)
+				continue;
+			int pinned = strcmp(e->output, ".itcm_text") == 0 || strcmp(e->output, ".dtcm_data") == 0
+					|| strcmp(e->output, ".dtcm_bss") == 0 || strcmp(e->output, ".dma_buffers") == 0;
+			if (!pinned && !all && e->size < SMALL)
+				continue;
+			const char *file = strrchr(e->file, '/');
+			printf("  0x%08x %7u  %-12s %-28s %s%s%s%s\n", e->addr, e->size, e->output, e->section, file ? file + 1 : e->file,
+					e->symbols[0] ? " (" : "", e->symbols, e->symbols[0] ? ")" : "");
+		}
+	}
+
+	free(entries);
+	return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * recbench.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side throughput benchmark of the SD-card WAV recorder write pattern (see Core/Src/recorder.c), against a
+ * disk image file standing in for the SD-card: the FatFs sources and configuration of the firmware
+ * (Middlewares/Third_Party/FatFs, FATFS/Target/ffconf.h) run on top of a diskio layer that reads and writes the file,
+ * and counts what the card would see.
+ *
+ * Build (any host), from this directory:
+ * 		P=../F746disco-audio-processing-RTOS
+ * 		cc -O2 -Wall -DFATFS_HOST_BUILD -I$P/FATFS/Target -I$P/Middlewares/Third_Party/FatFs/src \
+ * 			-o recbench recbench.c $P/Middlewares/Third_Party/FatFs/src/ff.c
+ * or "make recbench".
+ *
+ * Run:
+ * 		recbench [-i disk.img] [-S MB] [-c CLUSTER] [-t SECONDS] [-r RATE] [-L US] [-B MBPS]
+ *
+ * 		-i	disk image, created (sparse) and formatted in FAT32, recbench.img by default
+ * 		-S	disk size, 4096 MB by default (FAT32 with 32 KB clusters needs more than 2 GB)
+ * 		-c	cluster size, 32768 bytes by default (as on most SDHC cards)
+ * 		-t	recording duration, 600 s by default
+ * 		-r	sampling rate, 48000 Hz by default (stereo, 16 bit)
+ * 		-L	card time per write or read command, 1000 us by default
+ * 		-B	card transfer rate, 12 MB/s by default (4 bit SDIO bus at 25 MHz)
+ *
+ * The same recording is written three ways:
+ * 		recorder	pre-allocated with f_expand(), chunk-aligned multi-cluster writes (what recorder.c does)
+ * 		no expand	the same writes, without pre-allocation: FatFs looks for free clusters in the FAT while recording
+ * 		per frame	one f_write() per audio frame (512 samples), as a naive recorder would do
+ *
+ * For each, it reports the commands and sectors sent to the disk, the host time, and the time the card would take
+ * with the -L / -B model above, both in total (which must stay well below the recording duration) and for the
+ * slowest single f_write() (which must stay well below what the SDRAM ring holds, else the audio task drops frames).
+ * The model is deliberately simple: plug in figures measured on the actual card.
+ * The recorded data is read back and checked after each run. Exits with 1 on any error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "ff.h"
+#include "diskio.h"
+
+#define SECTOR				512
+#define WAV_HEADER_SIZE		512						// see recorder.c
+#define REC_MIN_CHUNK_BYTES	(32 * 1024)				// see recorder.c
+#define RING_SIZE_BYTES		(1024 * 1024)			// RECORDER_RING_SIZE_BYTES, see disco_base.h
+#define FRAME_BYTES			(512 * 2)				// one audio frame, see AUDIO_BUF_SIZE in audio.c
+
+typedef struct {
+	uint64_t writeCmds, writeSectors, readCmds, readSectors;
+} disk_stats_t;
+
+static int fd = -1;
+static DWORD sectorCount;
+static disk_stats_t disk;
+static double cmdUs = 1000, mbps = 12;
+
+// ------------ diskio on a file ------------
+
+DSTATUS disk_initialize(BYTE pdrv) {
+	(void) pdrv;
+	return fd < 0 ? STA_NOINIT : 0;
+}
+
+DSTATUS disk_status(BYTE pdrv) {
+	(void) pdrv;
+	return fd < 0 ? STA_NOINIT : 0;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count) {
+
+	(void) pdrv;
+	disk.readCmds++;
+	disk.readSectors += count;
+	return pread(fd, buff, (size_t) count * SECTOR, (off_t) sector * SECTOR) == (ssize_t) count * SECTOR ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count) {
+
+	(void) pdrv;
+	disk.writeCmds++;
+	disk.writeSectors += count;
+	return pwrite(fd, buff, (size_t) count * SECTOR, (off_t) sector * SECTOR) == (ssize_t) count * SECTOR ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff) {
+
+	(void) pdrv;
+	switch (cmd) {
+	case CTRL_SYNC:
+		return RES_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD*) buff = sectorCount;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD*) buff = SECTOR;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD*) buff = 1;
+		return RES_OK;
+	}
+	return RES_PARERR;
+}
+
+DWORD get_fattime(void) {
+	return (DWORD) (2026 - 1980) << 25 | 10 << 21 | 19 << 16;
+}
+
+// ------------ benchmark ------------
+
+static double now(void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Card time of the disk activity since "from", in ms.
+ */
+static double cardMs(const disk_stats_t *from) {
+
+	uint64_t cmds = disk.writeCmds + disk.readCmds - from->writeCmds - from->readCmds;
+	uint64_t bytes = (disk.writeSectors + disk.readSectors - from->writeSectors - from->readSectors) * SECTOR;
+	return cmds * cmdUs / 1000 + bytes / (mbps * 1e3);
+}
+
+static void fillPattern(uint8_t *ring) {
+
+	for (uint32_t i = 0; i < RING_SIZE_BYTES; i += 4) {
+		uint32_t v = i * 2654435761u;
+		memcpy(ring + i, &v, 4);
+	}
+}
+
+/**
+ * Writes "dataBytes" of audio like recorder.c (expand = 1, writeSize = 0), or with fixed-size writes (writeSize),
+ * then reads the file back. Returns 0 if OK.
+ */
+static int run(const char *label, uint32_t dataBytes, int expand, uint32_t writeSize, uint32_t clusterBytes, double seconds,
+		const uint8_t *ring) {
+
+	static uint8_t header[WAV_HEADER_SIZE], check[64 * 1024];
+	FIL file;
+	UINT bw;
+	uint32_t chunk = clusterBytes, done = 0, writes = 0;
+	double worst = 0;
+
+	while (chunk < REC_MIN_CHUNK_BYTES)
+		chunk <<= 1;
+
+	memset(header, 0x55, sizeof(header));
+	disk_stats_t start = disk;
+	double t0 = now();
+
+	if (f_open(&file, "rec0.wav", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK) {
+		printf("%s: cannot create the file\n", label);
+		return 1;
+	}
+	if (expand && f_expand(&file, WAV_HEADER_SIZE + dataBytes, 1) != FR_OK) {
+		printf("%s: no contiguous room for %u bytes\n", label, WAV_HEADER_SIZE + dataBytes);
+		f_close(&file);
+		return 1;
+	}
+	if (f_write(&file, header, WAV_HEADER_SIZE, &bw) != FR_OK || bw != WAV_HEADER_SIZE) {
+		printf("%s: header write error\n", label);
+		return 1;
+	}
+
+	while (done < dataBytes) {
+
+		// recorder.c: writes end on a chunk boundary in the file, and never wrap around the ring
+		uint32_t len = writeSize ? writeSize : chunk - ((WAV_HEADER_SIZE + done) % chunk);
+		uint32_t offset = done % RING_SIZE_BYTES;
+		if (len > dataBytes - done)
+			len = dataBytes - done;
+		if (len > RING_SIZE_BYTES - offset)
+			len = RING_SIZE_BYTES - offset;
+
+		disk_stats_t before = disk;
+		if (f_write(&file, ring + offset, len, &bw) != FR_OK || bw != len) {
+			printf("%s: write error after %u bytes\n", label, done);
+			f_close(&file);
+			return 1;
+		}
+		double ms = cardMs(&before);
+		if (ms > worst)
+			worst = ms;
+		done += len;
+		writes++;
+	}
+
+	// closeFile() of recorder.c
+	f_truncate(&file);
+	if (f_lseek(&file, 0) != FR_OK || f_write(&file, header, WAV_HEADER_SIZE, &bw) != FR_OK || f_close(&file) != FR_OK) {
+		printf("%s: cannot finalize the file\n", label);
+		return 1;
+	}
+
+	double hostS = now() - t0;
+	double card = cardMs(&start);
+	uint64_t cmds = disk.writeCmds - start.writeCmds;
+	uint64_t sectors = disk.writeSectors - start.writeSectors;
+
+	printf("%-10s %8u writes  %7llu cmds  %5.1f sect/cmd  %5llu reads  host %6.0f MB/s  card %7.1f s (%5.1f%% of the audio)  slowest write %6.1f ms\n",
+			label, writes, (unsigned long long) cmds, (double) sectors / cmds, (unsigned long long) (disk.readCmds - start.readCmds),
+			dataBytes / 1e6 / hostS, card / 1000, card / 10 / seconds, worst);
+
+	// read back
+	int errors = 0;
+	if (f_open(&file, "rec0.wav", FA_READ) != FR_OK || f_size(&file) != WAV_HEADER_SIZE + dataBytes
+			|| f_lseek(&file, WAV_HEADER_SIZE) != FR_OK) {
+		printf("%s: wrong file size\n", label);
+		return 1;
+	}
+	for (done = 0; done < dataBytes && !errors; done += bw) {
+		uint32_t len = dataBytes - done < sizeof(check) ? dataBytes - done : sizeof(check);
+		uint32_t offset = done % RING_SIZE_BYTES;
+		if (len > RING_SIZE_BYTES - offset)
+			len = RING_SIZE_BYTES - offset;
+		if (f_read(&file, check, len, &bw) != FR_OK || bw != len || memcmp(check, ring + offset, len)) {
+			printf("%s: data mismatch at %u\n", label, done);
+			errors++;
+		}
+	}
+	f_close(&file);
+	f_unlink("rec0.wav");
+	return errors;
+}
+
+int main(int argc, char **argv) {
+
+	const char *path = "recbench.img";
+	uint32_t diskMB = 4096, clusterBytes = 32768, seconds = 600, rate = 48000;
+	static BYTE work[_MAX_SS * 8];
+	FATFS fs;
+	int opt, errors = 0;
+
+	while ((opt = getopt(argc, argv, "i:S:c:t:r:L:B:")) != -1) {
+		switch (opt) {
+		case 'i': path = optarg; break;
+		case 'S': diskMB = strtoul(optarg, NULL, 0); break;
+		case 'c': clusterBytes = strtoul(optarg, NULL, 0); break;
+		case 't': seconds = strtoul(optarg, NULL, 0); break;
+		case 'r': rate = strtoul(optarg, NULL, 0); break;
+		case 'L': cmdUs = atof(optarg); break;
+		case 'B': mbps = atof(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-i disk.img] [-S MB] [-c CLUSTER] [-t SECONDS] [-r RATE] [-L US] [-B MBPS]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	uint64_t bytes64 = (uint64_t) seconds * rate * 4;
+	if (bytes64 > (uint64_t) diskMB * 1024 * 1024 / 2 || bytes64 > 0xFFFFFFFFu - WAV_HEADER_SIZE) {
+		fprintf(stderr, "recording too long for the disk\n");
+		return 1;
+	}
+	uint32_t dataBytes = (uint32_t) bytes64;
+
+	sectorCount = (DWORD) ((uint64_t) diskMB * 1024 * 1024 / SECTOR);
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, (off_t) sectorCount * SECTOR) != 0) {
+		perror(path);
+		return 1;
+	}
+	if (f_mkfs("", FM_FAT32, clusterBytes, work, sizeof(work)) != FR_OK || f_mount(&fs, "", 1) != FR_OK) {
+		fprintf(stderr, "cannot format %u MB in FAT32 with %u byte clusters\n", diskMB, clusterBytes);
+		return 1;
+	}
+
+	uint8_t *ring = malloc(RING_SIZE_BYTES);
+	fillPattern(ring);
+
+	printf("%u s at %u Hz stereo 16 bit = %u bytes (%u KB/s), %u byte clusters, ring %u ms, card model %.0f us/cmd + %.1f MB/s\n",
+			seconds, rate, dataBytes, rate * 4 / 1024, clusterBytes, (uint32_t) ((uint64_t) RING_SIZE_BYTES * 1000 / (rate * 4)), cmdUs,
+			mbps);
+	errors += run("recorder", dataBytes, 1, 0, clusterBytes, seconds, ring);
+	errors += run("no expand", dataBytes, 0, 0, clusterBytes, seconds, ring);
+	errors += run("per frame", dataBytes, 0, FRAME_BYTES, clusterBytes, seconds, ring);
+
+	f_mount(NULL, "", 0);
+	close(fd);
+	unlink(path);
+	free(ring);
+	return errors != 0;
+}
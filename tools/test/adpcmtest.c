@@ -0,0 +1,156 @@
+/*
+ * adpcmtest.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host test of the IMA-ADPCM codec (Core/Src/adpcm.c), coded by blocks as the audio monitor does (see Core/Src/monitor.c,
+ * the state at the start of each block is sent along with it):
+ * - round trip of a sine and of white noise, against a signal-to-noise ratio bound,
+ * - a decoder starting at any block from the state sent with it reconstructs exactly what the encoder did, whether
+ *   the blocks before it were received or not,
+ * - the step size follows a jump from silence to full scale within a few samples, falls back at one index per sample,
+ *   and stays within the table.
+ *
+ * Build and run: make test, from the parent directory.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "adpcm.h"
+#include "check.h"
+
+#define RATE		48000
+#define BLOCK		256		// TLM_AUDIO_FRAMES
+#define BLOCKS		64
+#define LEN			(BLOCK * BLOCKS)
+
+static int16_t in[LEN], out[LEN];
+static uint8_t codes[LEN];
+static adpcm_state_t blockState[BLOCKS];
+
+/**
+ * Encodes "in" by blocks, keeping the state at the start of each, then decodes it in one go. Returns the SNR, in dB.
+ */
+static double roundTrip(void) {
+
+	adpcm_state_t enc = { 0, 0, 0 }, dec = { 0, 0, 0 };
+	double signal = 0, noise = 0;
+	uint8_t all = 0;
+
+	for (int i = 0; i < LEN; i++) {
+		if (i % BLOCK == 0)
+			blockState[i / BLOCK] = enc;
+		codes[i] = adpcmEncode(&enc, in[i]);
+		all |= codes[i];
+	}
+	CHECK(all < 16);
+	for (int i = 0; i < LEN; i++)
+		out[i] = adpcmDecode(&dec, codes[i]);
+
+	CHECK(memcmp(&enc, &dec, sizeof(enc)) == 0); // in lockstep
+
+	// the first block is the step size ramping up from the initial state
+	for (int i = BLOCK; i < LEN; i++) {
+		signal += (double) in[i] * in[i];
+		noise += (double) (in[i] - out[i]) * (in[i] - out[i]);
+	}
+	return 10 * log10(signal / (noise > 0 ? noise : 1));
+}
+
+/**
+ * Decodes each block from the state sent along with it, in any order, as after lost blocks.
+ */
+static void checkBlocks(void) {
+
+	for (int b = BLOCKS - 1; b >= 0; b -= 3) {
+		adpcm_state_t dec = blockState[b];
+		int same = 1;
+		for (int i = b * BLOCK; i < (b + 1) * BLOCK; i++)
+			same &= adpcmDecode(&dec, codes[i]) == out[i];
+		CHECK(same);
+		if (b + 1 < BLOCKS) // ends where the next block starts
+			CHECK(dec.predictor == blockState[b + 1].predictor && dec.index == blockState[b + 1].index);
+	}
+
+	// without the state, the decoder drifts: that's what the state is sent for
+	adpcm_state_t lost = { 0, 0, 0 };
+	int differ = 0;
+	for (int i = 8 * BLOCK; i < 9 * BLOCK; i++)
+		differ += adpcmDecode(&lost, codes[i]) != out[i];
+	CHECK(differ > BLOCK / 2);
+}
+
+static void testSine(void) {
+
+	for (int i = 0; i < LEN; i++)
+		in[i] = (int16_t) lrint(16000 * sin(2 * M_PI * 1000 * i / RATE));
+
+	double snr = roundTrip();
+	printf("adpcmtest: 1kHz sine at -6dBFS, %.1f dB SNR\n", snr);
+	CHECK(snr > 30);
+	checkBlocks();
+}
+
+static void testNoise(void) {
+
+	uint32_t seed = 12345;
+
+	for (int i = 0; i < LEN; i++) {
+		int32_t sum = 0; // sum of 4 uniforms: roughly Gaussian
+		for (int k = 0; k < 4; k++) {
+			seed = seed * 1664525 + 1013904223;
+			sum += (int32_t) (seed >> 20) - 2048;
+		}
+		in[i] = (int16_t) (sum * 2);
+	}
+
+	double snr = roundTrip(), power = 0;
+	for (int i = 0; i < LEN; i++)
+		power += (double) in[i] * in[i];
+	printf("adpcmtest: white noise at %.1f dBFS RMS, %.1f dB SNR\n", 10 * log10(power / LEN) - 20 * log10(32768), snr);
+	CHECK(snr > 10);
+	checkBlocks();
+}
+
+/**
+ * From silence to full scale and back: the step index climbs to the top of the table, then decays, and stays in range.
+ */
+static void testStepRecovery(void) {
+
+	adpcm_state_t s = { 0, 0, 0 };
+	int i, up = -1, down = -1;
+
+	for (i = 0; i < 64; i++)
+		adpcmEncode(&s, 0);
+	CHECK_EQ(s.index, 0);
+	CHECK_EQ(s.predictor, 0);
+
+	for (i = 0; i < 64; i++) {
+		adpcmEncode(&s, (i / 8) % 2 ? -32768 : 32767);
+		CHECK(s.index <= 88);
+		if (up < 0 && abs(s.predictor) > 30000)
+			up = i;
+	}
+	printf("adpcmtest: full scale reached after %d samples\n", up + 1);
+	CHECK(up >= 0 && up < 16); // about 2 samples per step index doubling
+	CHECK(s.index > 60);
+
+	for (i = 0; i < 256; i++) {
+		adpcmEncode(&s, 0);
+		if (down < 0 && s.index == 0)
+			down = i;
+	}
+	printf("adpcmtest: back to the smallest step after %d samples\n", down + 1);
+	CHECK(down >= 0 && down < 128); // at most 88 steps down, one per sample
+	CHECK(abs(s.predictor) < 16);
+}
+
+int main(void) {
+
+	testSine();
+	testNoise();
+	testStepRecovery();
+	return checkDone("adpcmtest");
+}
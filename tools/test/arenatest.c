@@ -0,0 +1,141 @@
+/*
+ * arenatest.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host test of the tiered arena allocator (Core/Src/arena.c): alignment of the blocks, refusal of the requests that
+ * don't fit (without touching the pool), high-water marks across arenaReset() and arenaInitPool().
+ *
+ * Build and run: make test, from the parent directory.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "arena.h"
+#include "check.h"
+
+#define POOL_SIZE	1024
+
+static uint8_t fast[POOL_SIZE] __attribute__((aligned(64)));
+static uint8_t normal[POOL_SIZE] __attribute__((aligned(64)));
+
+static void testAlignment(void) {
+
+	arenaInitPool(ARENA_FAST, "fast", fast, POOL_SIZE);
+
+	uint8_t *a = arenaAlloc(ARENA_FAST, 1, 1);
+	CHECK(a == fast);
+
+	static const uint32_t aligns[] = { 2, 4, 8, 16, 32, 64 };
+	for (unsigned i = 0; i < sizeof(aligns) / sizeof(aligns[0]); i++) {
+		arenaAlloc(ARENA_FAST, 1, 1); // misaligns the next block
+		uint8_t *p = arenaAlloc(ARENA_FAST, 3, aligns[i]);
+		CHECK(p != NULL);
+		CHECK_EQ((uintptr_t) p % aligns[i], 0);
+	}
+
+	// 0 and non powers of 2 fall back to 4 bytes
+	arenaAlloc(ARENA_FAST, 1, 1);
+	uint8_t *p = arenaAlloc(ARENA_FAST, 1, 0);
+	CHECK_EQ((uintptr_t) p % 4, 0);
+	arenaAlloc(ARENA_FAST, 1, 1);
+	p = arenaAlloc(ARENA_FAST, 1, 24);
+	CHECK_EQ((uintptr_t) p % 4, 0);
+
+	// blocks don't overlap: "used" covers the last block
+	const arena_pool_t *pool = arenaGetPool(ARENA_FAST);
+	CHECK_EQ(pool->used, p + 1 - fast);
+	CHECK_EQ(pool->failures, 0);
+}
+
+static void testExhaustion(void) {
+
+	arenaInitPool(ARENA_FAST, "fast", fast, POOL_SIZE);
+	const arena_pool_t *pool = arenaGetPool(ARENA_FAST);
+
+	CHECK(arenaAlloc(ARENA_FAST, POOL_SIZE + 1, 4) == NULL);
+	CHECK_EQ(pool->failures, 1);
+	CHECK_EQ(pool->used, 0);
+
+	// no wrap-around of the size checks
+	CHECK(arenaAlloc(ARENA_FAST, UINT32_MAX, 4) == NULL);
+	CHECK(arenaAlloc(ARENA_FAST, UINT32_MAX - 2, 4) == NULL);
+	CHECK_EQ(pool->failures, 3);
+
+	CHECK(arenaAlloc(ARENA_FAST, 1000, 4) == fast);
+	CHECK_EQ(pool->used, 1000);
+
+	// fits without the padding, not with it: refused, and the pool is unchanged
+	CHECK(arenaAlloc(ARENA_FAST, 20, 64) == NULL);
+	CHECK_EQ(pool->used, 1000);
+	CHECK_EQ(pool->failures, 4);
+
+	// exactly the rest of the pool
+	CHECK(arenaAlloc(ARENA_FAST, POOL_SIZE - 1000, 4) == fast + 1000);
+	CHECK_EQ(pool->used, POOL_SIZE);
+	CHECK(arenaAlloc(ARENA_FAST, 1, 1) == NULL);
+	CHECK(arenaAlloc(ARENA_FAST, 0, 1) == fast + POOL_SIZE); // an empty block still fits
+	CHECK_EQ(pool->failures, 5);
+
+	// a refusal in one tier leaves the others alone
+	arenaInitPool(ARENA_NORMAL, "normal", normal, POOL_SIZE);
+	CHECK(arenaAlloc(ARENA_NORMAL, 16, 4) == normal);
+	CHECK_EQ(arenaGetPool(ARENA_NORMAL)->failures, 0);
+
+	// a pool without memory, or no pool at all
+	arenaInitPool(ARENA_BULK, "bulk", NULL, POOL_SIZE);
+	CHECK_EQ(arenaGetPool(ARENA_BULK)->size, 0);
+	CHECK(arenaAlloc(ARENA_BULK, 1, 1) == NULL);
+	CHECK(arenaAlloc(ARENA_TIERS, 1, 1) == NULL);
+	CHECK(arenaGetPool(ARENA_TIERS) == NULL);
+}
+
+static void testHighWater(void) {
+
+	arenaInitPool(ARENA_FAST, "fast", fast, POOL_SIZE);
+	arenaInitPool(ARENA_NORMAL, "normal", normal, POOL_SIZE);
+	const arena_pool_t *pool = arenaGetPool(ARENA_FAST);
+
+	arenaAlloc(ARENA_FAST, 100, 4);
+	arenaAlloc(ARENA_FAST, 10, 32); // 128..138
+	CHECK_EQ(pool->used, 138);
+	CHECK_EQ(pool->highWater, 138);
+
+	// a refused request doesn't raise the mark
+	arenaAlloc(ARENA_FAST, POOL_SIZE, 4);
+	CHECK_EQ(pool->highWater, 138);
+
+	// reset empties all the pools, the marks stay
+	arenaAlloc(ARENA_NORMAL, 50, 4);
+	arenaReset();
+	CHECK_EQ(pool->used, 0);
+	CHECK_EQ(pool->highWater, 138);
+	CHECK_EQ(arenaGetPool(ARENA_NORMAL)->used, 0);
+	CHECK_EQ(arenaGetPool(ARENA_NORMAL)->highWater, 50);
+
+	// a smaller chain keeps the mark, a larger one raises it
+	arenaAlloc(ARENA_FAST, 64, 4);
+	CHECK_EQ(pool->highWater, 138);
+	arenaReset();
+	arenaAlloc(ARENA_FAST, 300, 4);
+	CHECK_EQ(pool->highWater, 300);
+	CHECK(arenaAlloc(ARENA_FAST, 0, 1) == fast + 300);
+
+	// a new pool starts over
+	CHECK_EQ(pool->failures, 1);
+	arenaInitPool(ARENA_FAST, "fast", fast, POOL_SIZE / 2);
+	CHECK_EQ(pool->used, 0);
+	CHECK_EQ(pool->highWater, 0);
+	CHECK_EQ(pool->failures, 0);
+	CHECK_EQ(pool->size, POOL_SIZE / 2);
+
+	arenaReport();
+}
+
+int main(void) {
+
+	testAlignment();
+	testExhaustion();
+	testHighWater();
+	return checkDone("arenatest");
+}
@@ -0,0 +1,46 @@
+/*
+ * check.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Minimal assertions shared by the host tests of this directory (see ../Makefile, make test):
+ *
+ * 		CHECK(p != NULL);
+ * 		CHECK_EQ(pool->used, 64);
+ * 		return checkDone("arenatest");
+ *
+ * A failed check prints its location and is counted, the test goes on; checkDone() returns the exit code.
+ */
+
+#ifndef TOOLS_TEST_CHECK_H_
+#define TOOLS_TEST_CHECK_H_
+
+#include <stdio.h>
+
+static int checkFailures = 0;
+static int checkCount = 0;
+
+#define CHECK(cond) do { \
+		checkCount++; \
+		if (!(cond)) { \
+			checkFailures++; \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+#define CHECK_EQ(a, b) do { \
+		long long _a = (long long) (a), _b = (long long) (b); \
+		checkCount++; \
+		if (_a != _b) { \
+			checkFailures++; \
+			fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+		} \
+	} while (0)
+
+static inline int checkDone(const char *name) {
+
+	printf("%s: %d checks, %d failed\n", name, checkCount, checkFailures);
+	return checkFailures ? 1 : 0;
+}
+
+#endif /* TOOLS_TEST_CHECK_H_ */
@@ -0,0 +1,322 @@
+/*
+ * tlmtest.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Loopback test of the telemetry receiver (tlmrecv.c, tlm.c) through a pseudo-terminal, as from a USB-serial adapter:
+ * runs ./tlmrecv on the slave side of a pty and writes COBS/CRC frames to the master side, then checks the CSV and WAV
+ * files tlmrecv wrote and its final link summary.
+ *
+ * The stream holds valid frames of each type, and the cases the decoder must survive: bytes before the first delimiter,
+ * a corrupted payload, a malformed COBS frame, an oversized frame, a valid frame of an unknown version, gaps in the
+ * sequence numbers and in the audio positions, and a frame split over several reads (each part is written once the
+ * previous one has been read, so tlmrecv does get them separately).
+ *
+ * Build and run: make test, from the parent directory (Linux, macOS).
+ */
+
+#define _XOPEN_SOURCE 700	// posix_openpt() and co.
+#define _DEFAULT_SOURCE		// cfmakeraw(), usleep()
+#define _DARWIN_C_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include "tlm.h"
+#include "check.h"
+
+#define TLMRECV		"./tlmrecv"
+#define TICK		1000
+#define DRAIN_MS	5000	// longest wait for tlmrecv to read what was written
+
+typedef struct {
+	int master;
+	int slave;				// kept open, so that the raw mode set below holds until tlmrecv sets its own
+	char csv[64], wav[64], err[64];
+	int16_t pcm[2 * 3 * TLM_AUDIO_FRAMES];	// expected WAV data, stereo: 2 audio frames, a lost one in b/w
+	size_t pcmFrames;
+} test_t;
+
+/**
+ * Waits until tlmrecv has read everything written so far.
+ */
+static int drain(test_t *t) {
+
+	for (int ms = 0; ms < DRAIN_MS; ms++) {
+		int queued = 0;
+		if (ioctl(t->slave, FIONREAD, &queued) == 0 && queued == 0)
+			return 0;
+		usleep(1000);
+	}
+	fprintf(stderr, "tlmtest: tlmrecv doesn't read the pty\n");
+	return -1;
+}
+
+static void put(test_t *t, const uint8_t *data, size_t len) {
+
+	while (len > 0) {
+		ssize_t n = write(t->master, data, len);
+		if (n <= 0) {
+			perror("tlmtest: write");
+			exit(1);
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+/**
+ * Frames "payload" as the firmware does: COBS(payload, CRC) and a delimiter. A non-zero "corrupt" flips a payload byte
+ * after the CRC is computed. Returns the length written to "out".
+ */
+static size_t frame(const void *payload, size_t len, int corrupt, uint8_t *out) {
+
+	uint8_t buf[TLM_MAX_FRAME];
+	uint32_t crc;
+
+	memcpy(buf, payload, len);
+	crc = tlmCrc32(buf, len);
+	memcpy(buf + len, &crc, 4);
+	if (corrupt)
+		buf[len / 2] ^= 0x10;
+
+	size_t n = tlmCobsEncode(buf, len + 4, out);
+	out[n++] = 0;
+	return n;
+}
+
+static void header(tlm_header_t *h, uint8_t type, uint16_t seq) {
+
+	h->type = type;
+	h->version = TLM_VERSION;
+	h->seq = seq;
+	h->tick = TICK + seq;
+}
+
+static void sendMeters(test_t *t, uint16_t seq, float l, float r, int corrupt) {
+
+	tlm_meters_t m;
+	uint8_t out[2 * TLM_MAX_FRAME];
+
+	header(&m.h, TLM_METERS, seq);
+	m.levelL = l;
+	m.levelR = r;
+	put(t, out, frame(&m, sizeof(m), corrupt, out));
+}
+
+/**
+ * Encodes a tone with the firmware encoder (see Core/Src/monitor.c), and keeps the samples the decoder must reconstruct.
+ */
+static void sendAudio(test_t *t, uint16_t seq, uint32_t position, adpcm_state_t state[2]) {
+
+	tlm_audio_t a;
+	uint8_t out[2 * TLM_MAX_FRAME];
+
+	memset(&a, 0, sizeof(a));
+	header(&a.h, TLM_AUDIO, seq);
+	a.sampleRate = 16000;
+	a.position = position;
+	a.frames = TLM_AUDIO_FRAMES;
+	a.channels = 2;
+	a.state[0] = state[0];
+	a.state[1] = state[1];
+
+	if (position > t->pcmFrames)
+		t->pcmFrames = position; // silence in the gap, already zero
+
+	for (int i = 0; i < TLM_AUDIO_FRAMES; i++) {
+		int16_t l = (int16_t) ((((position + i) * 97) % 2000) * 8 - 8000);	// sawtooth
+		int16_t r = (int16_t) (((position + i) / 32 % 2) ? 12000 : -12000);	// square
+		a.data[i] = adpcmEncode(&state[0], l) | (adpcmEncode(&state[1], r) << 4);
+		t->pcm[2 * t->pcmFrames] = state[0].predictor;
+		t->pcm[2 * t->pcmFrames + 1] = state[1].predictor;
+		t->pcmFrames++;
+	}
+
+	put(t, out, frame(&a, TLM_AUDIO_LEN(a.frames), 0, out));
+}
+
+static pid_t startReceiver(test_t *t) {
+
+	struct termios tio;
+	char *path;
+
+	if ((t->master = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(t->master) || unlockpt(t->master)
+			|| (path = ptsname(t->master)) == NULL || (t->slave = open(path, O_RDWR | O_NOCTTY)) < 0) {
+		perror("tlmtest: pty");
+		exit(1);
+	}
+	// tlmrecv must hold the only copy of the slave side, and none of the master side: closing it then hangs the line up
+	fcntl(t->master, F_SETFD, FD_CLOEXEC);
+	fcntl(t->slave, F_SETFD, FD_CLOEXEC);
+
+	// raw until tlmrecv sets it: no line editing of the zeros, no echo
+	tcgetattr(t->slave, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(t->slave, TCSANOW, &tio);
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		int err = open(t->err, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		int null = open("/dev/null", O_WRONLY);
+		dup2(err, 2);
+		dup2(null, 1);
+		close(err);
+		close(null);
+		execl(TLMRECV, TLMRECV, path, "-q", "-o", t->csv, "-w", t->wav, (char*) NULL);
+		perror(TLMRECV);
+		_exit(127);
+	}
+	return pid;
+}
+
+static char* readFile(const char *path, size_t *size) {
+
+	FILE *f = fopen(path, "rb");
+	char *buf = NULL;
+	long n;
+
+	if (f == NULL || fseek(f, 0, SEEK_END) || (n = ftell(f)) < 0 || fseek(f, 0, SEEK_SET)
+			|| (buf = calloc(1, n + 1)) == NULL || fread(buf, 1, n, f) != (size_t) n) {
+		perror(path);
+		exit(1);
+	}
+	fclose(f);
+	if (size)
+		*size = n;
+	return buf;
+}
+
+int main(void) {
+
+	static test_t t;
+	uint8_t out[2 * TLM_MAX_FRAME];
+	adpcm_state_t state[2] = { { 0, 0, 0 }, { 0, 0, 0 } };
+	char dir[] = "/tmp/tlmtestXXXXXX";
+	size_t n;
+
+	signal(SIGPIPE, SIG_IGN);
+	alarm(30); // rather than hanging if tlmrecv never exits
+	if (mkdtemp(dir) == NULL) {
+		perror("tlmtest: mkdtemp");
+		return 1;
+	}
+	snprintf(t.csv, sizeof(t.csv), "%s/out.csv", dir);
+	snprintf(t.wav, sizeof(t.wav), "%s/out.wav", dir);
+	snprintf(t.err, sizeof(t.err), "%s/err.txt", dir);
+
+	pid_t pid = startReceiver(&t);
+
+	// the tail of a frame: the receiver starts in the middle of the stream (1 CRC error)
+	static const uint8_t tail[] = { 0x12, 0x34, 0x56, 0 };
+	put(&t, tail, sizeof(tail));
+
+	sendMeters(&t, 0, 0.5f, 0.25f, 0);
+	sendMeters(&t, 1, 0.5f, 0.25f, 1); // corrupted (1 CRC error, seq 1 lost)
+
+	// a timing frame split over 3 reads: in the middle of the header, and right before the delimiter
+	tlm_timing_t tm;
+	header(&tm.h, TLM_TIMING, 2);
+	tm.cpuHz = 216000000;
+	tm.frameCycles = 100000;
+	tm.frameCyclesMax = 150000;
+	tm.periodCycles = 2160000;
+	tm.wakeCyclesMax = 2160;
+	tm.lateFrames = 1;
+	tm.marginWarnings = 2;
+	tm.slips = 3;
+	tm.missedWakeups = 4;
+	n = frame(&tm, sizeof(tm), 0, out);
+	drain(&t);
+	put(&t, out, 3);
+	drain(&t);
+	put(&t, out + 3, n - 4);
+	drain(&t);
+	put(&t, out + n - 1, 1);
+
+	// malformed COBS: the code points past the delimiter (1 CRC error)
+	static const uint8_t cobs[] = { 0x05, 0x11, 0x22, 0 };
+	put(&t, cobs, sizeof(cobs));
+
+	// longer than TLM_MAX_FRAME (1 CRC error)
+	memset(out, 0x55, TLM_MAX_FRAME + 100);
+	out[TLM_MAX_FRAME + 100] = 0;
+	put(&t, out, TLM_MAX_FRAME + 101);
+
+	// valid CRC, unknown version (1 bad frame, seq 3 and 4 lost)
+	tlm_meters_t m;
+	header(&m.h, TLM_METERS, 3);
+	m.h.version = TLM_VERSION + 1;
+	m.levelL = m.levelR = 0;
+	put(&t, out, frame(&m, sizeof(m), 0, out));
+
+	sendMeters(&t, 5, 1.0f, 0.125f, 0);
+
+	// audio, with a lost frame (seq 7) in the middle, filled with silence
+	sendAudio(&t, 6, 0, state);
+	for (int i = 0; i < TLM_AUDIO_FRAMES; i++) { // encoded but lost
+		adpcmEncode(&state[0], 0);
+		adpcmEncode(&state[1], 0);
+	}
+	sendAudio(&t, 8, 2 * TLM_AUDIO_FRAMES, state);
+
+	// back-to-back delimiters are ignored
+	static const uint8_t zeros[] = { 0, 0, 0 };
+	put(&t, zeros, sizeof(zeros));
+
+	CHECK(drain(&t) == 0);
+	close(t.master); // tlmrecv reads EIO and exits
+
+	int status;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	close(t.slave);
+
+	// link summary: the last line
+	char *err = readFile(t.err, NULL);
+	char *last = err + strlen(err);
+	while (last > err && last[-1] == '\n')
+		*--last = 0;
+	while (last > err && last[-1] != '\n')
+		last--;
+	unsigned long frames = 0, crcErrors = 0, bad = 0, lost = 0;
+	CHECK(sscanf(last, "tlmrecv: %lu frames, %lu CRC errors, %lu bad, %lu lost", &frames, &crcErrors, &bad, &lost) == 4);
+	CHECK_EQ(frames, 5);
+	CHECK_EQ(crcErrors, 4);
+	CHECK_EQ(bad, 1);
+	CHECK_EQ(lost, 4);
+
+	char *csv = readFile(t.csv, NULL);
+	const char *expected = "1000,0,meters,0.5,0.25\n"
+			"1002,2,timing,216000000,100000,150000,2160000,2160,1,2,3,4\n"
+			"1005,5,meters,1,0.125\n";
+	CHECK(strcmp(csv, expected) == 0);
+	if (strcmp(csv, expected))
+		fprintf(stderr, "tlmtest: CSV:\n%s", csv);
+
+	size_t size;
+	char *wav = readFile(t.wav, &size);
+	uint32_t rate, dataLen;
+	memcpy(&rate, wav + 24, 4);
+	memcpy(&dataLen, wav + 40, 4);
+	CHECK(memcmp(wav, "RIFF", 4) == 0 && memcmp(wav + 36, "data", 4) == 0);
+	CHECK_EQ(rate, 16000);
+	CHECK_EQ(t.pcmFrames, 3 * TLM_AUDIO_FRAMES);
+	CHECK_EQ(dataLen, 4 * t.pcmFrames);
+	CHECK_EQ(size, 44 + 4 * t.pcmFrames);
+	CHECK(size == 44 + 4 * t.pcmFrames && memcmp(wav + 44, t.pcm, 4 * t.pcmFrames) == 0);
+
+	free(err);
+	free(csv);
+	free(wav);
+	unlink(t.csv);
+	unlink(t.wav);
+	unlink(t.err);
+	rmdir(dir);
+	return checkDone("tlmtest");
+}
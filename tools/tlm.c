@@ -0,0 +1,171 @@
+/*
+ * tlm.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side decoder of the firmware telemetry stream, see tlm.h.
+ */
+
+#include "tlm.h"
+#include <string.h>
+
+void tlmInit(tlm_decoder_t *d, tlm_callback_t cb, void *user) {
+
+	memset(d, 0, sizeof(*d));
+	d->cb = cb;
+	d->user = user;
+}
+
+/**
+ * Same as the CRC unit configured by MX_CRC_Init() (CRC-32/MPEG-2): polynomial 0x04C11DB7, initial value 0xFFFFFFFF,
+ * MSB first, no reflection, no final XOR.
+ */
+uint32_t tlmCrc32(const uint8_t *data, size_t len) {
+
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= (uint32_t) data[i] << 24;
+		for (int b = 0; b < 8; b++)
+			crc = crc & 0x80000000 ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * Decodes one COBS frame (delimiter excluded) into "out" (at most len - 1 bytes). Returns the decoded length,
+ * 0 if the frame is malformed.
+ */
+size_t tlmCobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+
+	size_t i = 0, o = 0;
+
+	while (i < len) {
+		uint8_t code = in[i++];
+		if (code == 0 || i + code - 1 > len)
+			return 0;
+		for (int k = 1; k < code; k++) {
+			if (in[i] == 0)
+				return 0;
+			out[o++] = in[i++];
+		}
+		if (code != 0xFF && i < len)
+			out[o++] = 0;
+	}
+	return o;
+}
+
+/**
+ * Same encoding as the firmware (for tests): at most len + len / 254 + 1 bytes, no delimiter.
+ */
+size_t tlmCobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+
+	size_t code = 0, o = 1;
+
+	out[0] = 1;
+	for (size_t i = 0; i < len; i++) {
+		if (in[i] == 0) {
+			out[code] = (uint8_t) (o - code);
+			code = o++;
+			out[code] = 1;
+		}
+		else {
+			out[o++] = in[i];
+			if (o - code == 0xFF) {
+				out[code] = 0xFF;
+				code = o++;
+				out[code] = 1;
+			}
+		}
+	}
+	out[code] = (uint8_t) (o - code);
+	return o;
+}
+
+/**
+ * Decodes the frames of "a" into interleaved stereo samples (2 * a->frames).
+ */
+void tlmAudioDecode(const tlm_audio_t *a, int16_t *out) {
+
+	adpcm_state_t l = a->state[0], r = a->state[1];
+
+	for (int i = 0; i < a->frames; i++) {
+		*out++ = adpcmDecode(&l, a->data[i] & 0x0F);
+		*out++ = adpcmDecode(&r, a->data[i] >> 4);
+	}
+}
+
+static size_t expectedLength(const tlm_header_t *h, size_t len) {
+
+	switch (h->type) {
+	case TLM_METERS:
+		return sizeof(tlm_meters_t);
+	case TLM_SPECTRUM:
+		return sizeof(tlm_spectrum_t);
+	case TLM_TIMING:
+		return sizeof(tlm_timing_t);
+	case TLM_AUDIO: {
+		const tlm_audio_t *a = (const tlm_audio_t*) h;
+		if (len < TLM_AUDIO_LEN(0) || a->frames > TLM_AUDIO_FRAMES || a->channels != 2)
+			return 0;
+		return TLM_AUDIO_LEN(a->frames);
+	}
+	default:
+		return 0;
+	}
+}
+
+static void endOfFrame(tlm_decoder_t *d) {
+
+	uint8_t frame[TLM_MAX_FRAME];
+	size_t n;
+	uint32_t crc;
+
+	if (d->len == 0)
+		return; // back-to-back delimiters
+	if (d->overflow || (n = tlmCobsDecode(d->buf, d->len, frame)) < sizeof(tlm_header_t) + 4) {
+		d->crcErrors++;
+		return;
+	}
+
+	n -= 4;
+	memcpy(&crc, frame + n, 4);
+	if (crc != tlmCrc32(frame, n)) {
+		d->crcErrors++;
+		return;
+	}
+
+	const tlm_header_t *h = (const tlm_header_t*) frame;
+	if (h->version != TLM_VERSION || n != expectedLength(h, n)) {
+		d->badFrames++;
+		return;
+	}
+
+	if (d->synced && h->seq != d->nextSeq)
+		d->lost += (uint16_t) (h->seq - d->nextSeq);
+	d->nextSeq = h->seq + 1;
+	d->synced = 1;
+	d->frames++;
+
+	if (d->cb)
+		d->cb(h, n, d->user);
+}
+
+/**
+ * Feeds received bytes, in any chunks. The bytes before the first delimiter are a partial frame, counted as a CRC error
+ * unless the stream starts on a frame boundary.
+ */
+void tlmFeed(tlm_decoder_t *d, const uint8_t *data, size_t len) {
+
+	for (size_t i = 0; i < len; i++) {
+		if (data[i] == 0) {
+			endOfFrame(d);
+			d->len = 0;
+			d->overflow = 0;
+		}
+		else if (d->len < TLM_MAX_FRAME)
+			d->buf[d->len++] = data[i];
+		else
+			d->overflow = 1;
+	}
+}
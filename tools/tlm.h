@@ -0,0 +1,100 @@
+/*
+ * tlm.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side decoder of the firmware telemetry stream (see Core/Src/telemetry.c): COBS frames delimited by 0x00,
+ * each a payload followed by its CRC-32/MPEG-2. Feed the received bytes to tlmFeed(), which calls back for each valid frame.
+ * Frame layouts must match Core/Inc/telemetry.h and Core/Inc/monitor.h (little-endian host assumed).
+ * The ADPCM decoder is the firmware one (Core/Src/adpcm.c).
+ */
+
+#ifndef TLM_H_
+#define TLM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "adpcm.h"
+
+#define TLM_VERSION			1
+#define TLM_SPECTRUM_BINS	32
+#define TLM_MAX_FRAME		512
+
+#define TLM_METERS			1
+#define TLM_SPECTRUM		2
+#define TLM_TIMING			3
+#define TLM_AUDIO			4
+
+#define TLM_AUDIO_FRAMES	256
+
+typedef struct __attribute__((packed)) {
+	uint8_t type;
+	uint8_t version;
+	uint16_t seq;
+	uint32_t tick;
+} tlm_header_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	float levelL;
+	float levelR;
+} tlm_meters_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	uint32_t sampleRate;
+	float bins[TLM_SPECTRUM_BINS];
+} tlm_spectrum_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	uint32_t cpuHz;
+	uint32_t frameCycles;
+	uint32_t frameCyclesMax;
+	uint32_t periodCycles;
+	uint32_t wakeCyclesMax;
+	uint32_t lateFrames;
+	uint32_t marginWarnings;
+	uint32_t slips;
+	uint32_t missedWakeups;
+} tlm_timing_t;
+
+typedef struct __attribute__((packed)) {
+	tlm_header_t h;
+	uint32_t sampleRate;
+	uint32_t position;
+	uint16_t frames;
+	uint8_t channels;
+	uint8_t reserved;
+	adpcm_state_t state[2];
+	uint8_t data[TLM_AUDIO_FRAMES];
+} tlm_audio_t;
+
+#define TLM_AUDIO_LEN(frames)	(offsetof(tlm_audio_t, data) + (frames))
+
+typedef void (*tlm_callback_t)(const tlm_header_t *frame, size_t len, void *user);
+
+typedef struct {
+	uint8_t buf[TLM_MAX_FRAME];
+	size_t len;
+	int overflow;
+	uint16_t nextSeq;
+	int synced;
+	// statistics:
+	unsigned long frames;		// valid frames
+	unsigned long crcErrors;	// including COBS errors
+	unsigned long badFrames;	// valid CRC, but unknown type or version, or wrong length
+	unsigned long lost;			// gaps in the sequence numbers
+	tlm_callback_t cb;
+	void *user;
+} tlm_decoder_t;
+
+void tlmInit(tlm_decoder_t *d, tlm_callback_t cb, void *user);
+void tlmFeed(tlm_decoder_t *d, const uint8_t *data, size_t len);
+
+uint32_t tlmCrc32(const uint8_t *data, size_t len);
+size_t tlmCobsDecode(const uint8_t *in, size_t len, uint8_t *out);
+size_t tlmCobsEncode(const uint8_t *in, size_t len, uint8_t *out);
+void tlmAudioDecode(const tlm_audio_t *a, int16_t *out);
+
+#endif /* TLM_H_ */
@@ -0,0 +1,325 @@
+/*
+ * tlmrecv.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side receiver of the firmware telemetry stream (see Core/Src/telemetry.c), e.g. through a 3.3V USB-serial
+ * adapter on Arduino D1 (TX) and GND.
+ *
+ * Build (Linux, macOS):
+ * 		cc -O2 -Wall -I../F746disco-audio-processing-RTOS/Core/Inc -o tlmrecv tlmrecv.c tlm.c ../F746disco-audio-processing-RTOS/Core/Src/adpcm.c
+ *
+ * Run:
+ * 		tlmrecv /dev/ttyUSB0 [-b baud] [-o file.csv] [-w file.wav] [-q]
+ *
+ * 		Prints the meters and timing frames (and a coarse spectrum) as they come, and a link summary every second:
+ * 		frames received, CRC errors and frames lost. -o also records every frame but the audio ones to a CSV file,
+ * 		one line per frame: "tick,seq,type,values...". -w decodes the audio monitor frames (see Core/Src/monitor.c)
+ * 		into a 16-bit stereo WAV file, with silence in place of the lost frames; a sampling rate change starts a new
+ * 		file (file-1.wav...). -q prints the summary only. The default baud rate is TELEMETRY_BAUD.
+ * 		The port can also be a file holding a raw capture of the stream. Stops at the end of the file, or on Ctrl-C.
+ */
+
+#include "tlm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <signal.h>
+
+#define DEFAULT_BAUD	2000000		// must match TELEMETRY_BAUD in Core/Inc/telemetry.h
+
+#define MAX_GAP_SECONDS	10	// longer gaps in the audio are not filled with silence
+
+typedef struct {
+	FILE *csv;
+	int quiet;
+	// audio monitor:
+	const char *wavPath;
+	FILE *wav;
+	int wavCount;				// files created so far
+	uint32_t wavRate;
+	uint32_t wavFrames;			// frames written to the current file
+	uint32_t nextPosition;		// position expected in the next audio frame
+} context_t;
+
+static volatile sig_atomic_t stop = 0;
+
+static void onSignal(int sig) {
+
+	(void) sig;
+	stop = 1;
+}
+
+static void put16(FILE *f, uint16_t v) {
+
+	fputc(v & 0xFF, f);
+	fputc(v >> 8, f);
+}
+
+static void put32(FILE *f, uint32_t v) {
+
+	put16(f, v & 0xFFFF);
+	put16(f, v >> 16);
+}
+
+/**
+ * Canonical 44 bytes header of a 16-bit stereo WAV file.
+ */
+static void wavHeader(FILE *f, uint32_t rate, uint32_t frames) {
+
+	fseek(f, 0, SEEK_SET);
+	fwrite("RIFF", 1, 4, f);
+	put32(f, 36 + 4 * frames);
+	fwrite("WAVEfmt ", 1, 8, f);
+	put32(f, 16);
+	put16(f, 1);			// PCM
+	put16(f, 2);			// channels
+	put32(f, rate);
+	put32(f, 4 * rate);		// bytes per second
+	put16(f, 4);			// bytes per frame
+	put16(f, 16);			// bits per sample
+	fwrite("data", 1, 4, f);
+	put32(f, 4 * frames);
+}
+
+static void wavClose(context_t *c) {
+
+	if (c->wav == NULL)
+		return;
+	wavHeader(c->wav, c->wavRate, c->wavFrames);
+	fclose(c->wav);
+	c->wav = NULL;
+}
+
+static int wavOpen(context_t *c, uint32_t rate) {
+
+	char path[1024];
+	const char *dot = strrchr(c->wavPath, '.');
+
+	if (c->wavCount == 0 || dot == NULL)
+		snprintf(path, sizeof(path), "%s", c->wavPath);
+	else
+		snprintf(path, sizeof(path), "%.*s-%d%s", (int) (dot - c->wavPath), c->wavPath, c->wavCount, dot);
+	if ((c->wav = fopen(path, "wb")) == NULL) {
+		perror(path);
+		return -1;
+	}
+	c->wavCount++;
+	c->wavRate = rate;
+	c->wavFrames = 0;
+	wavHeader(c->wav, rate, 0);
+	fprintf(stderr, "tlmrecv: writing %s (%u Hz)\n", path, rate);
+	return 0;
+}
+
+static void writeAudio(context_t *c, const tlm_audio_t *a) {
+
+	static const int16_t silence[2 * TLM_AUDIO_FRAMES] = { 0 };
+	int16_t pcm[2 * TLM_AUDIO_FRAMES];
+
+	if (c->wav && (a->sampleRate != c->wavRate || a->position < c->nextPosition))
+		wavClose(c); // new rate, or the firmware restarted the monitor
+	if (c->wav == NULL) {
+		if (wavOpen(c, a->sampleRate) < 0)
+			return;
+	}
+	else if (a->position > c->nextPosition && a->position - c->nextPosition < MAX_GAP_SECONDS * a->sampleRate) {
+		for (uint32_t gap = a->position - c->nextPosition; gap;) {
+			uint32_t n = gap > TLM_AUDIO_FRAMES ? TLM_AUDIO_FRAMES : gap;
+			fwrite(silence, 4, n, c->wav);
+			c->wavFrames += n;
+			gap -= n;
+		}
+	}
+
+	tlmAudioDecode(a, pcm);
+	fwrite(pcm, 4, a->frames, c->wav);
+	c->wavFrames += a->frames;
+	c->nextPosition = a->position + a->frames;
+}
+
+/**
+ * The non-standard rates (1000000, 2000000) are only defined on Linux.
+ */
+static speed_t toSpeed(long baud) {
+
+	switch (baud) {
+	case 115200:
+		return B115200;
+	case 230400:
+		return B230400;
+#ifdef B460800
+	case 460800:
+		return B460800;
+#endif
+#ifdef B921600
+	case 921600:
+		return B921600;
+#endif
+#ifdef B1000000
+	case 1000000:
+		return B1000000;
+#endif
+#ifdef B2000000
+	case 2000000:
+		return B2000000;
+#endif
+	default:
+		return (speed_t) baud; // macOS accepts any value
+	}
+}
+
+static int openPort(const char *path, long baud) {
+
+	struct termios t;
+	int fd = open(path, O_RDONLY | O_NOCTTY);
+
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	if (tcgetattr(fd, &t) == 0) {
+		cfmakeraw(&t);
+		t.c_cflag |= CLOCAL | CREAD;
+		t.c_cc[VMIN] = 1;
+		t.c_cc[VTIME] = 0;
+		if (cfsetispeed(&t, toSpeed(baud)) != 0 || tcsetattr(fd, TCSANOW, &t) != 0)
+			fprintf(stderr, "%s: cannot set %ld baud, using the current setting\n", path, baud);
+	}
+	return fd;
+}
+
+static void onFrame(const tlm_header_t *h, size_t len, void *user) {
+
+	context_t *c = user;
+
+	(void) len; // checked by tlmFeed()
+	switch (h->type) {
+
+	case TLM_METERS: {
+		const tlm_meters_t *m = (const tlm_meters_t*) h;
+		if (!c->quiet)
+			printf("%10u meters   L %.4f  R %.4f\n", h->tick, m->levelL, m->levelR);
+		if (c->csv)
+			fprintf(c->csv, "%u,%u,meters,%g,%g\n", h->tick, h->seq, m->levelL, m->levelR);
+		break;
+	}
+
+	case TLM_SPECTRUM: {
+		const tlm_spectrum_t *s = (const tlm_spectrum_t*) h;
+		if (!c->quiet) {
+			// one character per bin
+			static const char shades[] = " .:-=+*#%@";
+			float max = 1e-9f;
+			char line[TLM_SPECTRUM_BINS + 1];
+			for (int i = 0; i < TLM_SPECTRUM_BINS; i++)
+				if (s->bins[i] > max)
+					max = s->bins[i];
+			for (int i = 0; i < TLM_SPECTRUM_BINS; i++)
+				line[i] = shades[(int) (s->bins[i] / max * (sizeof(shades) - 2))];
+			line[TLM_SPECTRUM_BINS] = 0;
+			printf("%10u spectrum |%s| %u Hz, max %g\n", h->tick, line, s->sampleRate, max);
+		}
+		if (c->csv) {
+			fprintf(c->csv, "%u,%u,spectrum,%u", h->tick, h->seq, s->sampleRate);
+			for (int i = 0; i < TLM_SPECTRUM_BINS; i++)
+				fprintf(c->csv, ",%g", s->bins[i]);
+			fprintf(c->csv, "\n");
+		}
+		break;
+	}
+
+	case TLM_AUDIO:
+		if (c->wavPath)
+			writeAudio(c, (const tlm_audio_t*) h);
+		break;
+
+	case TLM_TIMING: {
+		const tlm_timing_t *t = (const tlm_timing_t*) h;
+		if (!c->quiet)
+			printf("%10u timing   frame %.1f%% (max %.1f%%), wake max %.1f us, late %u, margin %u, slips %u, missed %u\n",
+					h->tick, t->periodCycles ? 100.0 * t->frameCycles / t->periodCycles : 0.0,
+					t->periodCycles ? 100.0 * t->frameCyclesMax / t->periodCycles : 0.0,
+					t->cpuHz ? 1e6 * t->wakeCyclesMax / t->cpuHz : 0.0, t->lateFrames, t->marginWarnings, t->slips, t->missedWakeups);
+		if (c->csv)
+			fprintf(c->csv, "%u,%u,timing,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", h->tick, h->seq, t->cpuHz, t->frameCycles,
+					t->frameCyclesMax, t->periodCycles, t->wakeCyclesMax, t->lateFrames, t->marginWarnings, t->slips, t->missedWakeups);
+		break;
+	}
+	}
+}
+
+int main(int argc, char **argv) {
+
+	const char *port = NULL, *csvPath = NULL;
+	long baud = DEFAULT_BAUD;
+	context_t ctx;
+	tlm_decoder_t dec;
+	uint8_t buf[4096];
+	time_t last = time(NULL);
+	unsigned long lastFrames = 0;
+	struct sigaction sa;
+	int fd;
+
+	memset(&ctx, 0, sizeof(ctx));
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			baud = strtol(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			csvPath = argv[++i];
+		else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			ctx.wavPath = argv[++i];
+		else if (strcmp(argv[i], "-q") == 0)
+			ctx.quiet = 1;
+		else if (argv[i][0] != '-' && port == NULL)
+			port = argv[i];
+		else
+			port = NULL, i = argc;
+	}
+	if (port == NULL) {
+		fprintf(stderr, "usage: tlmrecv port [-b baud] [-o file.csv] [-w file.wav] [-q]\n");
+		return 1;
+	}
+
+	if (csvPath && (ctx.csv = fopen(csvPath, "w")) == NULL) {
+		perror(csvPath);
+		return 1;
+	}
+	if ((fd = openPort(port, baud)) < 0)
+		return 1;
+
+	// no SA_RESTART: Ctrl-C interrupts read(), so that the WAV file gets its final header
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	tlmInit(&dec, onFrame, &ctx);
+
+	while (!stop) {
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n <= 0)
+			break; // port closed, end of file or Ctrl-C
+		tlmFeed(&dec, buf, (size_t) n);
+
+		time_t now = time(NULL);
+		if (now != last) {
+			fprintf(stderr, "tlmrecv: %lu frames/s, %lu frames, %lu CRC errors, %lu bad, %lu lost\n",
+					(dec.frames - lastFrames) / (unsigned long) (now - last), dec.frames, dec.crcErrors, dec.badFrames, dec.lost);
+			last = now;
+			lastFrames = dec.frames;
+		}
+		fflush(stdout);
+	}
+
+	fprintf(stderr, "tlmrecv: %lu frames, %lu CRC errors, %lu bad, %lu lost\n", dec.frames, dec.crcErrors, dec.badFrames, dec.lost);
+	if (ctx.csv)
+		fclose(ctx.csv);
+	wavClose(&ctx);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * trace2json.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host-side decoder of the event trace dumped on the VCP by the firmware (see Core/Src/trace.c): converts it to the
+ * Chrome trace event format (JSON), which both chrome://tracing and https://ui.perfetto.dev open.
+ *
+ * Build (any host):
+ * 		cc -O2 -Wall -o trace2json trace2json.c
+ *
+ * Run on a capture of the VCP output (other lines are ignored; if it holds several dumps, the last one is converted):
+ * 		trace2json capture.log > trace.json
+ *
+ * 		Each task gets its own row, with a slice for each time it ran. The SAI callbacks and marks (late frames,
+ * 		missed wake-ups) are instant events, and the processing stages of the audio task (frame, effects, FFT)
+ * 		are nested slices on the "audio stages" row.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// must match Core/Inc/trace.h:
+#define TRACE_TASK_IN		1
+#define TRACE_TASK_OUT		2
+#define TRACE_IRQ			3
+#define TRACE_BEGIN			4
+#define TRACE_END			5
+#define TRACE_MARK			6
+
+#define TRACE_STAGE_FRAME	0
+#define TRACE_STAGE_EFFECT	1
+#define TRACE_STAGE_FFT		2
+
+#define TRACE_MARK_XRUN		0
+#define TRACE_MARK_MISSED	1
+
+// must match effect_id_t in Core/Inc/audio.h:
+static const char *effectNames[] = { "none", "echo", "noise gate" };
+
+#define LINE_LEN		256
+#define MAX_TASKS		256
+#define TID_IRQ			1000
+#define TID_STAGES		1001
+
+typedef struct {
+	uint32_t cycles;
+	unsigned type, id, arg;
+} record_t;
+
+static char taskNames[MAX_TASKS][32];
+static record_t *records = NULL;
+static size_t recordCount = 0, recordMax = 0;
+static unsigned long clockHz = 216000000;
+
+static int first = 1;
+
+/**
+ * Starts a new event object: "ph" is the phase, "tid" the row, "us" the timestamp.
+ */
+static void event(const char *ph, int tid, double us) {
+
+	printf("%s\n{\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", first ? "" : ",", ph, tid, us);
+	first = 0;
+}
+
+static void addRecord(const record_t *r) {
+
+	if (recordCount == recordMax) {
+		recordMax = recordMax ? 2 * recordMax : 4096;
+		records = realloc(records, recordMax * sizeof(record_t));
+		if (records == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	records[recordCount++] = *r;
+}
+
+static const char* stageName(unsigned id, unsigned arg, char *buf, size_t len) {
+
+	switch (id) {
+	case TRACE_STAGE_FRAME:
+		return "frame";
+	case TRACE_STAGE_FFT:
+		return "fft";
+	case TRACE_STAGE_EFFECT:
+		if (arg < sizeof(effectNames) / sizeof(effectNames[0]))
+			return effectNames[arg];
+		snprintf(buf, len, "effect %u", arg);
+		return buf;
+	default:
+		snprintf(buf, len, "stage %u", id);
+		return buf;
+	}
+}
+
+int main(int argc, char **argv) {
+
+	char line[LINE_LEN];
+	int inDump = 0, found = 0;
+	FILE *f;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: trace2json capture.log > trace.json\n");
+		return 1;
+	}
+	if ((f = fopen(argv[1], "r")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+
+		record_t r;
+		unsigned number;
+		char name[32];
+
+		if (strncmp(line, "TRACE BEGIN", 11) == 0) {
+			// keep the last dump only
+			inDump = 1;
+			recordCount = 0;
+			memset(taskNames, 0, sizeof(taskNames));
+			sscanf(line + 11, "%lu", &clockHz);
+		}
+		else if (!inDump)
+			continue;
+		else if (strncmp(line, "TRACE END", 9) == 0) {
+			inDump = 0;
+			found = 1;
+		}
+		else if (sscanf(line, "TASK %u %31[^\r\n]", &number, name) == 2 && number < MAX_TASKS)
+			snprintf(taskNames[number], sizeof(taskNames[number]), "%s", name);
+		else if (sscanf(line, "R %x %x %x %x", &r.cycles, &r.type, &r.id, &r.arg) == 4)
+			addRecord(&r);
+	}
+	fclose(f);
+
+	if (!found) {
+		fprintf(stderr, "%s: no complete trace dump (TRACE BEGIN ... TRACE END)\n", argv[1]);
+		return 1;
+	}
+	if (clockHz == 0)
+		clockHz = 216000000;
+
+	printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+	// row names:
+	for (int t = 0; t < MAX_TASKS; t++)
+		if (taskNames[t][0]) {
+			event("M", t, 0);
+			printf(",\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}", taskNames[t]);
+		}
+	event("M", TID_IRQ, 0);
+	printf(",\"name\":\"thread_name\",\"args\":{\"name\":\"interrupts\"}}");
+	event("M", TID_STAGES, 0);
+	printf(",\"name\":\"thread_name\",\"args\":{\"name\":\"audio stages\"}}");
+
+	// the ring may start in the middle of a slice: ends without a beginning are dropped
+	static uint8_t running[MAX_TASKS];
+	int stageDepth = 0;
+	uint64_t t = 0;
+	char buf[32];
+
+	for (size_t i = 0; i < recordCount; i++) {
+
+		record_t *r = &records[i];
+
+		// the records are in chronological order, the 32-bit cycle counter wraps around every ~20s
+		if (i > 0)
+			t += (uint32_t) (r->cycles - records[i - 1].cycles);
+		double us = (double) t * 1e6 / clockHz;
+
+		switch (r->type) {
+		case TRACE_TASK_IN:
+			if (r->id < MAX_TASKS && !running[r->id]) {
+				running[r->id] = 1;
+				event("B", r->id, us);
+				printf(",\"name\":\"%s\"}", taskNames[r->id][0] ? taskNames[r->id] : "task");
+			}
+			break;
+		case TRACE_TASK_OUT:
+			if (r->id < MAX_TASKS && running[r->id]) {
+				running[r->id] = 0;
+				event("E", r->id, us);
+				printf("}");
+			}
+			break;
+		case TRACE_IRQ:
+			event("i", TID_IRQ, us);
+			printf(",\"s\":\"t\",\"name\":\"SAI RX %s\"}", r->arg ? "full" : "half");
+			break;
+		case TRACE_BEGIN:
+			stageDepth++;
+			event("B", TID_STAGES, us);
+			printf(",\"name\":\"%s\"}", stageName(r->id, r->arg, buf, sizeof(buf)));
+			break;
+		case TRACE_END:
+			if (stageDepth > 0) {
+				stageDepth--;
+				event("E", TID_STAGES, us);
+				printf("}");
+			}
+			break;
+		case TRACE_MARK:
+			event("i", TID_STAGES, us);
+			if (r->id == TRACE_MARK_XRUN)
+				printf(",\"s\":\"g\",\"name\":\"late frame #%u\"}", r->arg);
+			else if (r->id == TRACE_MARK_MISSED)
+				printf(",\"s\":\"g\",\"name\":\"missed wake-up #%u\"}", r->arg);
+			else
+				printf(",\"s\":\"g\",\"name\":\"mark %u (%u)\"}", r->id, r->arg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	printf("\n]}\n");
+
+	fprintf(stderr, "%zu records, %.3f ms\n", recordCount, (double) t * 1e3 / clockHz);
+	free(records);
+	return 0;
+}